@@ -13,6 +13,15 @@
 #include <cmath>
 #include "CelestronOriginSimulator.h"
 #include "TiffImageGenerator.h"
+#include "StarCatalog.h"
+#include "FrameBufferPool.h"
+#include "FitsWriter.h"
+#include "SimulatorMetrics.h"
+#include "Tracer.h"
+#include <QElapsedTimer>
+#include <QScopeGuard>
+#include <QUrl>
+#include <QUrlQuery>
 #include <QApplication>
 #include <QJsonDocument>
 #include <QJsonObject>
@@ -26,15 +35,43 @@
 #include <QPainter>
 #include <cmath>
 
-CelestronOriginSimulator::CelestronOriginSimulator(QObject *parent) : QObject(parent) {
+CelestronOriginSimulator::CelestronOriginSimulator(QObject *parent)
+    : CelestronOriginSimulator(SimulatorInstanceConfig(), parent) {
+}
+
+CelestronOriginSimulator::CelestronOriginSimulator(const SimulatorInstanceConfig &config, QObject *parent)
+    : QObject(parent), m_config(config) {
+    m_clock = m_config.clock ? m_config.clock : &SimulationClock::global();
+    
+    if (!m_config.sessionLogPath.isEmpty()) {
+        m_recorder = new SessionRecorder(m_config.sessionLogPath);
+    }
+    
+    if (m_config.broadcastId >= 0) {
+        broadcast_id = m_config.broadcastId;
+    }
+    
+    // Each instance keeps its own image store so fleet members never overwrite each other
+    QDir().mkpath(m_config.imageStoreDir);
+    m_hipsTiffPath = m_config.imageStoreDir + "/temp_hips_image.tiff";
+    
     // Initialize core components
-    m_telescopeState = new TelescopeState();
+    m_telescopeState = m_config.randomSeed >= 0
+        ? new TelescopeState(m_clock, static_cast<quint32>(m_config.randomSeed))
+        : new TelescopeState(m_clock);
+    m_telescopeState->imageStoreDir = m_config.imageStoreDir;
+    m_telescopeState->bestFocusPosition = m_config.bestFocusPosition;
+    m_noiseSeed = m_config.randomSeed >= 0 ? quint64(m_config.randomSeed)
+                                           : QRandomGenerator::global()->generate64();
     m_commandHandler = new CommandHandler(m_telescopeState, this);
     m_statusSender = new StatusSender(m_telescopeState, this);
+    m_liveStreamer = new LiveViewStreamer([this](quint64 *generation) {
+        *generation = m_imageGeneration;
+        return m_imageData;
+    });
     
     // Initialize the dual protocol server
     m_tcpServer = new QTcpServer(this);
-    m_udpSocket = new QUdpSocket(this);
 
     // Initialize headless mosaic creator
     m_mosaicCreator = new EnhancedMosaicCreator(this); // Headless mode
@@ -47,10 +84,16 @@ CelestronOriginSimulator::CelestronOriginSimulator(QObject *parent) : QObject(pa
     if (false) qDebug() << "Headless Enhanced Mosaic Creator initialized";
     
     setupHipsIntegration();  // Changed from setupRubinIntegration
+    setupRoutes();
     
-    if (m_tcpServer->listen(QHostAddress::Any, SERVER_PORT)) {
+    if (m_tcpServer->listen(m_config.bindAddress, m_config.port)) {
         setupConnections();
         setupTimers();
+        SimulatorMetrics::instance().startEventLoopProbe();
+        
+        // Non-standard ports only happen in fleet mode; advertise them so clients can connect
+        m_discoveryHandle = DiscoveryBroadcaster::instance().addTelescope(
+            identity(), m_config.bindAddress, m_config.port != SERVER_PORT ? m_config.port : 0);
         
         // First broadcast immediately
         QTimer::singleShot(100, this, &CelestronOriginSimulator::sendBroadcast);
@@ -60,14 +103,25 @@ CelestronOriginSimulator::CelestronOriginSimulator(QObject *parent) : QObject(pa
 }
 
 CelestronOriginSimulator::~CelestronOriginSimulator() {
+    if (m_discoveryHandle) {
+        DiscoveryBroadcaster::instance().removeTelescope(m_discoveryHandle);
+    }
     if (m_tcpServer) {
         m_tcpServer->close();
     }
+    delete m_liveStreamer;
     qDeleteAll(m_webSocketClients);
+    delete m_recorder;
+}
+
+QString CelestronOriginSimulator::identity() const {
+    return QString("Origin-%1Z").arg(broadcast_id);
 }
 
 void CelestronOriginSimulator::setupHipsIntegration() {
-    m_hipsClient = new ProperHipsClient(this);
+    // Fleet members share one HiPS client; a standalone simulator owns its own
+    m_ownsHipsClient = (m_config.sharedHipsClient == nullptr);
+    m_hipsClient = m_ownsHipsClient ? new ProperHipsClient(this) : m_config.sharedHipsClient;
     
     // Set up HiPS image directory to integrate with existing simulator structure
     QString homeDir = QDir::homePath();
@@ -78,8 +132,10 @@ void CelestronOriginSimulator::setupHipsIntegration() {
     QDir().mkpath(hipsDir);
     
     // Connect ProperHipsClient signals to our slots
-    connect(m_hipsClient, &ProperHipsClient::testingComplete, 
-            this, &CelestronOriginSimulator::onHipsTestingComplete);
+    if (m_ownsHipsClient) {
+        connect(m_hipsClient, &ProperHipsClient::testingComplete, 
+                this, &CelestronOriginSimulator::onHipsTestingComplete);
+    }
     
     if (false) qDebug() << "ProperHips integration initialized";
     if (false) qDebug() << "HiPS images will be saved to:" << hipsDir;
@@ -111,8 +167,10 @@ void CelestronOriginSimulator::fetchHipsImagesForPosition(const SkyPosition& pos
         return;
     }
     
-    // Test the survey at this position
-    m_hipsClient->testSurveyAtPosition(bestSurvey, position);
+    // Test the survey at this position (SimulatorFleet tests a shared client once)
+    if (m_ownsHipsClient) {
+        m_hipsClient->testSurveyAtPosition(bestSurvey, position);
+    }
     
     generateCurrentSkyImage();
 }
@@ -209,6 +267,13 @@ void CelestronOriginSimulator::setupConnections() {
     });
     
     connect(m_commandHandler, &CommandHandler::imagingStarted, this, [this]() {
+        // RunImaging live-stacks a fixed scene; sample captures stay single frames
+        if (m_telescopeState->state != "SAMPLE_CAPTURE") {
+            m_stacker.begin(LiveStacker::defaultMode(), TiffImageGenerator::samplesPerPixel(), starsInView());
+            m_captureMetadata.insert(metadataKey(m_config.imageStoreDir + "/stacked_master.tiff"),
+                                     currentMetadata(m_clock->currentDateTime()));
+            m_subSecondsLeft = subExposureSeconds();
+        }
         m_imagingTimer->start(1000);
     });
 
@@ -221,7 +286,7 @@ void CelestronOriginSimulator::setupConnections() {
     connect(m_commandHandler, &CommandHandler::initializationStarted, this, [this](bool fakeInit) {
         if (fakeInit) {
             // Complete immediately for fake initialization
-            QTimer::singleShot(1000, this, &CelestronOriginSimulator::completeInitialization);
+            m_clock->singleShot(1000, this, [this]() { completeInitialization(); });
         } else {
             // Start the initialization process
             m_initTimer->start(3000); // Update every 3 seconds like real telescope
@@ -240,37 +305,28 @@ void CelestronOriginSimulator::setupConnections() {
 }
 
 void CelestronOriginSimulator::setupTimers() {
-    // Create broadcast timer
-    m_broadcastTimer = new QTimer(this);
-    connect(m_broadcastTimer, &QTimer::timeout, this, &CelestronOriginSimulator::sendBroadcast);
-    m_broadcastTimer->start(BROADCAST_INTERVAL);
+    // Periodic discovery broadcasts are scheduled by the shared DiscoveryBroadcaster
     
     // Create update timer for regular status updates
-    m_updateTimer = new QTimer(this);
-    connect(m_updateTimer, &QTimer::timeout, this, &CelestronOriginSimulator::sendStatusUpdates);
+    m_updateTimer = new SimTimer(m_clock, [this]() { sendStatusUpdates(); }, this);
     m_updateTimer->start(1000);
     
     // Create slew timer
-    m_slewTimer = new QTimer(this);
-    connect(m_slewTimer, &QTimer::timeout, this, &CelestronOriginSimulator::updateSlew);
+    m_slewTimer = new SimTimer(m_clock, [this]() { updateSlew(); }, this);
     
     // Create imaging timer
-    m_imagingTimer = new QTimer(this);
-    connect(m_imagingTimer, &QTimer::timeout, this, &CelestronOriginSimulator::updateImaging);
+    m_imagingTimer = new SimTimer(m_clock, [this]() { updateImaging(); }, this);
 
     // Create initialization timer
-    m_initTimer = new QTimer(this);
+    m_initTimer = new SimTimer(m_clock, [this]() { updateInitialization(); }, this);
     m_initTimer->setSingleShot(false);
-    connect(m_initTimer, &QTimer::timeout, this, &CelestronOriginSimulator::updateInitialization);
 }
 
 void CelestronOriginSimulator::updateSlew() {
-    static int slewProgress = 0;
-    
     // Simulate slew progress
-    slewProgress += 20;  // 20% progress per 500ms
+    m_slewProgress += 20;  // 20% progress per 500ms
     
-    if (slewProgress >= 100) {
+    if (m_slewProgress >= 100) {
         if (false) qDebug() << "Before update - RA:" << m_telescopeState->ra << "Dec:" << m_telescopeState->dec;
         if (false) qDebug() << "Target RA:" << m_telescopeState->targetRa << "Target Dec:" << m_telescopeState->targetDec;
         
@@ -284,7 +340,7 @@ void CelestronOriginSimulator::updateSlew() {
         
         // Stop the timer
         m_slewTimer->stop();
-        slewProgress = 0;
+        m_slewProgress = 0;
 
         if (false) qDebug() << "After update - RA:" << m_telescopeState->ra << "Dec:" << m_telescopeState->dec;
         
@@ -292,7 +348,7 @@ void CelestronOriginSimulator::updateSlew() {
         m_statusSender->sendMountStatusToAll();
 
         // Add delay to ensure coordinates are fully updated
-        QTimer::singleShot(100, this, [this]() {
+        m_clock->singleShot(100, this, [this]() {
             if (m_hipsClient) {
                 if (false) qDebug() << "🎯 Slew complete - fetching HiPS data for new position";
                 
@@ -326,6 +382,28 @@ void CelestronOriginSimulator::updateSlew() {
 
 
 void CelestronOriginSimulator::updateImaging() {
+    if (!m_telescopeState->isImaging && m_stacker.isActive()) {
+        // Cancelled mid-stack
+        m_stacker.end();
+        return;
+    }
+    
+    if (m_telescopeState->isImaging && m_stacker.isActive()) {
+        m_telescopeState->imagingTimeLeft--;
+        
+        if (--m_subSecondsLeft <= 0) {
+            publishStackedSub();
+            m_subSecondsLeft = subExposureSeconds();
+        }
+        
+        if (m_telescopeState->imagingTimeLeft <= 0) {
+            m_stacker.end();
+            m_imagingTimer->stop();
+            m_commandHandler->completeImaging();
+        }
+        return;
+    }
+    
     if (m_telescopeState->isImaging) {
         m_telescopeState->imagingTimeLeft--;
         
@@ -338,7 +416,13 @@ void CelestronOriginSimulator::updateImaging() {
             QString fullPath = m_absoluteTempDir + "/" + imagePath;
             
 	    // No cached image data
-	    TiffImageGenerator::generateSyntheticStarField(fullPath, 150);
+	    QElapsedTimer renderTimer;
+	    renderTimer.start();
+	    TiffImageGenerator::generateSyntheticStarField(fullPath, starsInView(), nextSensorNoise());
+	    m_captureMetadata.insert(metadataKey(fullPath), currentMetadata(m_clock->currentDateTime().addMSecs(
+	                                 -qint64(m_telescopeState->exposure * 1000.0))));
+	    SimulatorMetrics::instance().observe("origin_image_render_seconds", renderTimer.nsecsElapsed() / 1e9,
+	                                         SimulatorMetrics::label("stage", "capture"));
 	    qDebug() << "=== SAMPLE CAPTURE COMPLETE ===";
 	    qDebug() << "Generated synthetic star field (no cached image)";
             
@@ -348,6 +432,60 @@ void CelestronOriginSimulator::updateImaging() {
     }
 }
 
+int CelestronOriginSimulator::subExposureSeconds() const {
+    // The imaging timer ticks once a simulated second
+    return qMax(1, int(std::ceil(m_telescopeState->exposure)));
+}
+
+std::vector<TiffImageGenerator::Star> CelestronOriginSimulator::starsInView() const {
+    return StarCatalog::instance().starsInView(m_telescopeState->ra, m_telescopeState->dec,
+                                               m_telescopeState->orientation,
+                                               m_telescopeState->fovX, m_telescopeState->fovY,
+                                               float(m_telescopeState->defocusBlurPixels()));
+}
+
+SensorNoise CelestronOriginSimulator::nextSensorNoise() {
+    SensorNoise::Settings settings;
+    settings.exposure = m_telescopeState->exposure;
+    settings.iso = m_telescopeState->iso;
+    settings.temperature = m_telescopeState->cameraTemperature;
+    settings.binning = m_telescopeState->binning;
+    return SensorNoise(settings, m_noiseSeed, m_noiseFrame++);
+}
+
+FitsWriter::Metadata CelestronOriginSimulator::currentMetadata(const QDateTime &dateObs) const {
+    FitsWriter::Metadata metadata;
+    metadata.ra = m_telescopeState->ra;
+    metadata.dec = m_telescopeState->dec;
+    metadata.fovX = m_telescopeState->fovX;
+    metadata.fovY = m_telescopeState->fovY;
+    metadata.orientation = m_telescopeState->orientation;
+    metadata.exposure = m_telescopeState->exposure;
+    metadata.iso = m_telescopeState->iso;
+    metadata.dateObs = dateObs;
+    return metadata;
+}
+
+QString CelestronOriginSimulator::metadataKey(const QString &tiffPath) {
+    return QDir::cleanPath(QFileInfo(tiffPath).absoluteFilePath());
+}
+
+void CelestronOriginSimulator::publishStackedSub() {
+    QElapsedTimer renderTimer;
+    renderTimer.start();
+    if (!m_stacker.captureSub(nextSensorNoise())) return;
+    
+    // One master per instance, rewritten after every sub
+    QString masterName = "stacked_master.tiff";
+    m_stacker.writeMaster(m_config.imageStoreDir + "/" + masterName);
+    SimulatorMetrics::instance().observe("origin_image_render_seconds", renderTimer.nsecsElapsed() / 1e9,
+                                         SimulatorMetrics::label("stage", "stack"));
+    
+    if (false) qDebug() << "Stacked sub" << m_stacker.frameCount();
+    m_telescopeState->fileLocation = "/SmartScope-1.0/dev2/Images/Stacked/" + masterName;
+    m_statusSender->sendNewImageReadyToAll();
+}
+
 // =============================================================================
 // EXPLANATION OF THE FIX
 // =============================================================================
@@ -387,7 +525,7 @@ void CelestronOriginSimulator::updateInitialization() {
     
     // After several updates, set focus position (matches real telescope behavior)
     if (m_initUpdateCount == 5) {
-        m_telescopeState->initInfo.positionOfFocus = 18617; // Use value from real trace
+        m_telescopeState->initInfo.positionOfFocus = m_telescopeState->bestFocusPosition;
     }
     
     // After more updates, find first alignment point
@@ -398,7 +536,7 @@ void CelestronOriginSimulator::updateInitialization() {
     }
     
     // Randomly decide if initialization fails (about 50% chance like real telescope)
-    if (m_initUpdateCount < 10 && QRandomGenerator::global()->bounded(100) < 10) {
+    if (m_initUpdateCount < 10 && m_telescopeState->rng.bounded(100) < 10) {
         failInitialization();
         return;
     }
@@ -426,7 +564,7 @@ void CelestronOriginSimulator::completeInitialization() {
     m_statusSender->sendTaskControllerStatusToAll();
     
     // Wait a moment and transition to IDLE state
-    QTimer::singleShot(1000, this, [this]() {
+    m_clock->singleShot(1000, this, [this]() {
         m_telescopeState->state = "IDLE";
         m_statusSender->sendTaskControllerStatusToAll();
     });
@@ -463,12 +601,22 @@ void CelestronOriginSimulator::handleNewConnection() {
     // Store pending request data
     m_pendingRequests[socket] = QByteArray();
     
+    if (m_recorder) {
+        quint32 connectionId = m_recorder->nextConnectionId();
+        socket->setProperty("sessionConnectionId", connectionId);
+        m_recorder->record(SessionRecordKind::ConnectionOpened, connectionId,
+                           QString("%1:%2").arg(socket->peerAddress().toString()).arg(socket->peerPort()).toUtf8());
+    }
+    
     // CRITICAL: Use QueuedConnection to prevent immediate processing conflicts
     connect(socket, &QTcpSocket::readyRead, this, [this, socket]() {
         handleIncomingData(socket);
     }, Qt::QueuedConnection);
     
     connect(socket, &QTcpSocket::disconnected, this, [this, socket]() {
+        if (m_recorder) {
+            m_recorder->record(SessionRecordKind::ConnectionClosed, socket->property("sessionConnectionId").toUInt());
+        }
         m_pendingRequests.remove(socket);
         socket->deleteLater();
     });
@@ -479,37 +627,22 @@ void CelestronOriginSimulator::handleNewConnection() {
 // They remain unchanged from your original implementation
 
 void CelestronOriginSimulator::sendBroadcast() {
-    // Prepare the broadcast message
-    QString message = QString("Identity:Origin-") + QLatin1String(std::to_string(broadcast_id)) + QString("Z Origin IP Address = %1");
-    
-    // Get our IP addresses
-    QList<QHostAddress> ipAddresses = QNetworkInterface::allAddresses();
-    
-    for (const QHostAddress &address : ipAddresses) {
-        if (address.protocol() == QAbstractSocket::IPv4Protocol && address != QHostAddress::LocalHost) {
-            QString broadcastMessage = message.arg(address.toString());
-            if (true) qDebug() << broadcastMessage;
-            
-            // Send broadcast on all network interfaces
-            m_udpSocket->writeDatagram(
-                broadcastMessage.toUtf8(),
-                QHostAddress::Broadcast,
-                BROADCAST_PORT
-            );
-        }
-    }
+    // Datagrams are prebuilt and the interface list cached by the broadcaster
+    DiscoveryBroadcaster::instance().announceNow(m_discoveryHandle);
 }
 
 
 void CelestronOriginSimulator::handleIncomingData(QTcpSocket *socket) {
+    TRACE_SCOPE("http.request");
     QByteArray newData = socket->readAll();
     m_pendingRequests[socket].append(newData);
     
     QByteArray &requestData = m_pendingRequests[socket];
     
-    // Look for complete HTTP headers
-    int headerEndPos = requestData.indexOf("\r\n\r\n");
-    if (headerEndPos == -1) {
+    // Parse the request head in place; views stay valid until requestData changes
+    HttpRequest request;
+    HttpRequest::ParseResult parsed = request.parse(requestData);
+    if (parsed == HttpRequest::Incomplete) {
         // Headers not complete yet, wait for more data
         if (requestData.size() > 8192) {
             // Too much data without finding headers, disconnect
@@ -518,59 +651,92 @@ void CelestronOriginSimulator::handleIncomingData(QTcpSocket *socket) {
         }
         return;
     }
-    
-    // We have complete headers, determine the protocol
-    QString request = QString::fromUtf8(requestData.left(headerEndPos));
-    QStringList lines = request.split("\r\n");
-    
-    if (lines.isEmpty()) {
+    if (parsed == HttpRequest::Invalid) {
+        m_pendingRequests.remove(socket);
         socket->disconnectFromHost();
         return;
     }
     
-    QString requestLine = lines[0];
-    QStringList requestParts = requestLine.split(" ");
-    
-    if (requestParts.size() < 3) {
-        socket->disconnectFromHost();
-        return;
+    if (m_recorder) {
+        m_recorder->record(SessionRecordKind::HttpRequest, socket->property("sessionConnectionId").toUInt(),
+                           requestData.left(request.headLength()));
     }
     
-    QString method = requestParts[0];
-    QString path = requestParts[1];
+    QByteArrayView method = request.method();
+    QString path = QString::fromLatin1(request.path());
     
     if (true) qDebug() << "Origin Protocol Request:" << method << path;
     
-    // Check if this is a WebSocket upgrade request
-    bool isWebSocketUpgrade = false;
-    for (const QString &line : lines) {
-        if (line.toLower().contains("upgrade: websocket")) {
-            isWebSocketUpgrade = true;
-            break;
-        }
-    }
-    
-    if (isWebSocketUpgrade && path == "/SmartScope-1.0/mountControlEndpoint") {
-        // Handle WebSocket upgrade for telescope control
-        handleWebSocketUpgrade(socket, requestData);
-    } else if (method == "GET" && path.startsWith("/SmartScope-1.0/dev2/Images/Temp/")) {
-        // Handle HTTP image request
-        handleHttpImageRequest(socket, path);
-    } else if (method == "GET" && path.contains("/SmartScope-1.0/dev2//tmp")) {
-        // Handle HTTP astrophotography image request
-        handleHttpAstroImageRequest(socket, path);
+    if (const HttpRouter::Route *route = m_router.find(method, request.path())) {
+        socket->setProperty("metricsRoute", route->name);
+        route->handler(socket, request, path);
     } else {
         // Unknown request
+        socket->setProperty("metricsRoute", "unknown");
         sendHttpResponse(socket, 404, "text/plain", "Not Found");
     }
     
     // Clear the pending request data
     m_pendingRequests.remove(socket);
 }
+void CelestronOriginSimulator::setupRoutes() {
+    const QByteArray dev2 = "/SmartScope-1.0/dev2/";
+
+    m_router.addRoute(QByteArray(), "/SmartScope-1.0/mountControlEndpoint", HttpRouter::Exact, "websocket_upgrade",
+                      [this](QTcpSocket *socket, const HttpRequest &request, const QString &) {
+        // Handle WebSocket upgrade for telescope control; a plain request here is not an endpoint
+        if (request.headerHasToken("Upgrade", "websocket")) {
+            handleWebSocketUpgrade(socket, request);
+        } else {
+            socket->setProperty("metricsRoute", "unknown");
+            sendHttpResponse(socket, 404, "text/plain", "Not Found");
+        }
+    });
+
+    // Live view JPEGs
+    m_router.addRoute("GET", dev2 + "Images/Temp/", HttpRouter::Prefix, "live_view",
+                      [this](QTcpSocket *socket, const HttpRequest &, const QString &path) {
+        handleHttpImageRequest(socket, path);
+    });
+
+    // Astrophotography TIFFs: fileLocation is either an Images/Astrophotography/ URL (HiPS) or a
+    // path inside the image store, which clients append to dev2/ giving a double slash
+    auto astro = [this](QTcpSocket *socket, const HttpRequest &request, const QString &path) {
+        handleHttpAstroImageRequest(socket, path, QString::fromLatin1(request.query()));
+    };
+    m_router.addRoute("GET", dev2 + "Images/Astrophotography/", HttpRouter::Prefix, "astrophotography", astro);
+    m_router.addRoute("GET", dev2 + "/tmp", HttpRouter::Prefix, "astrophotography", astro);
+    m_router.addRoute("GET", dev2 + m_config.imageStoreDir.toLatin1(), HttpRouter::Prefix, "astrophotography", astro);
+
+    // Live-stack masters, by file name within the image store
+    m_router.addRoute("GET", dev2 + "Images/Stacked/", HttpRouter::Prefix, "stacked_master",
+                      [this](QTcpSocket *socket, const HttpRequest &request, const QString &path) {
+        handleHttpStackedImageRequest(socket, path, QString::fromLatin1(request.query()));
+    });
+
+    auto listing = [this](QTcpSocket *socket, const HttpRequest &, const QString &path) {
+        handleHttpDirectoryListing(socket, path);
+    };
+    m_router.addRoute("GET", dev2 + "Images/Astrophotography/", HttpRouter::Exact, "listing", listing);
+    m_router.addRoute("GET", dev2 + m_config.imageStoreDir.toLatin1() + "/", HttpRouter::Exact, "listing", listing);
+
+    // Prometheus scrape endpoint
+    m_router.addRoute("GET", "/metrics", HttpRouter::Exact, "metrics",
+                      [this](QTcpSocket *socket, const HttpRequest &, const QString &) {
+        sendHttpResponse(socket, 200, "text/plain; version=0.0.4", SimulatorMetrics::instance().render());
+    });
+
+    // Chrome trace-event snapshot of recent spans on every thread
+    m_router.addRoute("GET", "/debug/trace", HttpRouter::Exact, "trace",
+                      [this](QTcpSocket *socket, const HttpRequest &, const QString &) {
+        sendHttpResponse(socket, 200, "application/json", Tracer::chromeTraceJson());
+    });
+}
+
 // CORRECTED FIX: CelestronOriginSimulator.cpp - Proper handshake sequence
 // Perform handshake FIRST, then transfer socket ownership
 
-void CelestronOriginSimulator::handleWebSocketUpgrade(QTcpSocket *socket, const QByteArray &requestData) {
+void CelestronOriginSimulator::handleWebSocketUpgrade(QTcpSocket *socket, const HttpRequest &request) {
 //     // if (false) qDebug() << "*** STARTING WEBSOCKET UPGRADE PROCESS ***";
 //     if (false) qDebug() << "Request data size:" << requestData.size();
     
@@ -578,7 +744,7 @@ void CelestronOriginSimulator::handleWebSocketUpgrade(QTcpSocket *socket, const
     WebSocketConnection *wsConn = new WebSocketConnection(socket, this, false); // false = don't take ownership yet
     
     // FIRST: Perform the handshake using the request data
-    if (wsConn->performHandshake(requestData)) {
+    if (wsConn->performHandshake(request)) {
 //         // if (false) qDebug() << "*** HANDSHAKE SUCCESSFUL - TRANSFERRING SOCKET OWNERSHIP ***";
         
         // CRITICAL: NOW disconnect the protocol detector since handshake worked
@@ -590,9 +756,11 @@ void CelestronOriginSimulator::handleWebSocketUpgrade(QTcpSocket *socket, const
         
         // NOW let WebSocketConnection take full ownership
         wsConn->takeSocketOwnership();
+        wsConn->setSessionRecorder(m_recorder, socket->property("sessionConnectionId").toUInt());
         
         // Add to our client list
         m_webSocketClients.append(wsConn);
+        SimulatorMetrics::instance().addGauge("origin_websocket_connections", 1);
         m_statusSender->addWebSocketClient(wsConn);
         
         // Set up all signal connections for WebSocket handling
@@ -614,7 +782,7 @@ void CelestronOriginSimulator::handleWebSocketUpgrade(QTcpSocket *socket, const
 //         if (false) qDebug() << "WebSocket connection established for telescope control";
         
         // Send initial status updates after a brief delay
-        QTimer::singleShot(1000, this, [this, wsConn]() {
+        m_clock->singleShot(1000, this, [this, wsConn]() {
             if (m_webSocketClients.contains(wsConn)) {
                 m_statusSender->sendMountStatus(wsConn);
                 m_statusSender->sendFocuserStatus(wsConn);
@@ -644,16 +812,25 @@ void CelestronOriginSimulator::handleHttpImageRequest(QTcpSocket *socket, const
     sendHttpResponse(socket, 200, "image/jpeg", m_imageData);
 }
 
-void CelestronOriginSimulator::handleHttpAstroImageRequest(QTcpSocket *socket, const QString &path) {
-    // Normalize path by replacing double slashes
+// FITS instead of TIFF with ?format=fits or a .fits file name
+static bool wantsFits(const QString &path, const QString &query) {
+    return QUrlQuery(query).queryItemValue("format").compare("fits", Qt::CaseInsensitive) == 0
+        || path.endsWith(".fits", Qt::CaseInsensitive);
+}
+
+void CelestronOriginSimulator::handleHttpAstroImageRequest(QTcpSocket *socket, const QString &path,
+                                                           const QString &query) {
+    bool wantFits = wantsFits(path, query);
     QString normalizedPath = path;
+    
+    // Normalize path by replacing double slashes
     normalizedPath.replace("//", "/");
     
     // Extract just the requested filename
     QString fileName = QFileInfo(normalizedPath).fileName();
 
     // Always serve the pre-generated 16-bit TIFF instead
-    QString fullPath = "/tmp/temp_hips_image.tiff";
+    QString fullPath = m_hipsTiffPath;
 
     // If the TIFF doesn't exist, fall back to regular search
     if (!QFile::exists(fullPath)) {
@@ -666,11 +843,47 @@ void CelestronOriginSimulator::handleHttpAstroImageRequest(QTcpSocket *socket, c
         }
     }
 
+    serveCaptureFile(socket, fullPath, normalizedPath, wantFits);
+}
+
+void CelestronOriginSimulator::handleHttpStackedImageRequest(QTcpSocket *socket, const QString &path,
+                                                             const QString &query) {
+    // Only the file name counts, so nothing outside the image store is reachable
+    QString fileName = QFileInfo(path).fileName();
+    serveCaptureFile(socket, m_config.imageStoreDir + "/" + fileName, path, wantsFits(path, query));
+}
+
+void CelestronOriginSimulator::serveCaptureFile(QTcpSocket *socket, QString fullPath,
+                                                const QString &requestPath, bool wantFits) {
+    if (wantFits && fullPath.endsWith(".fits", Qt::CaseInsensitive)) {
+        fullPath.chop(5);
+        fullPath += ".tiff";
+    }
+    
     if (!QFile::exists(fullPath)) {
-        qWarning() << "AstroImage request failed - file not found:" << normalizedPath << "->" << fullPath;
+        qWarning() << "AstroImage request failed - file not found:" << requestPath << "->" << fullPath;
         sendHttpResponse(socket, 404, "text/plain", "Image not found");
         return;
     }
+    
+    if (wantFits) {
+        // Converted in one pass over the TIFF, then sent as the socket drains. Pointing drifts while
+        // tracking, so the WCS comes from when the stars were placed; a file this instance
+        // didn't render (the HiPS image) gets the pointing now
+        FitsWriter::Metadata metadata = m_captureMetadata.value(metadataKey(fullPath),
+                                                                currentMetadata(m_clock->currentDateTime()));
+        
+        FitsWriter::Image image;
+        if (!FitsWriter::fromTiff(fullPath, metadata, &image)) {
+            sendHttpResponse(socket, 500, "text/plain", "Failed to convert image");
+            return;
+        }
+        
+        qDebug() << "Serving image/fits from" << fullPath << "for" << requestPath;
+        writeHttpHead(socket, 200, "image/fits", image.size());
+        FitsWriter::stream(std::move(image), socket, [socket]() { socket->disconnectFromHost(); });
+        return;
+    }
 
     QFile imageFile(fullPath);
     if (!imageFile.open(QIODevice::ReadOnly)) {
@@ -681,12 +894,38 @@ void CelestronOriginSimulator::handleHttpAstroImageRequest(QTcpSocket *socket, c
     QByteArray imageData = imageFile.readAll();
     imageFile.close();
 
-    qDebug() << "Serving image/tiff from" << fullPath << "for" << normalizedPath;
+    qDebug() << "Serving image/tiff from" << fullPath << "for" << requestPath;
     sendHttpResponse(socket, 200, "image/tiff", imageData);
 }
 
+void CelestronOriginSimulator::handleHttpDirectoryListing(QTcpSocket *socket, const QString &path) {
+    // Captures in this instance's image store; links are relative so they resolve under either URL
+    QDir dir(m_config.imageStoreDir);
+    QStringList files = dir.entryList(QStringList() << "*.tiff" << "*.tif" << "*.jpg" << "*.fits",
+                                      QDir::Files, QDir::Time);
+
+    QByteArray html = "<!DOCTYPE html>\n<html><head><title>Index of " + path.toHtmlEscaped().toUtf8()
+                    + "</title></head><body>\n<h1>Index of " + path.toHtmlEscaped().toUtf8() + "</h1>\n<ul>\n";
+    for (const QString &file : files) {
+        QByteArray name = file.toHtmlEscaped().toUtf8();
+        html += "<li><a href=\"" + QUrl::toPercentEncoding(file) + "\">" + name + "</a></li>\n";
+    }
+    html += "</ul>\n</body></html>\n";
+
+    sendHttpResponse(socket, 200, "text/html; charset=utf-8", html);
+}
+
 void CelestronOriginSimulator::sendHttpResponse(QTcpSocket *socket, int statusCode, 
                      const QString &contentType, const QByteArray &data) {
+    writeHttpHead(socket, statusCode, contentType, data.size());
+    if (!data.isEmpty()) {
+        socket->write(data);
+    }
+    socket->disconnectFromHost();
+}
+
+void CelestronOriginSimulator::writeHttpHead(QTcpSocket *socket, int statusCode,
+                                             const QString &contentType, qint64 contentLength) {
     QString statusText;
     switch (statusCode) {
         case 200: statusText = "OK"; break;
@@ -698,17 +937,24 @@ void CelestronOriginSimulator::sendHttpResponse(QTcpSocket *socket, int statusCo
     
     QString response = QString("HTTP/1.1 %1 %2\r\n").arg(statusCode).arg(statusText);
     response += QString("Content-Type: %1\r\n").arg(contentType);
-    response += QString("Content-Length: %1\r\n").arg(data.size());
+    response += QString("Content-Length: %1\r\n").arg(contentLength);
     response += "Cache-Control: no-cache\r\n";
     response += "Access-Control-Allow-Origin: *\r\n";
     response += "Connection: close\r\n";
     response += "\r\n";
     
-    socket->write(response.toUtf8());
-    if (!data.isEmpty()) {
-        socket->write(data);
+    if (m_recorder) {
+        m_recorder->record(SessionRecordKind::HttpResponse, socket->property("sessionConnectionId").toUInt(),
+                           response.toUtf8());
     }
-    socket->disconnectFromHost();
+    
+    QByteArray head = response.toUtf8();
+    QString route = SimulatorMetrics::label("route", socket->property("metricsRoute").toString());
+    SimulatorMetrics::instance().increment("origin_http_requests_total",
+                                           route + "," + SimulatorMetrics::label("status", QString::number(statusCode)));
+    SimulatorMetrics::instance().increment("origin_http_response_bytes_total", route, head.size() + contentLength);
+    
+    socket->write(head);
 }
 
 void CelestronOriginSimulator::processWebSocketCommand(const QString &message) {
@@ -728,6 +974,14 @@ void CelestronOriginSimulator::processWebSocketCommand(const QString &message) {
     QString destination = obj["Destination"].toString();
     QString source = obj["Source"].toString();
     
+    TRACE_SCOPE("command.dispatch");
+    QElapsedTimer commandTimer;
+    commandTimer.start();
+    auto recordLatency = qScopeGuard([&]() {
+        SimulatorMetrics::instance().observe("origin_command_duration_seconds", commandTimer.nsecsElapsed() / 1e9,
+                                             SimulatorMetrics::label("command", command));
+    });
+    
 //     if (false) qDebug() << "Received WebSocket command:" << command << "to" << destination << "from" << source;
     
     // Handle status requests directly
@@ -765,16 +1019,71 @@ void CelestronOriginSimulator::processWebSocketCommand(const QString &message) {
     } else if (command == "GetModel") {
         int sequenceId = obj["SequenceID"].toInt();
         m_statusSender->sendSystemModel(wsConn, sequenceId, source);
+    } else if (command == "AdvanceClock" && destination == "Simulator") {
+        handleAdvanceClock(wsConn, obj);
+    } else if ((command == "StartLiveStream" || command == "StopLiveStream") && destination == "Simulator") {
+        handleLiveStream(wsConn, obj);
     } else {
         // Process the command through the command handler
         m_commandHandler->processCommand(obj, wsConn);
     }
 }
 
+// Test-harness hook for stepped clocks: {"Command":"AdvanceClock","Destination":"Simulator","Milliseconds":N}
+void CelestronOriginSimulator::handleAdvanceClock(WebSocketConnection *wsConn, const QJsonObject &obj) {
+    QJsonObject response;
+    response["Command"] = "AdvanceClock";
+    response["Destination"] = obj["Source"].toString();
+    response["SequenceID"] = obj["SequenceID"].toInt();
+    response["Source"] = "Simulator";
+    response["Type"] = "Response";
+    
+    if (m_clock->mode() == SimulationClock::Stepped) {
+        m_clock->advance(static_cast<qint64>(obj["Milliseconds"].toDouble()));
+        response["ErrorCode"] = 0;
+        response["ErrorMessage"] = "";
+    } else {
+        response["ErrorCode"] = 1;
+        response["ErrorMessage"] = "Simulation clock is not in stepped mode";
+    }
+    response["SimulatedTime"] = m_clock->currentMSecsSinceEpoch();
+    response["ExpiredAt"] = m_telescopeState->getExpiredAt();
+    
+    wsConn->sendTextMessage(QJsonDocument(response).toJson(QJsonDocument::Compact));
+}
+
+// Binary live-view push: {"Command":"StartLiveStream","Destination":"Simulator","FrameRate":N} / "StopLiveStream"
+void CelestronOriginSimulator::handleLiveStream(WebSocketConnection *wsConn, const QJsonObject &obj) {
+    QString command = obj["Command"].toString();
+    int frameRate = qBound(1, obj["FrameRate"].toInt(10), 60);
+    
+    if (command == "StartLiveStream") {
+        m_liveStreamer->subscribe(wsConn, frameRate);
+    } else {
+        m_liveStreamer->unsubscribe(wsConn);
+    }
+    
+    QJsonObject response;
+    response["Command"] = command;
+    response["Destination"] = obj["Source"].toString();
+    response["SequenceID"] = obj["SequenceID"].toInt();
+    response["Source"] = "Simulator";
+    response["Type"] = "Response";
+    response["ErrorCode"] = 0;
+    response["ErrorMessage"] = "";
+    if (command == "StartLiveStream") response["FrameRate"] = frameRate;
+    response["ExpiredAt"] = m_telescopeState->getExpiredAt();
+    
+    wsConn->sendTextMessage(QJsonDocument(response).toJson(QJsonDocument::Compact));
+}
+
 void CelestronOriginSimulator::onWebSocketDisconnected() {
     WebSocketConnection *wsConn = qobject_cast<WebSocketConnection*>(sender());
     if (wsConn) {
-        m_webSocketClients.removeAll(wsConn);
+        m_liveStreamer->unsubscribe(wsConn);
+        if (m_webSocketClients.removeAll(wsConn) > 0) {
+            SimulatorMetrics::instance().addGauge("origin_websocket_connections", -1);
+        }
         m_statusSender->removeWebSocketClient(wsConn);
         wsConn->deleteLater();
     }
@@ -785,28 +1094,27 @@ void CelestronOriginSimulator::onWebSocketDisconnected() {
 
 void CelestronOriginSimulator::sendStatusUpdates() {
     // Update time
-    m_telescopeState->dateTime = QDateTime::currentDateTime();
+    m_telescopeState->dateTime = m_clock->currentDateTime();
     
     // CRITICAL: Use QueuedConnection to avoid blocking the event loop
-    static int updateCounter = 0;
-    updateCounter++;
+    int updateCounter = ++m_statusUpdateCounter;
     
     // Send updates in smaller batches to prevent blocking
     if (updateCounter % 1 == 0) {
         // Every second - critical updates only
-        QTimer::singleShot(0, this, [this]() {
+        m_clock->singleShot(0, this, [this]() {
             m_statusSender->sendMountStatusToAll();
         });
     }
     
     if (updateCounter % 2 == 0) {
-        QTimer::singleShot(5, this, [this]() {
+        m_clock->singleShot(5, this, [this]() {
             m_statusSender->sendFocuserStatusToAll();
         });
     }
     
     if (updateCounter % 3 == 0) {
-        QTimer::singleShot(10, this, [this]() {
+        m_clock->singleShot(10, this, [this]() {
 	  if (!m_telescopeState->isImaging)
 	    {
             m_statusSender->sendCameraParamsToAll();
@@ -819,33 +1127,33 @@ void CelestronOriginSimulator::sendStatusUpdates() {
     
     // Less frequent updates with longer delays
     if (updateCounter % 10 == 0) {
-        QTimer::singleShot(15, this, [this]() {
+        m_clock->singleShot(15, this, [this]() {
             m_statusSender->sendEnvironmentStatusToAll();
             m_statusSender->sendDiskStatusToAll();
         });
     }
     
     if (updateCounter % 15 == 0) {
-        QTimer::singleShot(20, this, [this]() {
+        m_clock->singleShot(20, this, [this]() {
             m_statusSender->sendDewHeaterStatusToAll();
         });
     }
     
     if (updateCounter % 30 == 0) {
-        QTimer::singleShot(25, this, [this]() {
+        m_clock->singleShot(25, this, [this]() {
             m_statusSender->sendOrientationStatusToAll();
         });
     }
     
     if (updateCounter % 5 == 0) {
-        QTimer::singleShot(30, this, [this]() {
+        m_clock->singleShot(30, this, [this]() {
             m_statusSender->sendTaskControllerStatusToAll();
         });
     }
     
     // Reset counter to prevent overflow
-    if (updateCounter > 1000) {
-        updateCounter = 0;
+    if (m_statusUpdateCounter > 1000) {
+        m_statusUpdateCounter = 0;
     }
 }
 
@@ -907,7 +1215,7 @@ void CelestronOriginSimulator::generateCurrentSkyImage() {
         ra_deg,
         dec_deg,
         QString("Live_Image_%1").arg(m_telescopeState->imageCounter),
-        QString("Real-time telescope position at %1").arg(QDateTime::currentDateTime().toString("hh:mm:ss"))
+        QString("Real-time telescope position at %1").arg(m_clock->currentDateTime().toString("hh:mm:ss"))
     };
     
     // Convert coordinates to string format for the mosaic creator
@@ -961,6 +1269,7 @@ QByteArray saveImageToByteArray(const QImage& image, const QString& format = "JP
 }
 
 void CelestronOriginSimulator::onMosaicComplete(const QImage& mosaic) {
+    TRACE_SCOPE("mosaic.complete");
     if (false) qDebug() << "Enhanced mosaic complete, processing for telescope image";
     
     if (mosaic.isNull()) {
@@ -970,21 +1279,38 @@ void CelestronOriginSimulator::onMosaicComplete(const QImage& mosaic) {
     }
     
     if (true) qDebug() << QString("Received mosaic: %1x%2 pixels").arg(mosaic.width()).arg(mosaic.height());
-    QImage fullImage = mosaic.scaled(3056, 2048, Qt::KeepAspectRatio, Qt::SmoothTransformation);
-    QImage paddedImage(3056, 2048, QImage::Format_RGB888);
+    QElapsedTimer renderTimer;
+    renderTimer.start();
+    // Letterbox into a pooled sensor-sized frame, scaling while painting so no
+    // intermediate full-size image is allocated
+    FrameLease frame = FrameBufferPool::instance().acquire(FrameBufferPool::RGB8);
+    QImage paddedImage = frame.image(3056, 2048, QImage::Format_RGB888);
     paddedImage.fill(Qt::black);
+    QSize fullSize = mosaic.size().scaled(3056, 2048, Qt::KeepAspectRatio);
     QPainter tiffpainter(&paddedImage);
-    int x = (3056 - fullImage.width()) / 2;
-    int y = (2048 - fullImage.height()) / 2;
-    tiffpainter.drawImage(x, y, fullImage);
+    tiffpainter.setRenderHint(QPainter::SmoothPixmapTransform);
+    int x = (3056 - fullSize.width()) / 2;
+    int y = (2048 - fullSize.height()) / 2;
+    tiffpainter.drawImage(QRect(QPoint(x, y), fullSize), mosaic);
     tiffpainter.end();
-    QByteArray m_fulltiff = saveImageToByteArray(paddedImage, "TIFF", 100);
-    QString tempPath = "/tmp/temp_hips_image.tiff";
-    bool success = TiffImageGenerator::generateOriginFormatTiff(tempPath, paddedImage);
+    QString tempPath = m_hipsTiffPath;
+    QImage liveSource = mosaic;
+    if (TiffImageGenerator::rawBayer()) {
+        // Capture the sensor mosaic, and debayer it only for the JPEG live view
+        FrameLease cfa = FrameBufferPool::instance().acquire(FrameBufferPool::Mono16);
+        TiffImageGenerator::convertToBayer(paddedImage, cfa.samples16());
+        TiffImageGenerator::writeTiff16BitBayer(tempPath, cfa.samples16(), 3056, 2048);
+        liveSource = TiffImageGenerator::debayerSuperpixel(cfa.samples16(), 3056, 2048);
+    } else {
+        TiffImageGenerator::generateOriginFormatTiff(tempPath, paddedImage);
+    }
     qDebug() << "Saved resized image: " << tempPath;               
+    SimulatorMetrics::instance().observe("origin_image_render_seconds", renderTimer.nsecsElapsed() / 1e9,
+                                         SimulatorMetrics::label("stage", "tiff"));
+    renderTimer.restart();
     
     // Resize to telescope camera resolution (800x600) - Origin camera specs
-    QImage telescopeImage = mosaic.scaled(800, 600, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    QImage telescopeImage = liveSource.scaled(800, 600, Qt::KeepAspectRatio, Qt::SmoothTransformation);
     
     // Fill any letterbox areas with black (if aspect ratios don't match)
     if (telescopeImage.width() != 800 || telescopeImage.height() != 600) {
@@ -1006,6 +1332,9 @@ void CelestronOriginSimulator::onMosaicComplete(const QImage& mosaic) {
     painter.end();
     
     m_imageData = saveImageToByteArray(telescopeImage, "JPEG", 95);
+    m_imageGeneration++;
+    SimulatorMetrics::instance().observe("origin_image_render_seconds", renderTimer.nsecsElapsed() / 1e9,
+                                         SimulatorMetrics::label("stage", "live_view"));
   
     if (true) qDebug() << QString("Updated mosaic: %1x%2 pixels").arg(telescopeImage.width()).arg(telescopeImage.height());
 
@@ -1035,7 +1364,7 @@ void CelestronOriginSimulator::addTelescopeOverlay(QPainter& painter, const QIma
     painter.drawText(10, 20, coordText);
     
     // Add timestamp (bottom left)
-    QString timeText = QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss UTC");
+    QString timeText = m_clock->currentDateTime().toString("yyyy-MM-dd hh:mm:ss UTC");
     painter.drawText(10, image.height() - 25, timeText);
     
     // Add exposure info (bottom left, second line)
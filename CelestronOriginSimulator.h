@@ -7,30 +7,57 @@
 #include <QUdpSocket>
 #include <QTimer>
 #include <QMap>
+#include <QHash>
 #include <QList>
+#include <QHostAddress>
 
 #include "TelescopeState.h"
+#include "SimulationClock.h"
 #include "WebSocketConnection.h"
 #include "CommandHandler.h"
 #include "StatusSender.h"
 #include "ProperHipsClient.h"  // Changed from RubinHipsClient
 #include "EnhancedMosaicCreator.h"
+#include "SessionLog.h"
+#include "LiveViewStreamer.h"
+#include "DiscoveryBroadcaster.h"
+#include "HttpRequest.h"
+#include "HttpRouter.h"
+#include "SensorNoise.h"
+#include "LiveStacker.h"
+#include "FitsWriter.h"
 
 // Constants
 const QString SERVER_NAME = "CelestronOriginSimulator";
 const int SERVER_PORT = 80;
-const int BROADCAST_PORT = 55555;
-const int BROADCAST_INTERVAL = 5000; // milliseconds
 
 #define qrand rand
 
+// Per-instance settings, so several virtual telescopes can share one process
+struct SimulatorInstanceConfig {
+    QHostAddress bindAddress = QHostAddress::Any;  // Specific address for virtual-IP fleets
+    quint16 port = SERVER_PORT;
+    int broadcastId = -1;                           // -1 picks a random Origin-NNZ identity
+    QString imageStoreDir = "/tmp";                 // Captures and HiPS TIFFs for this instance
+    ProperHipsClient *sharedHipsClient = nullptr;   // Owned by the fleet when set
+    SimulationClock *clock = nullptr;               // nullptr uses SimulationClock::global()
+    qint64 randomSeed = -1;                         // >= 0 makes sensor noise reproducible
+    int bestFocusPosition = 18447;                  // Focuser position that renders sharp stars
+    QString sessionLogPath;                         // Non-empty records all traffic for OriginReplay
+};
+
 class CelestronOriginSimulator : public QObject {
     Q_OBJECT
     
 public:
     explicit CelestronOriginSimulator(QObject *parent = nullptr);
+    explicit CelestronOriginSimulator(const SimulatorInstanceConfig &config, QObject *parent = nullptr);
     ~CelestronOriginSimulator();
 
+    bool isListening() const { return m_tcpServer && m_tcpServer->isListening(); }
+    quint16 serverPort() const { return m_config.port; }
+    QString identity() const;
+
 private slots:
     void handleNewConnection();
     void handleIncomingData(QTcpSocket *socket);
@@ -54,32 +81,58 @@ private slots:
 private:
     // Core components
     QTcpServer *m_tcpServer;
-    QUdpSocket *m_udpSocket;
+    int m_discoveryHandle = 0;
     TelescopeState *m_telescopeState;
     CommandHandler *m_commandHandler;
     StatusSender *m_statusSender;
     ProperHipsClient* m_hipsClient;  // Changed from m_rubinClient
+    bool m_ownsHipsClient = true;
     QByteArray m_imageData;
+    quint64 m_imageGeneration = 0;    // Bumped whenever m_imageData is replaced
+    SimulatorInstanceConfig m_config;
+    QString m_hipsTiffPath;
+    SessionRecorder *m_recorder = nullptr;
+    LiveViewStreamer *m_liveStreamer = nullptr;
+    LiveStacker m_stacker;
+    int m_subSecondsLeft = 0;
+    quint64 m_noiseSeed = 0;
+    quint64 m_noiseFrame = 0;       // Every capture and sub gets its own noise
+    QHash<QString, FitsWriter::Metadata> m_captureMetadata;  // By TIFF path, taken when the stars were placed
 
     // WebSocket management
     QList<WebSocketConnection*> m_webSocketClients;
     QMap<QTcpSocket*, QByteArray> m_pendingRequests;
+    HttpRouter m_router;
     
-    // Timers
-    QTimer *m_broadcastTimer;
-    QTimer *m_updateTimer;
-    QTimer *m_slewTimer;
-    QTimer *m_imagingTimer;
+    // Timers (discovery stays on the wall clock, simulation timers follow m_clock)
+    SimulationClock *m_clock;
+    SimTimer *m_updateTimer;
+    SimTimer *m_slewTimer;
+    SimTimer *m_imagingTimer;
     QTimer *m_connectionHealthTimer;
-    QTimer *m_initTimer;
+    SimTimer *m_initTimer;
 
     EnhancedMosaicCreator* m_mosaicCreator;
     bool m_mosaicInProgress;
 
     int m_initUpdateCount = 0;
+    int m_slewProgress = 0;
+    int m_statusUpdateCounter = 0;
 
     int broadcast_id = qrand() % 90 + 10;
   
+    // Live stacking during RunImaging
+    int subExposureSeconds() const;
+    void publishStackedSub();
+    
+    // Catalog stars under the current pointing, and sensor noise for the next frame
+    std::vector<TiffImageGenerator::Star> starsInView() const;
+    SensorNoise nextSensorNoise();
+    
+    // FITS header values for the current pointing, kept per TIFF so a download gets its capture's WCS
+    FitsWriter::Metadata currentMetadata(const QDateTime &dateObs) const;
+    static QString metadataKey(const QString &tiffPath);
+
     // Initialization methods
     void setupInitialization();
     void updateInitialization();
@@ -90,14 +143,23 @@ private:
     QString m_absoluteTempDir;
     QString m_absoluteAstroDir;
     
+    // Simulator control commands (not part of the Origin protocol)
+    void handleAdvanceClock(WebSocketConnection *wsConn, const QJsonObject &obj);
+    void handleLiveStream(WebSocketConnection *wsConn, const QJsonObject &obj);
+    
     // Protocol handlers
-    void handleWebSocketUpgrade(QTcpSocket *socket, const QByteArray &requestData);
+    void setupRoutes();
+    void handleWebSocketUpgrade(QTcpSocket *socket, const HttpRequest &request);
     void handleHttpImageRequest(QTcpSocket *socket, const QString &path);
-    void handleHttpAstroImageRequest(QTcpSocket *socket, const QString &path);
+    void handleHttpAstroImageRequest(QTcpSocket *socket, const QString &path, const QString &query);
+    void handleHttpStackedImageRequest(QTcpSocket *socket, const QString &path, const QString &query);
+    void handleHttpDirectoryListing(QTcpSocket *socket, const QString &path);
+    void serveCaptureFile(QTcpSocket *socket, QString fullPath, const QString &requestPath, bool wantFits);
     
     // HTTP response helper
     void sendHttpResponse(QTcpSocket *socket, int statusCode, 
                          const QString &contentType, const QByteArray &data);
+    void writeHttpHead(QTcpSocket *socket, int statusCode, const QString &contentType, qint64 contentLength);
     
     // Initialization
     void createDummyImagesOld();
@@ -93,7 +93,7 @@ void CommandHandler::processCommand(const QJsonObject &obj, WebSocketConnection
         response["Destination"] = source;
         response["ErrorCode"] = 0;
         response["ErrorMessage"] = "";
-        response["ExpiredAt"] = QDateTime::currentDateTime().toSecsSinceEpoch();
+        response["ExpiredAt"] = m_telescopeState->clock->currentDateTime().toSecsSinceEpoch();
         response["SequenceID"] = sequenceId;
         response["Source"] = destination;
         response["Type"] = "Response";
@@ -106,7 +106,7 @@ void CommandHandler::processCommand(const QJsonObject &obj, WebSocketConnection
 
 void CommandHandler::handleRunInitialize(const QJsonObject &obj, WebSocketConnection *wsConn, int sequenceId, const QString &source, const QString &destination) {
     // Update telescope state
-    m_telescopeState->dateTime = QDateTime::currentDateTime();
+    m_telescopeState->dateTime = m_telescopeState->clock->currentDateTime();
     
     if (obj.contains("Date")) m_telescopeState->dateTime.setDate(QDate::fromString(obj["Date"].toString(), "dd MM yyyy"));
     if (obj.contains("Time")) m_telescopeState->dateTime.setTime(QTime::fromString(obj["Time"].toString(), "hh:mm:ss"));
@@ -141,7 +141,7 @@ void CommandHandler::handleRunInitialize(const QJsonObject &obj, WebSocketConnec
     response["Destination"] = source;
     response["ErrorCode"] = 0;
     response["ErrorMessage"] = "";
-    response["ExpiredAt"] = QDateTime::currentDateTime().toSecsSinceEpoch();
+    response["ExpiredAt"] = m_telescopeState->clock->currentDateTime().toSecsSinceEpoch();
     response["SequenceID"] = sequenceId;
     response["Source"] = destination;
     response["Type"] = "Response";
@@ -161,7 +161,7 @@ void CommandHandler::handleStartAlignment(const QJsonObject &obj, WebSocketConne
     response["Destination"] = source;
     response["ErrorCode"] = 0;
     response["ErrorMessage"] = "";
-    response["ExpiredAt"] = QDateTime::currentDateTime().toSecsSinceEpoch();
+    response["ExpiredAt"] = m_telescopeState->clock->currentDateTime().toSecsSinceEpoch();
     response["SequenceID"] = sequenceId;
     response["Source"] = destination;
     response["Type"] = "Response";
@@ -177,7 +177,7 @@ void CommandHandler::handleAddAlignmentPoint(const QJsonObject &obj, WebSocketCo
     response["Destination"] = source;
     response["ErrorCode"] = 0;
     response["ErrorMessage"] = "";
-    response["ExpiredAt"] = QDateTime::currentDateTime().toSecsSinceEpoch();
+    response["ExpiredAt"] = m_telescopeState->clock->currentDateTime().toSecsSinceEpoch();
     response["SequenceID"] = sequenceId;
     response["Source"] = destination;
     response["Type"] = "Response";
@@ -195,7 +195,7 @@ void CommandHandler::handleFinishAlignment(const QJsonObject &obj, WebSocketConn
     response["Destination"] = source;
     response["ErrorCode"] = 0;
     response["ErrorMessage"] = "";
-    response["ExpiredAt"] = QDateTime::currentDateTime().toSecsSinceEpoch();
+    response["ExpiredAt"] = m_telescopeState->clock->currentDateTime().toSecsSinceEpoch();
     response["SequenceID"] = sequenceId;
     response["Source"] = destination;
     response["Type"] = "Response";
@@ -231,7 +231,7 @@ void CommandHandler::handleGotoRaDec(const QJsonObject &obj, WebSocketConnection
         response["Destination"] = source;
         response["ErrorCode"] = 0;
         response["ErrorMessage"] = "";
-        response["ExpiredAt"] = QDateTime::currentDateTime().toSecsSinceEpoch();
+        response["ExpiredAt"] = m_telescopeState->clock->currentDateTime().toSecsSinceEpoch();
         response["SequenceID"] = sequenceId;
         response["Source"] = destination;
         response["Type"] = "Response";
@@ -243,7 +243,7 @@ void CommandHandler::handleGotoRaDec(const QJsonObject &obj, WebSocketConnection
         response["Destination"] = source;
         response["ErrorCode"] = 1;
         response["ErrorMessage"] = "Telescope not aligned";
-        response["ExpiredAt"] = QDateTime::currentDateTime().toSecsSinceEpoch();
+        response["ExpiredAt"] = m_telescopeState->clock->currentDateTime().toSecsSinceEpoch();
         response["SequenceID"] = sequenceId;
         response["Source"] = destination;
         response["Type"] = "Response";
@@ -285,8 +285,9 @@ void CommandHandler::handleSlew(const QJsonObject &obj, WebSocketConnection *wsC
         observer.lng = m_telescopeState->longitude;   // Longitude (negative for West)
         observer.lat = m_telescopeState->latitude;    // Latitude (positive for North)
 
-        // Get current Julian Date
-        double JD = ln_get_julian_from_sys();
+        // Get current Julian Date (simulated time, so time-warped runs stay consistent)
+        time_t simTime = static_cast<time_t>(m_telescopeState->clock->currentMSecsSinceEpoch() / 1000);
+        double JD = ln_get_julian_from_timet(&simTime);
 
         // Convert to Alt/Az
         struct ln_hrz_posn hrz_pos;
@@ -316,7 +317,7 @@ void CommandHandler::handleSlew(const QJsonObject &obj, WebSocketConnection *wsC
         response["Destination"] = source;
         response["ErrorCode"] = 0;
         response["ErrorMessage"] = "";
-        response["ExpiredAt"] = QDateTime::currentDateTime().toSecsSinceEpoch();
+        response["ExpiredAt"] = m_telescopeState->clock->currentDateTime().toSecsSinceEpoch();
         response["SequenceID"] = sequenceId;
         response["Source"] = destination;
         response["Type"] = "Response";
@@ -328,7 +329,7 @@ void CommandHandler::handleSlew(const QJsonObject &obj, WebSocketConnection *wsC
         response["Destination"] = source;
         response["ErrorCode"] = 1;
         response["ErrorMessage"] = "Telescope not aligned";
-        response["ExpiredAt"] = QDateTime::currentDateTime().toSecsSinceEpoch();
+        response["ExpiredAt"] = m_telescopeState->clock->currentDateTime().toSecsSinceEpoch();
         response["SequenceID"] = sequenceId;
         response["Source"] = destination;
         response["Type"] = "Response";
@@ -346,7 +347,7 @@ void CommandHandler::handleAbortAxisMovement(const QJsonObject &obj, WebSocketCo
     response["Destination"] = source;
     response["ErrorCode"] = 0;
     response["ErrorMessage"] = "";
-    response["ExpiredAt"] = QDateTime::currentDateTime().toSecsSinceEpoch();
+    response["ExpiredAt"] = m_telescopeState->clock->currentDateTime().toSecsSinceEpoch();
     response["SequenceID"] = sequenceId;
     response["Source"] = destination;
     response["Type"] = "Response";
@@ -362,7 +363,7 @@ void CommandHandler::handleStartTracking(const QJsonObject &obj, WebSocketConnec
     response["Destination"] = source;
     response["ErrorCode"] = 0;
     response["ErrorMessage"] = "";
-    response["ExpiredAt"] = QDateTime::currentDateTime().toSecsSinceEpoch();
+    response["ExpiredAt"] = m_telescopeState->clock->currentDateTime().toSecsSinceEpoch();
     response["SequenceID"] = sequenceId;
     response["Source"] = destination;
     response["Type"] = "Response";
@@ -378,7 +379,7 @@ void CommandHandler::handleStopTracking(const QJsonObject &obj, WebSocketConnect
     response["Destination"] = source;
     response["ErrorCode"] = 0;
     response["ErrorMessage"] = "";
-    response["ExpiredAt"] = QDateTime::currentDateTime().toSecsSinceEpoch();
+    response["ExpiredAt"] = m_telescopeState->clock->currentDateTime().toSecsSinceEpoch();
     response["SequenceID"] = sequenceId;
     response["Source"] = destination;
     response["Type"] = "Response";
@@ -397,7 +398,7 @@ void CommandHandler::handleRunImaging(const QJsonObject &obj, WebSocketConnectio
     response["Destination"] = source;
     response["ErrorCode"] = 0;
     response["ErrorMessage"] = "";
-    response["ExpiredAt"] = QDateTime::currentDateTime().toSecsSinceEpoch();
+    response["ExpiredAt"] = m_telescopeState->clock->currentDateTime().toSecsSinceEpoch();
     response["SequenceID"] = sequenceId;
     response["Source"] = destination;
     response["Type"] = "Response";
@@ -413,7 +414,7 @@ void CommandHandler::handleCancelImaging(const QJsonObject &obj, WebSocketConnec
     response["Destination"] = source;
     response["ErrorCode"] = 0;
     response["ErrorMessage"] = "";
-    response["ExpiredAt"] = QDateTime::currentDateTime().toSecsSinceEpoch();
+    response["ExpiredAt"] = m_telescopeState->clock->currentDateTime().toSecsSinceEpoch();
     response["SequenceID"] = sequenceId;
     response["Source"] = destination;
     response["Type"] = "Response";
@@ -423,14 +424,14 @@ void CommandHandler::handleCancelImaging(const QJsonObject &obj, WebSocketConnec
 
 void CommandHandler::handleMoveToPosition(const QJsonObject &obj, WebSocketConnection *wsConn, int sequenceId, const QString &source, const QString &destination) {
     int targetPosition = obj["Position"].toInt();
-    m_telescopeState->position = targetPosition;
+    m_telescopeState->moveFocuser(targetPosition);
     
     QJsonObject response;
     response["Command"] = "MoveToPosition";
     response["Destination"] = source;
     response["ErrorCode"] = 0;
     response["ErrorMessage"] = "";
-    response["ExpiredAt"] = QDateTime::currentDateTime().toSecsSinceEpoch();
+    response["ExpiredAt"] = m_telescopeState->clock->currentDateTime().toSecsSinceEpoch();
     response["SequenceID"] = sequenceId;
     response["Source"] = destination;
     response["Type"] = "Response";
@@ -496,7 +497,7 @@ void CommandHandler::handleSetCaptureParameters(const QJsonObject &obj, WebSocke
     response["Destination"] = source;
     response["ErrorCode"] = 0;
     response["ErrorMessage"] = "";
-    response["ExpiredAt"] = QDateTime::currentDateTime().toSecsSinceEpoch();
+    response["ExpiredAt"] = m_telescopeState->clock->currentDateTime().toSecsSinceEpoch();
     response["SequenceID"] = sequenceId;
     response["Source"] = destination;
     response["Type"] = "Response";
@@ -514,7 +515,7 @@ void CommandHandler::handleSetFocuserBacklash(const QJsonObject &obj, WebSocketC
     response["Destination"] = source;
     response["ErrorCode"] = 0;
     response["ErrorMessage"] = "";
-    response["ExpiredAt"] = QDateTime::currentDateTime().toSecsSinceEpoch();
+    response["ExpiredAt"] = m_telescopeState->clock->currentDateTime().toSecsSinceEpoch();
     response["SequenceID"] = sequenceId;
     response["Source"] = destination;
     response["Type"] = "Response";
@@ -538,7 +539,7 @@ void CommandHandler::handleSetDewHeaterMode(const QJsonObject &obj, WebSocketCon
     response["Destination"] = source;
     response["ErrorCode"] = 0;
     response["ErrorMessage"] = "";
-    response["ExpiredAt"] = QDateTime::currentDateTime().toSecsSinceEpoch();
+    response["ExpiredAt"] = m_telescopeState->clock->currentDateTime().toSecsSinceEpoch();
     response["SequenceID"] = sequenceId;
     response["Source"] = destination;
     response["Type"] = "Response";
@@ -553,7 +554,7 @@ void CommandHandler::handleGetSerialNumber(const QJsonObject &obj, WebSocketConn
     response["Destination"] = source;
     response["ErrorCode"] = 0;
     response["ErrorMessage"] = "";
-    response["ExpiredAt"] = QDateTime::currentDateTime().toSecsSinceEpoch();
+    response["ExpiredAt"] = m_telescopeState->clock->currentDateTime().toSecsSinceEpoch();
     response["SequenceID"] = sequenceId;
     response["Source"] = destination;
     response["Type"] = "Response";
@@ -568,7 +569,7 @@ void CommandHandler::handleHasUpdateAvailable(const QJsonObject &obj, WebSocketC
     response["Destination"] = source;
     response["ErrorCode"] = 0;
     response["ErrorMessage"] = "";
-    response["ExpiredAt"] = QDateTime::currentDateTime().toSecsSinceEpoch();
+    response["ExpiredAt"] = m_telescopeState->clock->currentDateTime().toSecsSinceEpoch();
     response["SequenceID"] = sequenceId;
     response["Source"] = destination;
     response["Type"] = "Response";
@@ -584,7 +585,7 @@ void CommandHandler::handleGetUpdateChannel(const QJsonObject &obj, WebSocketCon
     response["Destination"] = source;
     response["ErrorCode"] = 0;
     response["ErrorMessage"] = "";
-    response["ExpiredAt"] = QDateTime::currentDateTime().toSecsSinceEpoch();
+    response["ExpiredAt"] = m_telescopeState->clock->currentDateTime().toSecsSinceEpoch();
     response["SequenceID"] = sequenceId;
     response["Source"] = destination;
     response["Type"] = "Response";
@@ -602,7 +603,7 @@ void CommandHandler::handleSetRegulatoryDomain(const QJsonObject &obj, WebSocket
     response["Destination"] = source;
     response["ErrorCode"] = 0;
     response["ErrorMessage"] = "";
-    response["ExpiredAt"] = QDateTime::currentDateTime().toSecsSinceEpoch();
+    response["ExpiredAt"] = m_telescopeState->clock->currentDateTime().toSecsSinceEpoch();
     response["SequenceID"] = sequenceId;
     response["Source"] = destination;
     response["Type"] = "Response";
@@ -616,7 +617,7 @@ void CommandHandler::handleHasInternetConnection(const QJsonObject &obj, WebSock
     response["Destination"] = source;
     response["ErrorCode"] = 0;
     response["ErrorMessage"] = "";
-    response["ExpiredAt"] = QDateTime::currentDateTime().toSecsSinceEpoch();
+    response["ExpiredAt"] = m_telescopeState->clock->currentDateTime().toSecsSinceEpoch();
     response["SequenceID"] = sequenceId;
     response["Source"] = destination;
     response["Type"] = "Response";
@@ -631,7 +632,7 @@ void CommandHandler::handleGetForceDirectConnect(const QJsonObject &obj, WebSock
     response["Destination"] = source;
     response["ErrorCode"] = 0;
     response["ErrorMessage"] = "";
-    response["ExpiredAt"] = QDateTime::currentDateTime().toSecsSinceEpoch();
+    response["ExpiredAt"] = m_telescopeState->clock->currentDateTime().toSecsSinceEpoch();
     response["SequenceID"] = sequenceId;
     response["Source"] = destination;
     response["Type"] = "Response";
@@ -646,7 +647,7 @@ void CommandHandler::handleGetCameraInfo(const QJsonObject &obj, WebSocketConnec
     response["Destination"] = source;
     response["ErrorCode"] = 0;
     response["ErrorMessage"] = "";
-    response["ExpiredAt"] = QDateTime::currentDateTime().toSecsSinceEpoch();
+    response["ExpiredAt"] = m_telescopeState->clock->currentDateTime().toSecsSinceEpoch();
     response["SequenceID"] = sequenceId;
     response["Source"] = destination;
     response["Type"] = "Response";
@@ -665,7 +666,7 @@ void CommandHandler::handleGetSensors(const QJsonObject &obj, WebSocketConnectio
     response["Destination"] = source;
     response["ErrorCode"] = 0;
     response["ErrorMessage"] = "";
-    response["ExpiredAt"] = QDateTime::currentDateTime().toSecsSinceEpoch();
+    response["ExpiredAt"] = m_telescopeState->clock->currentDateTime().toSecsSinceEpoch();
     response["SequenceID"] = sequenceId;
     response["Source"] = destination;
     response["Type"] = "Response";
@@ -688,7 +689,7 @@ void CommandHandler::handleGetBrightnessLevel(const QJsonObject &obj, WebSocketC
     response["Destination"] = source;
     response["ErrorCode"] = 0;
     response["ErrorMessage"] = "";
-    response["ExpiredAt"] = QDateTime::currentDateTime().toSecsSinceEpoch();
+    response["ExpiredAt"] = m_telescopeState->clock->currentDateTime().toSecsSinceEpoch();
     response["SequenceID"] = sequenceId;
     response["Source"] = destination;
     response["Type"] = "Response";
@@ -703,7 +704,7 @@ void CommandHandler::handleGetFocuserAdvancedSettings(const QJsonObject &obj, We
     response["Destination"] = source;
     response["ErrorCode"] = 0;
     response["ErrorMessage"] = "";
-    response["ExpiredAt"] = QDateTime::currentDateTime().toSecsSinceEpoch();
+    response["ExpiredAt"] = m_telescopeState->clock->currentDateTime().toSecsSinceEpoch();
     response["SequenceID"] = sequenceId;
     response["Source"] = destination;
     response["Type"] = "Response";
@@ -721,7 +722,7 @@ void CommandHandler::handleGetMountConfig(const QJsonObject &obj, WebSocketConne
     response["Destination"] = source;
     response["ErrorCode"] = 0;
     response["ErrorMessage"] = "";
-    response["ExpiredAt"] = QDateTime::currentDateTime().toSecsSinceEpoch();
+    response["ExpiredAt"] = m_telescopeState->clock->currentDateTime().toSecsSinceEpoch();
     response["SequenceID"] = sequenceId;
     response["Source"] = destination;
     response["Type"] = "Response";
@@ -737,7 +738,7 @@ void CommandHandler::handleGetPositionLimits(const QJsonObject &obj, WebSocketCo
     response["Destination"] = source;
     response["ErrorCode"] = 0;
     response["ErrorMessage"] = "";
-    response["ExpiredAt"] = QDateTime::currentDateTime().toSecsSinceEpoch();
+    response["ExpiredAt"] = m_telescopeState->clock->currentDateTime().toSecsSinceEpoch();
     response["SequenceID"] = sequenceId;
     response["Source"] = destination;
     response["Type"] = "Response";
@@ -753,7 +754,7 @@ void CommandHandler::handleGetEnableManual(const QJsonObject &obj, WebSocketConn
     response["Destination"] = source;
     response["ErrorCode"] = 0;
     response["ErrorMessage"] = "";
-    response["ExpiredAt"] = QDateTime::currentDateTime().toSecsSinceEpoch();
+    response["ExpiredAt"] = m_telescopeState->clock->currentDateTime().toSecsSinceEpoch();
     response["SequenceID"] = sequenceId;
     response["Source"] = destination;
     response["Type"] = "Response";
@@ -768,7 +769,7 @@ void CommandHandler::handleGetFilter(const QJsonObject &obj, WebSocketConnection
     response["Destination"] = source;
     response["ErrorCode"] = 0;
     response["ErrorMessage"] = "";
-    response["ExpiredAt"] = QDateTime::currentDateTime().toSecsSinceEpoch();
+    response["ExpiredAt"] = m_telescopeState->clock->currentDateTime().toSecsSinceEpoch();
     response["SequenceID"] = sequenceId;
     response["Source"] = destination;
     response["Type"] = "Response";
@@ -783,7 +784,7 @@ void CommandHandler::handleGetDirectConnectPassword(const QJsonObject &obj, WebS
     response["Destination"] = source;
     response["ErrorCode"] = 0;
     response["ErrorMessage"] = "";
-    response["ExpiredAt"] = QDateTime::currentDateTime().toSecsSinceEpoch();
+    response["ExpiredAt"] = m_telescopeState->clock->currentDateTime().toSecsSinceEpoch();
     response["SequenceID"] = sequenceId;
     response["Source"] = destination;
     response["Type"] = "Response";
@@ -822,7 +823,7 @@ void CommandHandler::handleRunSampleCapture(const QJsonObject &obj, WebSocketCon
     response["Destination"] = source;
     response["ErrorCode"] = 0;
     response["ErrorMessage"] = "";
-    response["ExpiredAt"] = QDateTime::currentDateTime().toSecsSinceEpoch();
+    response["ExpiredAt"] = m_telescopeState->clock->currentDateTime().toSecsSinceEpoch();
     response["SequenceID"] = sequenceId;
     response["Source"] = destination;
     response["Type"] = "Response";
@@ -0,0 +1,135 @@
+#include "DiscoveryBroadcaster.h"
+#include <QDebug>
+#include <QNetworkInterface>
+#include <QTimer>
+#include <QUdpSocket>
+#if QT_VERSION >= QT_VERSION_CHECK(6, 3, 0)
+#include <QNetworkInformation>
+#endif
+
+// Fallback refresh when the platform gives no network change notifications
+static const int ADDRESS_REFRESH_MS = 60000;
+
+DiscoveryBroadcaster &DiscoveryBroadcaster::instance() {
+    static DiscoveryBroadcaster broadcaster;
+    return broadcaster;
+}
+
+void DiscoveryBroadcaster::ensureStarted() {
+    if (m_socket) return;
+
+    m_socket = new QUdpSocket();
+    m_timer = new QTimer();
+    QObject::connect(m_timer, &QTimer::timeout, [this]() { announceNext(); });
+
+#if QT_VERSION >= QT_VERSION_CHECK(6, 3, 0)
+    if (QNetworkInformation::loadDefaultBackend() && QNetworkInformation::instance()) {
+        m_changeNotifications = true;
+        QObject::connect(QNetworkInformation::instance(), &QNetworkInformation::reachabilityChanged,
+                         m_timer, [this]() { refreshAddresses(); });
+        QObject::connect(QNetworkInformation::instance(), &QNetworkInformation::transportMediumChanged,
+                         m_timer, [this]() { refreshAddresses(); });
+    }
+#endif
+
+    refreshAddresses();
+}
+
+int DiscoveryBroadcaster::addTelescope(const QString &identity, const QHostAddress &bindAddress, quint16 advertisedPort) {
+    ensureStarted();
+
+    Telescope telescope{m_nextHandle++, identity, bindAddress, advertisedPort, {}};
+    rebuildDatagrams(telescope);
+    m_telescopes.append(telescope);
+    reschedule();
+    return telescope.handle;
+}
+
+void DiscoveryBroadcaster::removeTelescope(int handle) {
+    for (int i = 0; i < m_telescopes.size(); ++i) {
+        if (m_telescopes[i].handle == handle) {
+            m_telescopes.removeAt(i);
+            if (m_nextIndex > i) --m_nextIndex;
+            break;
+        }
+    }
+
+    // Release the socket with the last telescope so nothing outlives the application object
+    if (m_telescopes.isEmpty() && m_socket) {
+        delete m_timer;
+        delete m_socket;
+        m_timer = nullptr;
+        m_socket = nullptr;
+        m_changeNotifications = false;
+        return;
+    }
+    reschedule();
+}
+
+void DiscoveryBroadcaster::announceNow(int handle) {
+    for (const Telescope &telescope : m_telescopes) {
+        if (telescope.handle == handle) sendDatagrams(telescope);
+    }
+}
+
+void DiscoveryBroadcaster::refreshAddresses() {
+    QList<QHostAddress> addresses;
+    for (const QHostAddress &address : QNetworkInterface::allAddresses()) {
+        if (address.protocol() == QAbstractSocket::IPv4Protocol && address != QHostAddress::LocalHost) {
+            addresses.append(address);
+        }
+    }
+    m_addressAge.start();
+
+    if (addresses == m_addresses) return;
+    m_addresses = addresses;
+    for (Telescope &telescope : m_telescopes) {
+        rebuildDatagrams(telescope);
+    }
+}
+
+void DiscoveryBroadcaster::rebuildDatagrams(Telescope &telescope) {
+    QString message = QString("Identity:") + telescope.identity + QString(" Origin IP Address = %1");
+
+    // Non-standard ports only happen in fleet mode; advertise them so clients can connect
+    if (telescope.advertisedPort != 0) {
+        message += QString(" Port = %1").arg(telescope.advertisedPort);
+    }
+
+    // A virtual-IP instance only announces its own address
+    QList<QHostAddress> addresses = m_addresses;
+    if (telescope.bindAddress.protocol() == QAbstractSocket::IPv4Protocol) {
+        addresses = {telescope.bindAddress};
+    }
+
+    telescope.datagrams.clear();
+    for (const QHostAddress &address : addresses) {
+        QString broadcastMessage = message.arg(address.toString());
+        if (true) qDebug() << broadcastMessage;
+        telescope.datagrams.append(broadcastMessage.toUtf8());
+    }
+}
+
+void DiscoveryBroadcaster::sendDatagrams(const Telescope &telescope) {
+    for (const QByteArray &datagram : telescope.datagrams) {
+        m_socket->writeDatagram(datagram, QHostAddress::Broadcast, BROADCAST_PORT);
+    }
+}
+
+void DiscoveryBroadcaster::announceNext() {
+    if (m_telescopes.isEmpty()) return;
+
+    // Refresh at the start of a cycle only, so one cycle never mixes address lists
+    if (m_nextIndex == 0 && !m_changeNotifications && m_addressAge.elapsed() > ADDRESS_REFRESH_MS) {
+        refreshAddresses();
+    }
+
+    if (m_nextIndex >= m_telescopes.size()) m_nextIndex = 0;
+    sendDatagrams(m_telescopes[m_nextIndex]);
+    m_nextIndex = (m_nextIndex + 1) % m_telescopes.size();
+}
+
+void DiscoveryBroadcaster::reschedule() {
+    // Every telescope still announces once per BROADCAST_INTERVAL, staggered across it
+    m_timer->start(qMax(1, BROADCAST_INTERVAL / int(m_telescopes.size())));
+}
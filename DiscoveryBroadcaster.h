@@ -0,0 +1,71 @@
+#ifndef DISCOVERYBROADCASTER_H
+#define DISCOVERYBROADCASTER_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QHostAddress>
+#include <QList>
+#include <QString>
+
+class QTimer;
+class QUdpSocket;
+
+const int BROADCAST_PORT = 55555;
+const int BROADCAST_INTERVAL = 5000; // milliseconds
+
+/**
+ * @brief Announces every simulated telescope in the process on UDP port 55555
+ *
+ * One socket and one timer serve all telescopes. The IPv4 interface list is
+ * cached and only re-read when Qt reports a network change (or once a minute
+ * where no change notifications are available), and each telescope's
+ * "Identity:Origin-NNZ Origin IP Address = ..." datagrams are built once per
+ * address list. Announcements are spread evenly over BROADCAST_INTERVAL, so a
+ * fleet of 100 telescopes sends one burst every 50 ms instead of 100 at once.
+ */
+class DiscoveryBroadcaster {
+public:
+    static DiscoveryBroadcaster &instance();
+
+    /**
+     * @param identity Origin-NNZ name
+     * @param bindAddress Announce only this address (virtual-IP instances); null for all interfaces
+     * @param advertisedPort Appended as " Port = N" when non-zero
+     * @return Handle for announceNow() and removeTelescope()
+     */
+    int addTelescope(const QString &identity, const QHostAddress &bindAddress, quint16 advertisedPort);
+    void removeTelescope(int handle);
+
+    // Sends one telescope's datagrams immediately (first announcement after start-up)
+    void announceNow(int handle);
+
+    // Re-reads the interface list and rebuilds every datagram
+    void refreshAddresses();
+
+private:
+    struct Telescope {
+        int handle;
+        QString identity;
+        QHostAddress bindAddress;
+        quint16 advertisedPort;
+        QList<QByteArray> datagrams;
+    };
+
+    DiscoveryBroadcaster() = default;
+    void ensureStarted();
+    void rebuildDatagrams(Telescope &telescope);
+    void sendDatagrams(const Telescope &telescope);
+    void announceNext();
+    void reschedule();
+
+    QList<Telescope> m_telescopes;
+    QList<QHostAddress> m_addresses;      // Cached non-loopback IPv4 addresses
+    QElapsedTimer m_addressAge;
+    bool m_changeNotifications = false;
+    int m_nextHandle = 1;
+    int m_nextIndex = 0;
+    QUdpSocket *m_socket = nullptr;
+    QTimer *m_timer = nullptr;
+};
+
+#endif // DISCOVERYBROADCASTER_H
@@ -1,5 +1,7 @@
 #include "EnhancedMosaicCreator.h"
 #include "MessierCatalog.h"
+#include "SimulatorMetrics.h"
+#include "Tracer.h"
 
 EnhancedMosaicCreator::EnhancedMosaicCreator(QObject *parent)  // CHANGED: QObject parent
     : QObject(parent) {  // CHANGED: QObject constructor
@@ -102,7 +104,10 @@ void EnhancedMosaicCreator::processNextTile() {
     }
     
     SimpleTile& tile = m_tiles[m_currentTileIndex];
-    if (checkExistingTile(tile)) {
+    bool cached = checkExistingTile(tile);
+    SimulatorMetrics::instance().increment("origin_hips_tile_cache_total",
+                                           SimulatorMetrics::label("result", cached ? "hit" : "miss"));
+    if (cached) {
         if (false) qDebug() << QString("Reusing tile %1/%2: Grid(%3,%4) HEALPix %5")
                     .arg(m_currentTileIndex).arg(m_tiles.size())
                     .arg(tile.gridX).arg(tile.gridY)
@@ -157,8 +162,12 @@ void EnhancedMosaicCreator::onTileDownloaded() {
         if (!tile.image.isNull()) {
             bool saved = tile.image.save(tile.filename);
             tile.downloaded = true;
+            sharedTileCache().insert(tile.filename, new QImage(tile.image),
+                                     qMax<qsizetype>(1, tile.image.sizeInBytes() / 1024));
             
             qint64 downloadTime = m_downloadStartTime.msecsTo(QDateTime::currentDateTime());
+            SimulatorMetrics::instance().observe("origin_hips_tile_fetch_seconds", downloadTime / 1000.0);
+            Tracer::recordSpan("hips.tileFetch", Tracer::nowNs() - downloadTime * 1000000, downloadTime * 1000000);
             if (false) qDebug() << QString("✅ Tile %1/%2 downloaded: %3ms, %4 bytes, %5x%6 pixels%7")
                         .arg(tileIndex + 1).arg(m_tiles.size())
                         .arg(downloadTime).arg(imageData.size())
@@ -177,6 +186,7 @@ void EnhancedMosaicCreator::onTileDownloaded() {
 }
 
 void EnhancedMosaicCreator::assembleFinalMosaicCentered() {
+    TRACE_SCOPE("mosaic.assemble");
     QString targetName = m_customTarget.name;
     
     if (false) qDebug() << QString("\n=== Assembling Coordinate-Centered %1 Mosaic ===").arg(targetName);
@@ -425,18 +435,34 @@ double EnhancedMosaicCreator::calculateAngularDistance(const SkyPosition& pos1,
     return c; // Return in radians
 }
 
+QCache<QString, QImage>& EnhancedMosaicCreator::sharedTileCache() {
+    // Cost is in KB; 256 MB holds ~250 decoded 512x512 tiles
+    static QCache<QString, QImage> cache(256 * 1024);
+    return cache;
+}
+
 bool EnhancedMosaicCreator::checkExistingTile(const SimpleTile& tile) {
+    SimpleTile* mutableTile = const_cast<SimpleTile*>(&tile);
+    
+    // Another simulator in this process may already have decoded this tile
+    if (QImage* cached = sharedTileCache().object(tile.filename)) {
+        mutableTile->image = *cached;
+        mutableTile->downloaded = true;
+        return true;
+    }
+    
     QFileInfo fileInfo(tile.filename);
     if (!fileInfo.exists() || fileInfo.size() < 1024) return false;
     
     if (!isValidJpeg(tile.filename)) return false;
     
-    SimpleTile* mutableTile = const_cast<SimpleTile*>(&tile);
     mutableTile->image.load(tile.filename);
     
     if (mutableTile->image.isNull()) return false;
     
     mutableTile->downloaded = true;
+    sharedTileCache().insert(tile.filename, new QImage(mutableTile->image),
+                             qMax<qsizetype>(1, mutableTile->image.sizeInBytes() / 1024));
     return true;
 }
 
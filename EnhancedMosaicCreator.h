@@ -30,6 +30,7 @@
 #include <QScrollArea>
 #include <QSplitter>
 #include <QTextStream>
+#include <QCache>
 #include <cmath>
 #include <limits>
 #include "ProperHipsClient.h"
@@ -131,6 +132,8 @@ private slots:
     void processNextTile();
 
 private:
+    friend class OriginBench;
+    
     ProperHipsClient* m_hipsClient;
     QNetworkAccessManager* m_networkManager;
     
@@ -152,6 +155,9 @@ private:
     
     QList<SimpleTile> m_tiles;
     int m_currentTileIndex;
+    
+    // Decoded tiles shared by every creator in the process (fleet mode), keyed by filename
+    static QCache<QString, QImage>& sharedTileCache();
     QString m_outputDir;
     QDateTime m_downloadStartTime;
     
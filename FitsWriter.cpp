@@ -0,0 +1,214 @@
+#include "FitsWriter.h"
+#include "FrameBufferPool.h"
+#include "Tracer.h"
+#include <QDebug>
+#include <QIODevice>
+#include <QtEndian>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <tiffio.h>
+
+static const int CARD_SIZE = 80;
+static const int BLOCK_RECORDS = 64;    // Records per socket write, ~180 KB
+static const qint64 BLOCK_BYTES = qint64(FitsWriter::RECORD_SIZE) * BLOCK_RECORDS;
+
+static void appendCard(QByteArray &out, const char *keyword, const QByteArray &value,
+                       const char *comment = nullptr) {
+    QByteArray card = QByteArray(keyword).leftJustified(8, ' ', true);
+    if (!value.isNull()) {
+        // Fixed format: value indicator in columns 9-10, value right-justified to column 30
+        card += "= " + (value.startsWith('\'') ? value.leftJustified(20) : value.rightJustified(20));
+        if (comment) card += QByteArray(" / ") + comment;
+    }
+    out += card.leftJustified(CARD_SIZE, ' ', true);
+}
+
+static QByteArray fitsString(const QString &text) {
+    QByteArray value = text.toLatin1().replace('\'', "''");
+    return "'" + value.leftJustified(8) + "'";
+}
+
+static QByteArray fitsReal(double value) {
+    return QByteArray::number(value, 'E', 12);
+}
+
+static QByteArray fitsInt(qint64 value) {
+    return QByteArray::number(value);
+}
+
+static qint64 padded(qint64 size) {
+    return (size + FitsWriter::RECORD_SIZE - 1) / FitsWriter::RECORD_SIZE * FitsWriter::RECORD_SIZE;
+}
+
+QByteArray FitsWriter::header(int width, int height, int planes, const Metadata &metadata) {
+    QByteArray out;
+    out.reserve(RECORD_SIZE * 2);
+
+    appendCard(out, "SIMPLE", "T", "Standard FITS");
+    appendCard(out, "BITPIX", fitsInt(16), "16-bit samples");
+    appendCard(out, "NAXIS", fitsInt(planes > 1 ? 3 : 2));
+    appendCard(out, "NAXIS1", fitsInt(width));
+    appendCard(out, "NAXIS2", fitsInt(height));
+    if (planes > 1) appendCard(out, "NAXIS3", fitsInt(planes), "R, G, B planes");
+    appendCard(out, "BZERO", fitsInt(32768), "Unsigned 16-bit data");
+    appendCard(out, "BSCALE", fitsInt(1));
+    const bool bayer = planes == 1;
+    appendCard(out, "ROWORDER", fitsString(bayer ? "TOP-DOWN" : "BOTTOM-UP"));
+    if (bayer) {
+        appendCard(out, "BAYERPAT", fitsString("RGGB"), "Colour filter array");
+        appendCard(out, "XBAYROFF", fitsInt(0));
+        appendCard(out, "YBAYROFF", fitsInt(0));
+    }
+
+    appendCard(out, "TELESCOP", fitsString("Celestron Origin"));
+    appendCard(out, "INSTRUME", fitsString("OriginSimulator"));
+    appendCard(out, "DATE-OBS", fitsString(metadata.dateObs.toUTC().toString("yyyy-MM-dd'T'HH:mm:ss.zzz")), "UTC");
+    appendCard(out, "EXPTIME", fitsReal(metadata.exposure), "Seconds");
+    appendCard(out, "ISOSPEED", fitsInt(metadata.iso));
+
+    // Gnomonic WCS about the image centre; RA grows to the left (east left)
+    const double degrees = 180.0 / M_PI;
+    double scaleX = metadata.fovX * degrees / width;
+    double scaleY = metadata.fovY * degrees / height;
+    double c = std::cos(metadata.orientation);
+    double s = std::sin(metadata.orientation);
+    if (bayer) scaleY = -scaleY;    // Top-down rows flip the y axis
+
+    appendCard(out, "RA", fitsReal(metadata.ra * degrees), "Degrees");
+    appendCard(out, "DEC", fitsReal(metadata.dec * degrees), "Degrees");
+    appendCard(out, "EQUINOX", fitsReal(2000.0));
+    appendCard(out, "RADESYS", fitsString("ICRS"));
+    appendCard(out, "CTYPE1", fitsString("RA---TAN"));
+    appendCard(out, "CTYPE2", fitsString("DEC--TAN"));
+    appendCard(out, "CUNIT1", fitsString("deg"));
+    appendCard(out, "CUNIT2", fitsString("deg"));
+    appendCard(out, "CRVAL1", fitsReal(metadata.ra * degrees));
+    appendCard(out, "CRVAL2", fitsReal(metadata.dec * degrees));
+    appendCard(out, "CRPIX1", fitsReal((width + 1) / 2.0));
+    appendCard(out, "CRPIX2", fitsReal((height + 1) / 2.0));
+    appendCard(out, "CD1_1", fitsReal(-scaleX * c));
+    appendCard(out, "CD1_2", fitsReal(scaleY * s));
+    appendCard(out, "CD2_1", fitsReal(scaleX * s));
+    appendCard(out, "CD2_2", fitsReal(scaleY * c));
+    appendCard(out, "END", QByteArray());
+
+    return out.leftJustified(int(padded(out.size())), ' ');
+}
+
+qint64 FitsWriter::dataSize(int width, int height, int planes) {
+    return padded(qint64(width) * height * planes * 2);
+}
+
+// Opens a 16-bit contiguous TIFF with one or three samples per pixel
+static TIFF *openCapture(const QString &tiffPath, uint32_t *width, uint32_t *height, uint16_t *planes) {
+    TIFF *tif = TIFFOpen(tiffPath.toUtf8().constData(), "r");
+    if (!tif) return nullptr;
+
+    uint16_t bits = 0;
+    uint16_t planar = PLANARCONFIG_CONTIG;
+    TIFFGetField(tif, TIFFTAG_IMAGEWIDTH, width);
+    TIFFGetField(tif, TIFFTAG_IMAGELENGTH, height);
+    TIFFGetFieldDefaulted(tif, TIFFTAG_BITSPERSAMPLE, &bits);
+    TIFFGetFieldDefaulted(tif, TIFFTAG_SAMPLESPERPIXEL, planes);
+    TIFFGetFieldDefaulted(tif, TIFFTAG_PLANARCONFIG, &planar);
+
+    if (bits != 16 || (*planes != 1 && *planes != 3) || planar != PLANARCONFIG_CONTIG || TIFFIsTiled(tif)) {
+        qWarning() << "FITS conversion needs a 16-bit strip TIFF with 1 or 3 samples:" << tiffPath;
+        TIFFClose(tif);
+        return nullptr;
+    }
+    return tif;
+}
+
+bool FitsWriter::fromTiff(const QString &tiffPath, const Metadata &metadata, Image *image) {
+    TRACE_SCOPE("fits.convert");
+    uint32_t width = 0, height = 0;
+    uint16_t planes = 0;
+    TIFF *tif = openCapture(tiffPath, &width, &height, &planes);
+    if (!tif) return false;
+
+    uint32_t rowsPerStrip = height;
+    TIFFGetFieldDefaulted(tif, TIFFTAG_ROWSPERSTRIP, &rowsPerStrip);
+    rowsPerStrip = qMin(rowsPerStrip, height);
+
+    const qint64 size = dataSize(int(width), int(height), planes);
+    FrameLease strip = FrameBufferPool::instance().acquire(size_t(TIFFStripSize(tif)));
+    FrameLease data = FrameBufferPool::instance().acquire(size_t(size));
+    if (strip.isNull() || data.isNull()) {
+        TIFFClose(tif);
+        return false;
+    }
+
+    // Each decoded row lands in its row of every plane at once, flipped to
+    // big-endian and offset by BZERO. Colour rows run bottom-up; a Bayer
+    // mosaic keeps sensor order so the RGGB phase is unchanged
+    const size_t planeBytes = size_t(width) * height * 2;
+    const bool bottomUp = planes > 1;
+    const tstrip_t stripCount = TIFFNumberOfStrips(tif);
+    for (tstrip_t s = 0; s < stripCount; s++) {
+        if (TIFFReadEncodedStrip(tif, s, strip.data(), tmsize_t(-1)) < 0) {
+            qWarning() << "Failed to read TIFF strip" << s << "of" << tiffPath;
+            TIFFClose(tif);
+            return false;
+        }
+
+        uint32_t firstRow = s * rowsPerStrip;
+        uint32_t rows = qMin(rowsPerStrip, height - firstRow);
+        for (uint32_t r = 0; r < rows; r++) {
+            uint32_t y = firstRow + r;
+            const uint16_t *row = strip.samples16() + size_t(r) * width * planes;
+            uchar *dst = data.data() + size_t(bottomUp ? height - 1 - y : y) * width * 2;
+            for (uint16_t plane = 0; plane < planes; plane++, dst += planeBytes) {
+                for (uint32_t x = 0; x < width; x++) {
+                    qToBigEndian<quint16>(quint16(row[size_t(x) * planes + plane] ^ 0x8000), dst + size_t(x) * 2);
+                }
+            }
+        }
+    }
+    TIFFClose(tif);
+
+    // Zero-fill the last record; pooled buffers come back dirty
+    memset(data.data() + planeBytes * planes, 0, size_t(size) - planeBytes * planes);
+
+    image->header = header(int(width), int(height), planes, metadata);
+    image->data = std::move(data);
+    return true;
+}
+
+void FitsWriter::stream(Image image, QIODevice *out, std::function<void()> finished) {
+    // Shared so the bytesWritten handler can own the move-only lease
+    struct Transfer {
+        Image image;
+        qint64 offset = 0;
+        std::function<void()> finished;
+        QMetaObject::Connection drained;
+    };
+    auto transfer = std::make_shared<Transfer>();
+    transfer->image = std::move(image);
+    transfer->finished = std::move(finished);
+    out->write(transfer->image.header);
+
+    // Keep at most one block queued on out, so a slow client holds back the
+    // conversion buffer rather than 37 MB of socket buffer
+    auto sendNext = [transfer, out]() {
+        if (!transfer->finished || out->bytesToWrite() > BLOCK_BYTES) return;
+        const qint64 size = qint64(transfer->image.data.size());
+        if (transfer->offset < size) {
+            // Advance first: devices without a write buffer emit bytesWritten from inside write()
+            const qint64 offset = transfer->offset;
+            const qint64 length = qMin(BLOCK_BYTES, size - offset);
+            transfer->offset += length;
+            out->write(reinterpret_cast<const char *>(transfer->image.data.data()) + offset, length);
+            return;
+        }
+
+        QObject::disconnect(transfer->drained);
+        transfer->image.data.release();
+        std::function<void()> finished = std::move(transfer->finished);
+        transfer->finished = nullptr;
+        finished();
+    };
+    transfer->drained = QObject::connect(out, &QIODevice::bytesWritten, out, sendNext);
+    sendNext();
+}
@@ -0,0 +1,59 @@
+#ifndef FITSWRITER_H
+#define FITSWRITER_H
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QString>
+#include <functional>
+#include "FrameBufferPool.h"
+
+class QIODevice;
+
+/**
+ * @brief Streams captures as 16-bit FITS for INDI/Siril/astrometry tooling
+ *
+ * Pixels are BITPIX = 16 with BZERO = 32768 (the FITS way of storing unsigned
+ * 16-bit), planes in R, G, B order for colour captures, rows bottom-up so the
+ * image displays the same way round as the TIFF. Raw Bayer captures (one
+ * plane) stay top-down with BAYERPAT = 'RGGB', the convention INDI and Siril
+ * debayer from. The header carries a TAN WCS built from the pointing at
+ * capture time.
+ *
+ * Everything is produced in whole 2880-byte FITS records: the header is
+ * padded with spaces, the data with zeros. Each TIFF strip is decoded once and
+ * scattered into its rows of every plane in a pooled buffer, which stream()
+ * then hands to the socket a block at a time as it drains.
+ */
+class FitsWriter {
+public:
+    static const int RECORD_SIZE = 2880;
+
+    struct Metadata {
+        double ra = 0.0;            // Radians, J2000
+        double dec = 0.0;           // Radians
+        double fovX = 0.0;          // Radians across the full width
+        double fovY = 0.0;          // Radians across the full height
+        double orientation = 0.0;   // Radians, position angle of image up
+        double exposure = 0.0;      // Seconds
+        int iso = 0;
+        QDateTime dateObs;
+    };
+
+    struct Image {
+        QByteArray header;
+        FrameLease data;            // dataSize() bytes, ready to send
+        qint64 size() const { return header.size() + qint64(data.size()); }
+    };
+
+    // Header records (padded) for a width x height image: 1 plane = RGGB mosaic, 3 = RGB
+    static QByteArray header(int width, int height, int planes, const Metadata &metadata);
+    static qint64 dataSize(int width, int height, int planes);
+
+    // Converts a 16-bit TIFF capture, reading each strip once; false if it cannot be read
+    static bool fromTiff(const QString &tiffPath, const Metadata &metadata, Image *image);
+
+    // Writes image to out a block at a time, each once out has drained the last, then calls finished
+    static void stream(Image image, QIODevice *out, std::function<void()> finished);
+};
+
+#endif // FITSWRITER_H
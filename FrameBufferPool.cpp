@@ -0,0 +1,96 @@
+#include "FrameBufferPool.h"
+#include "SimulatorMetrics.h"
+#include "TiffImageGenerator.h"
+#include <QMutexLocker>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+
+FrameLease::FrameLease(FrameLease &&other) noexcept
+    : m_data(std::exchange(other.m_data, nullptr)), m_size(std::exchange(other.m_size, 0)) {
+}
+
+FrameLease &FrameLease::operator=(FrameLease &&other) noexcept {
+    if (this != &other) {
+        release();
+        m_data = std::exchange(other.m_data, nullptr);
+        m_size = std::exchange(other.m_size, 0);
+    }
+    return *this;
+}
+
+QImage FrameLease::image(int width, int height, QImage::Format format) const {
+    qsizetype bytesPerLine = (qsizetype(width) * QImage::toPixelFormat(format).bitsPerPixel() + 7) / 8;
+    if (!m_data || size_t(bytesPerLine) * size_t(height) > m_size) return QImage();
+    return QImage(m_data, width, height, bytesPerLine, format);
+}
+
+void FrameLease::release() {
+    if (!m_data) return;
+    FrameBufferPool::instance().giveBack(m_data, m_size);
+    m_data = nullptr;
+    m_size = 0;
+}
+
+FrameBufferPool &FrameBufferPool::instance() {
+    static FrameBufferPool pool;
+    return pool;
+}
+
+FrameBufferPool::~FrameBufferPool() {
+    for (const QVector<uchar *> &buffers : std::as_const(m_idle)) {
+        for (uchar *data : buffers) {
+            std::free(data);
+        }
+    }
+}
+
+size_t FrameBufferPool::bytesFor(Format format) {
+    const size_t pixels = size_t(TiffImageGenerator::IMAGE_WIDTH) * TiffImageGenerator::IMAGE_HEIGHT;
+    switch (format) {
+        case RGB16: return pixels * 3 * sizeof(uint16_t);
+        case RGB8: return pixels * 3;
+        case Mono16: return pixels * sizeof(uint16_t);
+    }
+    return 0;
+}
+
+FrameLease FrameBufferPool::acquire(Format format) {
+    return acquire(bytesFor(format));
+}
+
+FrameLease FrameBufferPool::acquire(size_t bytes) {
+    if (bytes == 0) return FrameLease();
+
+    {
+        QMutexLocker locker(&m_mutex);
+        auto it = m_idle.find(bytes);
+        if (it != m_idle.end() && !it->isEmpty()) {
+            uchar *data = it->takeLast();
+            locker.unlock();
+            SimulatorMetrics::instance().increment("origin_frame_pool_total", SimulatorMetrics::label("result", "hit"));
+            return FrameLease(data, bytes);
+        }
+    }
+
+    // aligned_alloc wants the size rounded up to the alignment
+    size_t allocated = (bytes + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+    uchar *data = static_cast<uchar *>(std::aligned_alloc(ALIGNMENT, allocated));
+    if (!data) return FrameLease();
+
+    // Fault every page in now rather than in the middle of a render
+    std::memset(data, 0, allocated);
+    SimulatorMetrics::instance().increment("origin_frame_pool_total", SimulatorMetrics::label("result", "miss"));
+    return FrameLease(data, bytes);
+}
+
+void FrameBufferPool::giveBack(uchar *data, size_t size) {
+    QMutexLocker locker(&m_mutex);
+    QVector<uchar *> &idle = m_idle[size];
+    if (idle.size() < MAX_IDLE_PER_SIZE || size_t(idle.size() + 1) * size <= MAX_IDLE_SMALL_BYTES) {
+        idle.append(data);
+        return;
+    }
+    locker.unlock();
+    std::free(data);
+}
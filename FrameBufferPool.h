@@ -0,0 +1,90 @@
+#ifndef FRAMEBUFFERPOOL_H
+#define FRAMEBUFFERPOOL_H
+
+#include <QImage>
+#include <QMap>
+#include <QMutex>
+#include <QVector>
+#include <cstddef>
+#include <cstdint>
+
+class FrameBufferPool;
+
+/**
+ * @brief RAII lease on a pooled buffer; the buffer goes back to the pool when the lease dies
+ *
+ * Move-only. A default-constructed or moved-from lease holds nothing.
+ */
+class FrameLease {
+public:
+    FrameLease() = default;
+    ~FrameLease() { release(); }
+
+    FrameLease(FrameLease &&other) noexcept;
+    FrameLease &operator=(FrameLease &&other) noexcept;
+    FrameLease(const FrameLease &) = delete;
+    FrameLease &operator=(const FrameLease &) = delete;
+
+    bool isNull() const { return !m_data; }
+    size_t size() const { return m_size; }
+    uchar *data() const { return m_data; }
+    uint16_t *samples16() const { return reinterpret_cast<uint16_t *>(m_data); }
+
+    // Non-owning QImage over the buffer; valid only while the lease is held
+    QImage image(int width, int height, QImage::Format format) const;
+
+    void release();
+
+private:
+    friend class FrameBufferPool;
+    FrameLease(uchar *data, size_t size) : m_data(data), m_size(size) {}
+
+    uchar *m_data = nullptr;
+    size_t m_size = 0;
+};
+
+/**
+ * @brief Process-wide pool of pre-faulted, 64-byte-aligned image buffers
+ *
+ * Full-resolution frames are tens of MB, big enough that malloc hands them
+ * straight to mmap and every capture pays for the munmap and the page faults
+ * again. Buffers here are zeroed once when first allocated (faulting every
+ * page in) and then recycled by size, so steady-state capture does no large
+ * allocations. Contents are not cleared between leases.
+ *
+ * Up to MAX_IDLE_PER_SIZE idle buffers of each size are kept, or more for
+ * small sizes (TIFF strips) while they fit in MAX_IDLE_SMALL_BYTES; extra
+ * ones are freed on release. Safe to use from worker threads.
+ */
+class FrameBufferPool {
+public:
+    enum Format {
+        RGB16,      // Interleaved 16-bit RGB, the capture TIFF layout
+        RGB8,       // QImage::Format_RGB888
+        Mono16      // Single 16-bit plane
+    };
+
+    static const size_t ALIGNMENT = 64;
+    static const int MAX_IDLE_PER_SIZE = 2;
+    static const size_t MAX_IDLE_SMALL_BYTES = 8 * 1024 * 1024;
+
+    static FrameBufferPool &instance();
+
+    // A sensor-sized (3056x2048) buffer in the given layout
+    FrameLease acquire(Format format);
+    FrameLease acquire(size_t bytes);
+
+    static size_t bytesFor(Format format);
+
+private:
+    friend class FrameLease;
+
+    FrameBufferPool() = default;
+    ~FrameBufferPool();
+    void giveBack(uchar *data, size_t size);
+
+    QMutex m_mutex;
+    QMap<size_t, QVector<uchar *>> m_idle;
+};
+
+#endif // FRAMEBUFFERPOOL_H
@@ -0,0 +1,95 @@
+#include "HttpRequest.h"
+
+static const int MAX_HEADERS = 64;
+
+static bool isSpace(char c) {
+    return c == ' ' || c == '\t';
+}
+
+static QByteArrayView trimmed(QByteArrayView view) {
+    qsizetype begin = 0;
+    qsizetype end = view.size();
+    while (begin < end && isSpace(view[begin])) ++begin;
+    while (end > begin && isSpace(view[end - 1])) --end;
+    return view.sliced(begin, end - begin);
+}
+
+static char toLowerAscii(char c) {
+    return (c >= 'A' && c <= 'Z') ? char(c + ('a' - 'A')) : c;
+}
+
+bool HttpRequest::equalsIgnoreCase(QByteArrayView a, QByteArrayView b) {
+    if (a.size() != b.size()) return false;
+    for (qsizetype i = 0; i < a.size(); ++i) {
+        if (toLowerAscii(a[i]) != toLowerAscii(b[i])) return false;
+    }
+    return true;
+}
+
+HttpRequest::ParseResult HttpRequest::parse(const QByteArray &buffer) {
+    m_headers.clear();
+    m_query = QByteArrayView();
+    m_headLength = 0;
+
+    const char *data = buffer.constData();
+    const qsizetype size = buffer.size();
+    qsizetype lineStart = 0;
+    bool requestLine = true;
+
+    for (qsizetype i = 0; i + 1 < size; ++i) {
+        if (data[i] != '\r' || data[i + 1] != '\n') continue;
+
+        QByteArrayView line(data + lineStart, i - lineStart);
+        qsizetype next = i + 2;
+
+        if (requestLine) {
+            // METHOD SP request-target SP HTTP-version
+            qsizetype firstSpace = line.indexOf(' ');
+            qsizetype lastSpace = line.lastIndexOf(' ');
+            if (firstSpace <= 0 || lastSpace <= firstSpace + 1) return Invalid;
+            m_method = line.first(firstSpace);
+            m_path = line.sliced(firstSpace + 1, lastSpace - firstSpace - 1);
+            qsizetype question = m_path.indexOf('?');
+            if (question >= 0) {
+                m_query = m_path.sliced(question + 1);
+                m_path = m_path.first(question);
+            }
+            m_version = line.sliced(lastSpace + 1);
+            requestLine = false;
+        } else if (line.isEmpty()) {
+            m_headLength = next;
+            return Complete;
+        } else {
+            qsizetype colon = line.indexOf(':');
+            if (colon <= 0 || m_headers.size() >= MAX_HEADERS) return Invalid;
+            m_headers.append({line.first(colon), trimmed(line.sliced(colon + 1))});
+        }
+
+        lineStart = next;
+        i = next - 1;
+    }
+
+    return Incomplete;
+}
+
+QByteArrayView HttpRequest::header(QByteArrayView name) const {
+    for (const Header &header : m_headers) {
+        if (equalsIgnoreCase(header.name, name)) return header.value;
+    }
+    return QByteArrayView();
+}
+
+bool HttpRequest::headerHasToken(QByteArrayView name, QByteArrayView token) const {
+    for (const Header &header : m_headers) {
+        if (!equalsIgnoreCase(header.name, name)) continue;
+
+        QByteArrayView value = header.value;
+        while (!value.isEmpty()) {
+            qsizetype comma = value.indexOf(',');
+            QByteArrayView item = comma < 0 ? value : value.first(comma);
+            if (equalsIgnoreCase(trimmed(item), token)) return true;
+            value = comma < 0 ? QByteArrayView() : value.sliced(comma + 1);
+        }
+    }
+    return false;
+}
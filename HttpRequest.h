@@ -0,0 +1,54 @@
+#ifndef HTTPREQUEST_H
+#define HTTPREQUEST_H
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QVarLengthArray>
+
+/**
+ * @brief Single-pass HTTP/1.1 request-head parser
+ *
+ * parse() walks the buffer once and records the method, target, version and
+ * every header as views into that buffer; nothing is copied or converted to
+ * QString. The buffer must stay alive and unmodified while the views are used.
+ * Header names compare case-insensitively, as HTTP requires.
+ */
+class HttpRequest {
+public:
+    enum ParseResult { Incomplete, Complete, Invalid };
+
+    struct Header {
+        QByteArrayView name;
+        QByteArrayView value;     // Leading and trailing whitespace removed
+    };
+
+    ParseResult parse(const QByteArray &buffer);
+
+    QByteArrayView method() const { return m_method; }
+    // Request target up to the first '?', and what follows it (null if there is no '?')
+    QByteArrayView path() const { return m_path; }
+    QByteArrayView query() const { return m_query; }
+    QByteArrayView version() const { return m_version; }
+
+    // Size of the request head including the blank line
+    qsizetype headLength() const { return m_headLength; }
+
+    // First header with this name, or a null view
+    QByteArrayView header(QByteArrayView name) const;
+    const QVarLengthArray<Header, 16> &headers() const { return m_headers; }
+
+    // True when a comma-separated header (Connection, Upgrade) lists token, case-insensitively
+    bool headerHasToken(QByteArrayView name, QByteArrayView token) const;
+
+    static bool equalsIgnoreCase(QByteArrayView a, QByteArrayView b);
+
+private:
+    QByteArrayView m_method;
+    QByteArrayView m_path;
+    QByteArrayView m_query;
+    QByteArrayView m_version;
+    QVarLengthArray<Header, 16> m_headers;
+    qsizetype m_headLength = 0;
+};
+
+#endif // HTTPREQUEST_H
@@ -0,0 +1,54 @@
+#include "HttpRouter.h"
+
+void HttpRouter::addRoute(const QByteArray &method, QByteArrayView pattern, Match match,
+                          const QString &name, Handler handler) {
+    int node = 0;
+    for (char c : pattern) {
+        int next = child(node, c);
+        if (next < 0) {
+            next = int(m_nodes.size());
+            m_nodes.emplace_back();
+            m_nodes[size_t(node)].children.append({c, next});
+        }
+        node = next;
+    }
+
+    int index = int(m_routes.size());
+    m_routes.push_back({method, match, name, std::move(handler)});
+    if (match == Exact) {
+        m_nodes[size_t(node)].exactRoutes.append(index);
+    } else {
+        m_nodes[size_t(node)].prefixRoutes.append(index);
+    }
+}
+
+int HttpRouter::child(int node, char c) const {
+    for (const auto &entry : m_nodes[size_t(node)].children) {
+        if (entry.first == c) return entry.second;
+    }
+    return -1;
+}
+
+const HttpRouter::Route *HttpRouter::select(const QVarLengthArray<int, 1> &routes, QByteArrayView method) const {
+    for (int index : routes) {
+        const Route &route = m_routes[size_t(index)];
+        if (route.method.isEmpty() || route.method == method) return &route;
+    }
+    return nullptr;
+}
+
+const HttpRouter::Route *HttpRouter::find(QByteArrayView method, QByteArrayView path) const {
+    const Route *longestPrefix = select(m_nodes[0].prefixRoutes, method);
+
+    int node = 0;
+    for (char c : path) {
+        node = child(node, c);
+        if (node < 0) return longestPrefix;
+        if (const Route *route = select(m_nodes[size_t(node)].prefixRoutes, method)) {
+            longestPrefix = route;
+        }
+    }
+
+    if (const Route *route = select(m_nodes[size_t(node)].exactRoutes, method)) return route;
+    return longestPrefix;
+}
@@ -0,0 +1,57 @@
+#ifndef HTTPROUTER_H
+#define HTTPROUTER_H
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QPair>
+#include <QString>
+#include <QVarLengthArray>
+#include <functional>
+#include <vector>
+
+#include "HttpRequest.h"
+
+class QTcpSocket;
+
+/**
+ * @brief Byte-wise prefix trie mapping request paths to handlers
+ *
+ * Routes are either Exact (the whole path) or Prefix (the path starts with the
+ * pattern). A lookup walks the path once, so its cost depends on the path
+ * length rather than on how many routes are registered. Exact matches win;
+ * otherwise the longest matching prefix does. An empty method matches any.
+ */
+class HttpRouter {
+public:
+    enum Match { Exact, Prefix };
+
+    using Handler = std::function<void(QTcpSocket *socket, const HttpRequest &request, const QString &path)>;
+
+    struct Route {
+        QByteArray method;
+        Match match;
+        QString name;               // Reported as the metrics "route" label
+        Handler handler;
+    };
+
+    void addRoute(const QByteArray &method, QByteArrayView pattern, Match match,
+                  const QString &name, Handler handler);
+
+    // Null when nothing matches
+    const Route *find(QByteArrayView method, QByteArrayView path) const;
+
+private:
+    struct Node {
+        QVarLengthArray<QPair<char, int>, 4> children;
+        QVarLengthArray<int, 1> exactRoutes;
+        QVarLengthArray<int, 1> prefixRoutes;
+    };
+
+    int child(int node, char c) const;
+    const Route *select(const QVarLengthArray<int, 1> &routes, QByteArrayView method) const;
+
+    std::vector<Node> m_nodes = std::vector<Node>(1);
+    std::vector<Route> m_routes;
+};
+
+#endif // HTTPROUTER_H
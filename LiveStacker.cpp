@@ -0,0 +1,226 @@
+#include "LiveStacker.h"
+#include "FrameBufferPool.h"
+#include "SensorNoise.h"
+#include "Tracer.h"
+#include <QDebug>
+#include <algorithm>
+#include <cmath>
+#if defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+LiveStacker::Mode LiveStacker::s_defaultMode = LiveStacker::Mean;
+
+bool LiveStacker::parseMode(const QString &name, Mode *mode) {
+    const QString value = name.toLower();
+    if (value == "mean") *mode = Mean;
+    else if (value == "sigma" || value == "sigmaclip") *mode = SigmaClip;
+    else return false;
+    return true;
+}
+
+void LiveStacker::begin(Mode mode, int samplesPerPixel, std::vector<TiffImageGenerator::Star> stars,
+                        float clipSigma) {
+    const size_t samples = size_t(TiffImageGenerator::IMAGE_WIDTH) * TiffImageGenerator::IMAGE_HEIGHT * samplesPerPixel;
+
+    m_mode = mode;
+    m_samplesPerPixel = samplesPerPixel;
+    m_clipSigma = clipSigma;
+    m_frames = 0;
+    m_stars = std::move(stars);
+    m_mean.assign(samples, 0.0f);
+    if (mode == SigmaClip) {
+        m_m2.assign(samples, 0.0f);
+        m_kept.assign(samples, 0.0f);
+    } else {
+        std::vector<float>().swap(m_m2);
+        std::vector<float>().swap(m_kept);
+    }
+}
+
+void LiveStacker::end() {
+    std::vector<float>().swap(m_mean);
+    std::vector<float>().swap(m_m2);
+    std::vector<float>().swap(m_kept);
+    m_stars.clear();
+    m_frames = 0;
+}
+
+bool LiveStacker::captureSub(const SensorNoise &noise) {
+    TRACE_SCOPE("stack.sub");
+    if (!isActive()) return false;
+
+    FrameLease frame = FrameBufferPool::instance().acquire(
+        m_samplesPerPixel == 1 ? FrameBufferPool::Mono16 : FrameBufferPool::RGB16);
+    if (frame.isNull()) return false;
+
+    // Same scene every sub, fresh noise
+    uint16_t *samples = frame.samples16();
+    std::fill(samples, samples + m_mean.size(), uint16_t(0));
+    TiffImageGenerator::drawStars(m_stars, samples, 0, TiffImageGenerator::IMAGE_HEIGHT, m_samplesPerPixel);
+    noise.applyFrame(samples, m_samplesPerPixel);
+
+    setExpectedNoise(noise);
+    addFrame(samples);
+    return true;
+}
+
+void LiveStacker::setExpectedNoise(const SensorNoise &noise) {
+    m_noisePerAdu = noise.gain();
+    m_noiseFloor = noise.readVarianceAdu();
+}
+
+void LiveStacker::addFrame(const uint16_t *frame) {
+    TRACE_SCOPE("stack.fold");
+    m_frames++;
+
+    if (m_mode == SigmaClip) {
+        ClipLimits limits;
+        limits.sigma2 = m_clipSigma * m_clipSigma;
+        limits.minKept = float(MIN_FRAMES_TO_CLIP);
+        limits.noisePerAdu = m_noisePerAdu;
+        limits.noiseFloor = m_noiseFloor;
+        foldClipped(m_mean.data(), m_m2.data(), m_kept.data(), frame, m_mean.size(), limits);
+    } else {
+        foldMean(m_mean.data(), frame, m_mean.size(), 1.0f / float(m_frames));
+    }
+}
+
+void LiveStacker::foldMean(float *mean, const uint16_t *frame, size_t count, float invN) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128 scale = _mm_set1_ps(invN);
+    for (; i + 8 <= count; i += 8) {
+        __m128i raw = _mm_loadu_si128(reinterpret_cast<const __m128i *>(frame + i));
+        __m128 lo = _mm_cvtepi32_ps(_mm_unpacklo_epi16(raw, zero));
+        __m128 hi = _mm_cvtepi32_ps(_mm_unpackhi_epi16(raw, zero));
+        __m128 meanLo = _mm_loadu_ps(mean + i);
+        __m128 meanHi = _mm_loadu_ps(mean + i + 4);
+        _mm_storeu_ps(mean + i, _mm_add_ps(meanLo, _mm_mul_ps(_mm_sub_ps(lo, meanLo), scale)));
+        _mm_storeu_ps(mean + i + 4, _mm_add_ps(meanHi, _mm_mul_ps(_mm_sub_ps(hi, meanHi), scale)));
+    }
+#elif defined(__ARM_NEON)
+    const float32x4_t scale = vdupq_n_f32(invN);
+    for (; i + 8 <= count; i += 8) {
+        uint16x8_t raw = vld1q_u16(frame + i);
+        float32x4_t lo = vcvtq_f32_u32(vmovl_u16(vget_low_u16(raw)));
+        float32x4_t hi = vcvtq_f32_u32(vmovl_u16(vget_high_u16(raw)));
+        float32x4_t meanLo = vld1q_f32(mean + i);
+        float32x4_t meanHi = vld1q_f32(mean + i + 4);
+        vst1q_f32(mean + i, vmlaq_f32(meanLo, vsubq_f32(lo, meanLo), scale));
+        vst1q_f32(mean + i + 4, vmlaq_f32(meanHi, vsubq_f32(hi, meanHi), scale));
+    }
+#endif
+    for (; i < count; i++) {
+        mean[i] += (float(frame[i]) - mean[i]) * invN;
+    }
+}
+
+void LiveStacker::foldClipped(float *mean, float *m2, float *kept, const uint16_t *frame, size_t count,
+                              const ClipLimits &limits) {
+    // Each position keeps its own count, so a clipped sample leaves its mean, m2 and count as they
+    // were. With n kept, a sample goes in when n < minKept or
+    //   delta^2 * (n - 1) <= k^2 * max(m2, floor(mean) * (n - 1))
+    const float bias = float(SensorNoise::BIAS_ADU);
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 sigma2 = _mm_set1_ps(limits.sigma2);
+    const __m128 minKept = _mm_set1_ps(limits.minKept);
+    const __m128 perAdu = _mm_set1_ps(limits.noisePerAdu);
+    const __m128 floorV = _mm_set1_ps(limits.noiseFloor);
+    const __m128 biasV = _mm_set1_ps(bias);
+    auto fold4 = [&](__m128 x, float *meanPtr, float *m2Ptr, float *keptPtr) {
+        __m128 oldMean = _mm_loadu_ps(meanPtr);
+        __m128 oldM2 = _mm_loadu_ps(m2Ptr);
+        __m128 n = _mm_loadu_ps(keptPtr);
+        __m128 dof = _mm_sub_ps(n, one);
+        __m128 delta = _mm_sub_ps(x, oldMean);
+        __m128 expected = _mm_add_ps(_mm_mul_ps(perAdu, _mm_max_ps(_mm_sub_ps(oldMean, biasV), _mm_setzero_ps())),
+                                     floorV);
+        __m128 spread = _mm_max_ps(oldM2, _mm_mul_ps(expected, dof));
+        __m128 keep = _mm_or_ps(_mm_cmplt_ps(n, minKept),
+                                _mm_cmple_ps(_mm_mul_ps(_mm_mul_ps(delta, delta), dof), _mm_mul_ps(sigma2, spread)));
+        n = _mm_add_ps(n, _mm_and_ps(keep, one));
+        delta = _mm_and_ps(delta, keep);
+        __m128 newMean = _mm_add_ps(oldMean, _mm_div_ps(delta, n));
+        _mm_storeu_ps(meanPtr, newMean);
+        _mm_storeu_ps(m2Ptr, _mm_add_ps(oldM2, _mm_mul_ps(delta, _mm_sub_ps(x, newMean))));
+        _mm_storeu_ps(keptPtr, n);
+    };
+    for (; i + 8 <= count; i += 8) {
+        __m128i raw = _mm_loadu_si128(reinterpret_cast<const __m128i *>(frame + i));
+        fold4(_mm_cvtepi32_ps(_mm_unpacklo_epi16(raw, zero)), mean + i, m2 + i, kept + i);
+        fold4(_mm_cvtepi32_ps(_mm_unpackhi_epi16(raw, zero)), mean + i + 4, m2 + i + 4, kept + i + 4);
+    }
+#elif defined(__ARM_NEON)
+    const float32x4_t one = vdupq_n_f32(1.0f);
+    const float32x4_t sigma2 = vdupq_n_f32(limits.sigma2);
+    const float32x4_t minKept = vdupq_n_f32(limits.minKept);
+    const float32x4_t perAdu = vdupq_n_f32(limits.noisePerAdu);
+    const float32x4_t floorV = vdupq_n_f32(limits.noiseFloor);
+    const float32x4_t biasV = vdupq_n_f32(bias);
+    auto fold4 = [&](float32x4_t x, float *meanPtr, float *m2Ptr, float *keptPtr) {
+        float32x4_t oldMean = vld1q_f32(meanPtr);
+        float32x4_t oldM2 = vld1q_f32(m2Ptr);
+        float32x4_t n = vld1q_f32(keptPtr);
+        float32x4_t dof = vsubq_f32(n, one);
+        float32x4_t delta = vsubq_f32(x, oldMean);
+        float32x4_t expected = vmlaq_f32(floorV, perAdu, vmaxq_f32(vsubq_f32(oldMean, biasV), vdupq_n_f32(0.0f)));
+        float32x4_t spread = vmaxq_f32(oldM2, vmulq_f32(expected, dof));
+        uint32x4_t keep = vorrq_u32(vcltq_f32(n, minKept),
+                                    vcleq_f32(vmulq_f32(vmulq_f32(delta, delta), dof), vmulq_f32(sigma2, spread)));
+        n = vaddq_f32(n, vreinterpretq_f32_u32(vandq_u32(keep, vreinterpretq_u32_f32(one))));
+        delta = vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(delta), keep));
+        // 1 / n to full float precision: estimate plus two Newton steps (AArch32 has no vector divide)
+        float32x4_t inv = vrecpeq_f32(n);
+        inv = vmulq_f32(inv, vrecpsq_f32(n, inv));
+        inv = vmulq_f32(inv, vrecpsq_f32(n, inv));
+        float32x4_t newMean = vmlaq_f32(oldMean, delta, inv);
+        vst1q_f32(meanPtr, newMean);
+        vst1q_f32(m2Ptr, vmlaq_f32(oldM2, delta, vsubq_f32(x, newMean)));
+        vst1q_f32(keptPtr, n);
+    };
+    for (; i + 8 <= count; i += 8) {
+        uint16x8_t raw = vld1q_u16(frame + i);
+        fold4(vcvtq_f32_u32(vmovl_u16(vget_low_u16(raw))), mean + i, m2 + i, kept + i);
+        fold4(vcvtq_f32_u32(vmovl_u16(vget_high_u16(raw))), mean + i + 4, m2 + i + 4, kept + i + 4);
+    }
+#endif
+    for (; i < count; i++) {
+        float x = float(frame[i]);
+        float n = kept[i];
+        float dof = n - 1.0f;
+        float delta = x - mean[i];
+        if (n >= limits.minKept) {
+            float expected = limits.noisePerAdu * std::max(mean[i] - bias, 0.0f) + limits.noiseFloor;
+            if (delta * delta * dof > limits.sigma2 * std::max(m2[i], expected * dof)) continue;
+        }
+        kept[i] = n + 1.0f;
+        mean[i] += delta / kept[i];
+        m2[i] += delta * (x - mean[i]);
+    }
+}
+
+bool LiveStacker::writeMaster(const QString &path) const {
+    TRACE_SCOPE("stack.writeMaster");
+    if (!isActive()) return false;
+
+    const int width = TiffImageGenerator::IMAGE_WIDTH;
+    const int spp = m_samplesPerPixel;
+    const float *mean = m_mean.data();
+
+    return TiffImageGenerator::writeTiff16BitStrips(path, width, TiffImageGenerator::IMAGE_HEIGHT, spp,
+                                                    [=](uint16_t *dst, int firstRow, int rowCount) {
+        const float *src = mean + size_t(firstRow) * width * spp;
+        size_t count = size_t(rowCount) * width * spp;
+        for (size_t i = 0; i < count; i++) {
+            dst[i] = uint16_t(qBound(0.0f, src[i] + 0.5f, 65535.0f));
+        }
+        return true;
+    });
+}
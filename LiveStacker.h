@@ -0,0 +1,86 @@
+#ifndef LIVESTACKER_H
+#define LIVESTACKER_H
+
+#include <QString>
+#include <vector>
+
+#include "TiffImageGenerator.h"
+
+class SensorNoise;
+
+/**
+ * @brief Renders sub-exposures of a fixed star field and folds them into a running stack
+ *
+ * Mirrors what the real Origin does during RunImaging: every sub is the same
+ * scene with fresh sensor noise, and after each one the stack so far is
+ * published.
+ * The stack is a 32-bit float running mean per sample (plus, in sigma-clip
+ * mode, a running sum of squared deviations by Welford's method and a count
+ * of the samples kept), so memory is the same for 3 subs or 3000. In
+ * sigma-clip mode, once a position has MIN_FRAMES_TO_CLIP samples, a sample
+ * further than clipSigma standard deviations from its mean is dropped from
+ * that sub (satellite trails, cosmic rays; hot pixels sit still and stay).
+ * The deviation used is never below what the sensor noise model predicts for
+ * that mean, so a position whose first few samples happened to agree does
+ * not lock out the rest.
+ *
+ * Folding runs 8 samples at a time with SSE2 or NEON where available.
+ */
+class LiveStacker {
+public:
+    enum Mode { Mean, SigmaClip };
+
+    static const int MIN_FRAMES_TO_CLIP = 5;
+
+    // Default for every stack started afterwards
+    static void setDefaultMode(Mode mode) { s_defaultMode = mode; }
+    static Mode defaultMode() { return s_defaultMode; }
+    static bool parseMode(const QString &name, Mode *mode);
+
+    // Allocates the accumulators; samplesPerPixel is 3 for RGB or 1 for a raw Bayer mosaic
+    void begin(Mode mode, int samplesPerPixel, std::vector<TiffImageGenerator::Star> stars,
+               float clipSigma = 3.0f);
+    void end();                     // Frees the accumulators
+    bool isActive() const { return !m_mean.empty(); }
+    int frameCount() const { return m_frames; }
+
+    // Renders one sub of the scene, reads it out through noise and folds it in
+    bool captureSub(const SensorNoise &noise);
+    void addFrame(const uint16_t *frame);
+
+    // Noise floor for clipping frames passed to addFrame (captureSub sets it from its noise)
+    void setExpectedNoise(const SensorNoise &noise);
+
+    // Current stack, rounded back to 16 bits
+    bool writeMaster(const QString &path) const;
+
+private:
+    friend class OriginBench;
+
+    // Variance floor is noisePerAdu * (mean - BIAS_ADU) + noiseFloor, in ADU^2
+    struct ClipLimits {
+        float sigma2;
+        float minKept;
+        float noisePerAdu;
+        float noiseFloor;
+    };
+
+    static void foldMean(float *mean, const uint16_t *frame, size_t count, float invN);
+    static void foldClipped(float *mean, float *m2, float *kept, const uint16_t *frame, size_t count,
+                            const ClipLimits &limits);
+
+    static Mode s_defaultMode;
+
+    Mode m_mode = Mean;
+    int m_samplesPerPixel = TiffImageGenerator::SAMPLES_PER_PIXEL;
+    float m_clipSigma = 3.0f;
+    int m_frames = 0;
+    float m_noisePerAdu = 0.0f;
+    float m_noiseFloor = 0.0f;
+    std::vector<TiffImageGenerator::Star> m_stars;
+    std::vector<float> m_mean;
+    std::vector<float> m_m2;        // Sum of squared deviations, sigma-clip mode only
+    std::vector<float> m_kept;      // Samples folded in per position, sigma-clip mode only
+};
+
+#endif // LIVESTACKER_H
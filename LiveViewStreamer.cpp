@@ -0,0 +1,95 @@
+#include "LiveViewStreamer.h"
+#include "SimulatorMetrics.h"
+#include "WebSocketConnection.h"
+#include <QDateTime>
+#include <QDebug>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QtEndian>
+#include <cstring>
+
+static const int MAX_FRAME_RATE = 60;
+
+LiveViewStreamer::LiveViewStreamer(FrameSource frameSource)
+    : m_frameSource(std::move(frameSource)) {
+}
+
+LiveViewStreamer::~LiveViewStreamer() {
+    for (Subscription &subscription : m_subscriptions) {
+        delete subscription.timer;
+    }
+}
+
+void LiveViewStreamer::subscribe(WebSocketConnection *connection, int frameRate) {
+    frameRate = qBound(1, frameRate, MAX_FRAME_RATE);
+
+    Subscription &subscription = m_subscriptions[connection];
+    subscription.connection = connection;
+    if (!subscription.timer) {
+        subscription.timer = new QTimer();
+        subscription.timer->setTimerType(Qt::PreciseTimer);
+        QObject::connect(subscription.timer, &QTimer::timeout, [this, connection]() {
+            if (Subscription *live = liveSubscription(connection)) sendFrame(*live);
+        });
+        // A frame held back for a busy socket goes out as soon as the previous one has drained
+        QObject::connect(connection->socket(), &QTcpSocket::bytesWritten, subscription.timer, [this, connection]() {
+            if (Subscription *live = liveSubscription(connection)) flushPending(*live);
+        });
+    }
+    subscription.timer->start(1000 / frameRate);
+
+    if (false) qDebug() << "Live stream started at" << frameRate << "fps";
+}
+
+void LiveViewStreamer::unsubscribe(WebSocketConnection *connection) {
+    auto it = m_subscriptions.find(connection);
+    if (it == m_subscriptions.end()) return;
+
+    // May run from inside the timer's own timeout, so don't delete it synchronously
+    it->timer->stop();
+    it->timer->deleteLater();
+    m_subscriptions.erase(it);
+}
+
+LiveViewStreamer::Subscription *LiveViewStreamer::liveSubscription(WebSocketConnection *connection) {
+    auto it = m_subscriptions.find(connection);
+    if (it == m_subscriptions.end()) return nullptr;
+    if (!it->connection) {
+        unsubscribe(connection);
+        return nullptr;
+    }
+    return &it.value();
+}
+
+void LiveViewStreamer::sendFrame(Subscription &subscription) {
+    quint64 generation = 0;
+    QByteArray jpeg = m_frameSource(&generation);
+    if (!jpeg.isEmpty() && !(subscription.hasFrame && generation == subscription.generation)) {
+        subscription.hasFrame = true;
+        subscription.generation = generation;
+
+        // The socket never took the last frame; this fresher one goes in its place
+        if (!subscription.pending.isEmpty()) {
+            SimulatorMetrics::instance().increment("origin_live_stream_frames_total",
+                                                   SimulatorMetrics::label("result", "dropped"));
+        }
+        subscription.pending = jpeg;
+    }
+    flushPending(subscription);
+}
+
+void LiveViewStreamer::flushPending(Subscription &subscription) {
+    WebSocketConnection *connection = subscription.connection;
+    if (subscription.pending.isEmpty() || connection->bytesToWrite() > 0) return;
+
+    QByteArray message(16, Qt::Uninitialized);
+    memcpy(message.data(), "OLV1", 4);
+    qToBigEndian<quint32>(subscription.sequence++, message.data() + 4);
+    qToBigEndian<qint64>(QDateTime::currentMSecsSinceEpoch(), message.data() + 8);
+    message.append(subscription.pending);
+    subscription.pending.clear();
+
+    connection->sendBinaryMessage(message);
+    SimulatorMetrics::instance().increment("origin_live_stream_frames_total",
+                                           SimulatorMetrics::label("result", "sent"));
+}
@@ -0,0 +1,58 @@
+#ifndef LIVEVIEWSTREAMER_H
+#define LIVEVIEWSTREAMER_H
+
+#include <QByteArray>
+#include <QMap>
+#include <QPointer>
+#include <functional>
+
+class QTimer;
+class WebSocketConnection;
+
+/**
+ * @brief Pushes live-view JPEGs as binary WebSocket messages on the control connection
+ *
+ * An experimental alternative to polling /SmartScope-1.0/dev2/Images/Temp/ over
+ * a fresh HTTP connection per frame. A client opts in with
+ *   {"Command":"StartLiveStream","Destination":"Simulator","FrameRate":15}
+ * and from then on receives each new live-view image, checked once per tick:
+ *
+ *   "OLV1" | sequence (u32 BE) | send time, ms since epoch (i64 BE) | JPEG bytes
+ *
+ * Latest frame wins, so a slow client never falls behind: a subscription holds
+ * at most one frame the socket has not taken yet, a newer image replaces it
+ * (counted as a drop), and it is handed over once the previous one has drained.
+ */
+class LiveViewStreamer {
+public:
+    // Returns the current JPEG and sets *generation to a number that changes whenever the JPEG does
+    using FrameSource = std::function<QByteArray(quint64 *generation)>;
+
+    explicit LiveViewStreamer(FrameSource frameSource);
+    ~LiveViewStreamer();
+
+    // frameRate is clamped to 1..60 frames per second
+    void subscribe(WebSocketConnection *connection, int frameRate);
+    void unsubscribe(WebSocketConnection *connection);
+    bool isSubscribed(WebSocketConnection *connection) const { return m_subscriptions.contains(connection); }
+
+private:
+    struct Subscription {
+        QPointer<WebSocketConnection> connection;
+        QTimer *timer = nullptr;
+        quint32 sequence = 0;
+        bool hasFrame = false;
+        quint64 generation = 0;    // Of the newest frame taken from the source
+        QByteArray pending;        // JPEG not yet handed to the socket
+    };
+
+    // Null (and unsubscribed) once the connection has gone away
+    Subscription *liveSubscription(WebSocketConnection *connection);
+    void sendFrame(Subscription &subscription);
+    void flushPending(Subscription &subscription);
+
+    FrameSource m_frameSource;
+    QMap<WebSocketConnection *, Subscription> m_subscriptions;
+};
+
+#endif // LIVEVIEWSTREAMER_H
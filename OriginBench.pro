@@ -0,0 +1,63 @@
+QT += core gui widgets network
+
+CONFIG += console c++17
+CONFIG -= app_bundle
+
+TARGET = OriginBench
+TEMPLATE = app
+INCLUDEPATH += healpixmirror/src/cxx/Healpix_cxx
+INCLUDEPATH += healpixmirror/src/cxx/cxxsupport
+LIBS += -lnova -ltiff -lz
+INCLUDEPATH += /opt/homebrew/include
+LIBPATH += /opt/homebrew/lib
+
+# Benchmarks link the simulator's kernels directly, without its main()
+SOURCES += \
+    main_bench.cpp \
+    WebSocketConnection.cpp \
+    CommandHandler.cpp \
+    StatusSender.cpp \
+    TiffImageGenerator.cpp \
+    FrameBufferPool.cpp \
+    SensorNoise.cpp \
+    StarCatalog.cpp \
+    PsfAtlas.cpp \
+    LiveStacker.cpp \
+    ProperHipsClient.cpp \
+    EnhancedMosaicCreator.cpp \
+    SimulationClock.cpp \
+    SessionLog.cpp \
+    SimulatorMetrics.cpp \
+    Tracer.cpp \
+    HttpRequest.cpp \
+    healpixmirror/src/cxx/Healpix_cxx/healpix_base.cc \
+    healpixmirror/src/cxx/Healpix_cxx/healpix_tables.cc \
+    healpixmirror/src/cxx/cxxsupport/geom_utils.cc \
+    healpixmirror/src/cxx/cxxsupport/string_utils.cc \
+    healpixmirror/src/cxx/cxxsupport/error_handling.cc \
+    healpixmirror/src/cxx/cxxsupport/pointing.cc \
+    moc_CommandHandler.cpp \
+    moc_EnhancedMosaicCreator.cpp \
+    moc_ProperHipsClient.cpp \
+    moc_StatusSender.cpp \
+    moc_WebSocketConnection.cpp
+
+HEADERS += \
+    WebSocketConnection.h \
+    CommandHandler.h \
+    StatusSender.h \
+    TiffImageGenerator.h \
+    FrameBufferPool.h \
+    SensorNoise.h \
+    StarCatalog.h \
+    PsfAtlas.h \
+    LiveStacker.h \
+    SimulationClock.h \
+    SessionLog.h \
+    SimulatorMetrics.h \
+    HttpRequest.h \
+    Tracer.h
+
+# Optimised build even from a debug Qt kit, otherwise the numbers are meaningless
+CONFIG += release
+CONFIG -= debug
@@ -0,0 +1,16 @@
+QT += core network
+QT -= gui
+
+CONFIG += console c++17
+CONFIG -= app_bundle
+
+TARGET = OriginLoadGen
+TEMPLATE = app
+
+# Headless WebSocket/HTTP load generator for OriginSimulator
+SOURCES += \
+    main_loadgen.cpp \
+    WebSocketClient.cpp
+
+HEADERS += \
+    WebSocketClient.h
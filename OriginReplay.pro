@@ -0,0 +1,18 @@
+QT += core network
+QT -= gui
+
+CONFIG += console c++17
+CONFIG -= app_bundle
+
+TARGET = OriginReplay
+TEMPLATE = app
+
+# Replays a session log recorded with OriginSimulator --record
+SOURCES += \
+    main_replay.cpp \
+    SessionLog.cpp \
+    WebSocketClient.cpp
+
+HEADERS += \
+    SessionLog.h \
+    WebSocketClient.h
@@ -6,7 +6,7 @@ TARGET = OriginSimulator
 TEMPLATE = app
 INCLUDEPATH += healpixmirror/src/cxx/Healpix_cxx
 INCLUDEPATH += healpixmirror/src/cxx/cxxsupport
-LIBS += -lnova -ltiff
+LIBS += -lnova -ltiff -lz
 # For Apple Silicon Macs, use:
 INCLUDEPATH += /opt/homebrew/include
 LIBPATH += /opt/homebrew/lib
@@ -18,9 +18,24 @@ SOURCES += \
     WebSocketConnection.cpp \
     CommandHandler.cpp \
     TiffImageGenerator.cpp \
+    FrameBufferPool.cpp \
+    SensorNoise.cpp \
+    StarCatalog.cpp \
+    PsfAtlas.cpp \
+    FitsWriter.cpp \
+    LiveStacker.cpp \
     StatusSender.cpp \
     ProperHipsClient.cpp \
     EnhancedMosaicCreator.cpp \
+    SimulatorFleet.cpp \
+    SimulationClock.cpp \
+    SessionLog.cpp \
+    SimulatorMetrics.cpp \
+    Tracer.cpp \
+    LiveViewStreamer.cpp \
+    DiscoveryBroadcaster.cpp \
+    HttpRequest.cpp \
+    HttpRouter.cpp \
     healpixmirror/src/cxx/Healpix_cxx/healpix_base.cc \
     healpixmirror/src/cxx/Healpix_cxx/healpix_tables.cc \
     healpixmirror/src/cxx/cxxsupport/geom_utils.cc \
@@ -41,7 +56,22 @@ HEADERS += \
     WebSocketConnection.h \
     CommandHandler.h \
     TiffImageGenerator.h \
+    FrameBufferPool.h \
+    SensorNoise.h \
+    StarCatalog.h \
+    PsfAtlas.h \
+    FitsWriter.h \
+    LiveStacker.h \
     StatusSender.h \
+    SimulatorFleet.h \
+    SimulationClock.h \
+    SessionLog.h \
+    SimulatorMetrics.h \
+    Tracer.h \
+    LiveViewStreamer.h \
+    DiscoveryBroadcaster.h \
+    HttpRequest.h \
+    HttpRouter.h \
     moc_predefs.h \
 
 # For Xcode project generation
@@ -0,0 +1,336 @@
+#include "PsfAtlas.h"
+#include "Tracer.h"
+#include <algorithm>
+#include <cmath>
+#if defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+static const int MIN_SUPERSAMPLE = 3;               // Per axis, per pixel
+static const float SUPERSAMPLE_SPACING = 0.125f;    // Widest sub-sample step, in FWHMs
+static const float FWHM_PER_SIGMA = 2.35482f;
+static const float REACH_ADU = 1.0f / 16;           // Faintest light a part still blits
+
+PsfAtlas::Profile PsfAtlas::s_defaultProfile = PsfAtlas::Moffat;
+
+bool PsfAtlas::parseProfile(const QString &name, Profile *profile) {
+    const QString value = name.toLower();
+    if (value == "gaussian") *profile = Gaussian;
+    else if (value == "moffat") *profile = Moffat;
+    else return false;
+    return true;
+}
+
+PsfAtlas &PsfAtlas::instance(Profile profile) {
+    static PsfAtlas gaussian(Gaussian);
+    static PsfAtlas moffat(Moffat);
+    return profile == Gaussian ? gaussian : moffat;
+}
+
+PsfAtlas::PsfAtlas(Profile profile) : m_profile(profile) {
+    for (int i = 0; i < WIDTHS; i++) {
+        Width &width = m_widths[i];
+        width.fwhm = MIN_FWHM * std::pow(2.0f, i / 4.0f);
+
+        // Distance at which the next width's profile falls to CUTOFF, plus a pixel for the sub-pixel
+        // shift; a star mixing the two then blends both over the same rows and columns
+        const float outerFwhm = MIN_FWHM * std::pow(2.0f, std::min(i + 1, WIDTHS - 1) / 4.0f);
+        float reach;
+        if (profile == Gaussian) {
+            reach = outerFwhm / FWHM_PER_SIGMA * std::sqrt(2.0f * std::log(1.0f / CUTOFF));
+        } else {
+            float alpha = outerFwhm / (2.0f * std::sqrt(std::pow(2.0f, 1.0f / MOFFAT_BETA) - 1.0f));
+            reach = alpha * std::sqrt(std::pow(CUTOFF, -1.0f / MOFFAT_BETA) - 1.0f);
+        }
+        width.radius = int(std::ceil(reach)) + 1;
+        width.size = 2 * width.radius + 1;
+        width.phases = width.fwhm <= PHASED_FWHM_MAX ? PHASES : 1;
+    }
+}
+
+void PsfAtlas::bracket(float fwhm, int *lower, int *upper, float *upperShare) {
+    float step = 4.0f * std::log2(std::max(fwhm, MIN_FWHM) / MIN_FWHM);
+    *lower = std::min(int(step), WIDTHS - 1);
+    *upper = std::min(*lower + 1, WIDTHS - 1);
+    if (*upper == *lower) {
+        *upperShare = 0.0f;
+        return;
+    }
+    // Linear in FWHM, so the mix's half-flux radius is too
+    float lowerFwhm = MIN_FWHM * std::pow(2.0f, *lower / 4.0f);
+    float upperFwhm = MIN_FWHM * std::pow(2.0f, *upper / 4.0f);
+    *upperShare = std::min(1.0f, std::max(0.0f, (fwhm - lowerFwhm) / (upperFwhm - lowerFwhm)));
+}
+
+int PsfAtlas::radiusFor(float fwhm) const {
+    int lower, upper;
+    float upperShare;
+    bracket(fwhm, &lower, &upper, &upperShare);
+    return m_widths[upperShare > 0.0f ? upper : lower].radius;
+}
+
+int PsfAtlas::reachFor(const Width &width, float peak) const {
+    // The blend dithers, so light far below one ADU still counts on average; stop where a part
+    // adds under REACH_ADU. The sprite edge bounds bright stars
+    float level = std::min(1.0f, REACH_ADU / peak);
+    float reach;
+    if (m_profile == Gaussian) {
+        reach = width.fwhm / FWHM_PER_SIGMA * std::sqrt(2.0f * std::log(1.0f / level));
+    } else {
+        float alpha = width.fwhm / (2.0f * std::sqrt(std::pow(2.0f, 1.0f / MOFFAT_BETA) - 1.0f));
+        reach = alpha * std::sqrt(std::pow(level, -1.0f / MOFFAT_BETA) - 1.0f);
+    }
+    return std::min(width.radius, int(std::ceil(reach)) + 1);
+}
+
+float PsfAtlas::profileAt(float fwhm, float r2) const {
+    if (m_profile == Gaussian) {
+        float sigma = fwhm / FWHM_PER_SIGMA;
+        return std::exp(-r2 / (2.0f * sigma * sigma));
+    }
+    float alpha = fwhm / (2.0f * std::sqrt(std::pow(2.0f, 1.0f / MOFFAT_BETA) - 1.0f));
+    return std::pow(1.0f + r2 / (alpha * alpha), -MOFFAT_BETA);
+}
+
+void PsfAtlas::build(Width &width) {
+    TRACE_SCOPE("psf.build");
+    const int size = width.size;
+    const int phases = width.phases;
+    const size_t spriteSamples = size_t(size) * size;
+    // Narrow profiles change a lot across a pixel, so they get a finer grid (8 x 8 at FWHM 1)
+    const int supersample = std::max(MIN_SUPERSAMPLE, int(std::ceil(1.0f / (SUPERSAMPLE_SPACING * width.fwhm))));
+
+    width.mono.resize(spriteSamples * phases * phases);
+    width.rgb.resize(width.mono.size() * TiffImageGenerator::SAMPLES_PER_PIXEL);
+
+    for (int phaseY = 0; phaseY < phases; phaseY++) {
+        for (int phaseX = 0; phaseX < phases; phaseX++) {
+            const float centreX = width.radius + float(phaseX) / phases;
+            const float centreY = width.radius + float(phaseY) / phases;
+            uint16_t *sprite = width.mono.data() + (size_t(phaseY) * phases + phaseX) * spriteSamples;
+
+            for (int y = 0; y < size; y++) {
+                for (int x = 0; x < size; x++) {
+                    float sum = 0.0f;
+                    for (int sy = 0; sy < supersample; sy++) {
+                        float dy = y + (sy + 0.5f) / supersample - 0.5f - centreY;
+                        for (int sx = 0; sx < supersample; sx++) {
+                            float dx = x + (sx + 0.5f) / supersample - 0.5f - centreX;
+                            sum += profileAt(width.fwhm, dx * dx + dy * dy);
+                        }
+                    }
+                    float value = sum / float(supersample * supersample);
+                    sprite[size_t(y) * size + x] = value < CUTOFF ? 0 : uint16_t(std::lround(value * 65535.0f));
+                }
+            }
+        }
+    }
+
+    for (size_t i = 0; i < width.mono.size(); i++) {
+        for (int c = 0; c < TiffImageGenerator::SAMPLES_PER_PIXEL; c++) {
+            width.rgb[i * TiffImageGenerator::SAMPLES_PER_PIXEL + c] = width.mono[i];
+        }
+    }
+}
+
+// Rounding offsets follow the R2 low-discrepancy sequence over (sample column, row), so light
+// under one ADU per sample still lands on average and the pattern doesn't depend on the strip
+static const uint16_t DITHER_STEP_X = 0xC13F;       // 2^16 / plastic number
+static const uint16_t DITHER_STEP_Y = 0x91E1;       // 2^16 / plastic number^2
+
+static inline uint16_t ditherPhase(int row, int sampleColumn) {
+    return uint16_t(uint32_t(sampleColumn) * DITHER_STEP_X + uint32_t(row) * DITHER_STEP_Y);
+}
+
+// dst[i] = min(65535, dst[i] + (round(a[i] * ampA / 2^16) + round(b[i] * ampB / 2^16) + dither) >> bits),
+// amplitudes being in 2^-bits ADU with ampA + ampB + 2^bits <= 65536 so the sum stays in 16 bits;
+// phase is dst[0]'s dither phase
+static void blendRun(uint16_t *dst, const uint16_t *a, uint16_t ampA, const uint16_t *b, uint16_t ampB, int count,
+                     int bits, uint16_t phase) {
+    int i = 0;
+#if defined(__SSE2__)
+    const __m128i scaleA = _mm_set1_epi16(short(ampA));
+    const __m128i scaleB = _mm_set1_epi16(short(ampB));
+    const __m128i bitCount = _mm_cvtsi32_si128(bits);
+    const __m128i ditherCount = _mm_cvtsi32_si128(16 - bits);
+    const __m128i step = _mm_set1_epi16(short(8 * DITHER_STEP_X));
+    __m128i phases = _mm_add_epi16(_mm_set1_epi16(short(phase)), _mm_mullo_epi16(_mm_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7),
+                                                                               _mm_set1_epi16(short(DITHER_STEP_X))));
+    for (; i + 8 <= count; i += 8) {
+        __m128i srcA = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i));
+        __m128i srcB = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i));
+        // The high half of each product, plus the top bit of the low half to round it
+        __m128i partA = _mm_add_epi16(_mm_mulhi_epu16(srcA, scaleA), _mm_srli_epi16(_mm_mullo_epi16(srcA, scaleA), 15));
+        __m128i partB = _mm_add_epi16(_mm_mulhi_epu16(srcB, scaleB), _mm_srli_epi16(_mm_mullo_epi16(srcB, scaleB), 15));
+        __m128i add = _mm_add_epi16(_mm_add_epi16(partA, partB), _mm_srl_epi16(phases, ditherCount));
+        __m128i sum = _mm_adds_epu16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(dst + i)),
+                                     _mm_srl_epi16(add, bitCount));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), sum);
+        phases = _mm_add_epi16(phases, step);
+    }
+    phase = uint16_t(phase + i * DITHER_STEP_X);
+#elif defined(__ARM_NEON)
+    const uint16x4_t scaleA = vdup_n_u16(ampA);
+    const uint16x4_t scaleB = vdup_n_u16(ampB);
+    const int16x8_t bitCount = vdupq_n_s16(int16_t(-bits));
+    const int16x8_t ditherCount = vdupq_n_s16(int16_t(bits - 16));
+    const uint16x8_t step = vdupq_n_u16(uint16_t(8 * DITHER_STEP_X));
+    const uint16_t lanes[8] = {0, 1, 2, 3, 4, 5, 6, 7};
+    uint16x8_t phases = vmlaq_n_u16(vdupq_n_u16(phase), vld1q_u16(lanes), DITHER_STEP_X);
+    for (; i + 8 <= count; i += 8) {
+        uint16x8_t srcA = vld1q_u16(a + i);
+        uint16x8_t srcB = vld1q_u16(b + i);
+        uint16x8_t partA = vcombine_u16(vrshrn_n_u32(vmull_u16(vget_low_u16(srcA), scaleA), 16),
+                                        vrshrn_n_u32(vmull_u16(vget_high_u16(srcA), scaleA), 16));
+        uint16x8_t partB = vcombine_u16(vrshrn_n_u32(vmull_u16(vget_low_u16(srcB), scaleB), 16),
+                                        vrshrn_n_u32(vmull_u16(vget_high_u16(srcB), scaleB), 16));
+        uint16x8_t add = vaddq_u16(vaddq_u16(partA, partB), vshlq_u16(phases, ditherCount));
+        vst1q_u16(dst + i, vqaddq_u16(vld1q_u16(dst + i), vshlq_u16(add, bitCount)));
+        phases = vaddq_u16(phases, step);
+    }
+    phase = uint16_t(phase + i * DITHER_STEP_X);
+#endif
+    for (; i < count; i++, phase += DITHER_STEP_X) {
+        uint32_t add = ((uint32_t(a[i]) * ampA + 32768) >> 16) + ((uint32_t(b[i]) * ampB + 32768) >> 16) +
+                       (uint32_t(phase) >> (16 - bits));
+        dst[i] = uint16_t(std::min<uint32_t>(dst[i] + (add >> bits), 65535));
+    }
+}
+
+// Stars brighter than 65535 ADU: amplitudes in whole ADU no longer fit 16 bits, so the core clips
+static void blendRunWide(uint16_t *dst, const uint16_t *a, uint64_t ampA, const uint16_t *b, uint64_t ampB,
+                         int count, uint16_t phase) {
+    for (int i = 0; i < count; i++, phase += DITHER_STEP_X) {
+        uint64_t sum = dst[i] + ((a[i] * ampA + b[i] * ampB + phase) >> 16);
+        dst[i] = uint16_t(std::min<uint64_t>(sum, 65535));
+    }
+}
+
+void PsfAtlas::draw(const TiffImageGenerator::Star &star, uint16_t *dst, int firstRow, int rowCount,
+                    int samplesPerPixel) {
+    if (!(star.peak > REACH_ADU)) return;
+    int lower, upper;
+    float upperShare;
+    bracket(star.fwhm, &lower, &upper, &upperShare);
+
+    // Flux goes as peak * FWHM^2 for either profile, so each part keeps its share of the star's
+    const float fwhm = std::max(star.fwhm, MIN_FWHM);
+    const float lowerScale = fwhm / m_widths[lower].fwhm;
+    const float upperScale = fwhm / m_widths[upper].fwhm;
+    const float lowerPeak = upperShare < 1.0f ? star.peak * (1.0f - upperShare) * lowerScale * lowerScale : 0.0f;
+    const float upperPeak = upperShare > 0.0f ? star.peak * upperShare * upperScale * upperScale : 0.0f;
+
+    // Amplitudes take as many fraction bits as 16 bits leave room for, which keeps faint parts precise.
+    // Both parts count even where a strip only reaches one, so strips round the same as a whole frame
+    int bits = std::max(0, std::min(15, 15 - std::ilogb(lowerPeak + upperPeak + 1.0f)));
+    uint64_t lowerAmplitude = uint64_t(std::llround(std::ldexp(double(lowerPeak), bits)));
+    uint64_t upperAmplitude = uint64_t(std::llround(std::ldexp(double(upperPeak), bits)));
+    while (bits > 0 && lowerAmplitude + upperAmplitude + (uint64_t(1) << bits) > 65536) {
+        bits--;
+        lowerAmplitude = uint64_t(std::llround(std::ldexp(double(lowerPeak), bits)));
+        upperAmplitude = uint64_t(std::llround(std::ldexp(double(upperPeak), bits)));
+    }
+    const bool wide = lowerAmplitude + upperAmplitude + (uint64_t(1) << bits) > 65536;
+
+    // Both parts share a reach, which the lower sprite covers, so each row is one blended run
+    int reach = 0;
+    if (lowerAmplitude) reach = reachFor(m_widths[lower], lowerPeak);
+    if (upperAmplitude) reach = std::max(reach, reachFor(m_widths[upper], upperPeak));
+    reach = std::min(reach, m_widths[lower].radius);
+
+    Placement parts[2];
+    int partCount = 0;
+    if (lowerAmplitude && place(m_widths[lower], star, reach, firstRow, rowCount, samplesPerPixel,
+                                &parts[partCount])) {
+        parts[partCount++].amplitude = lowerAmplitude;
+    }
+    if (upperAmplitude && place(m_widths[upper], star, reach, firstRow, rowCount, samplesPerPixel,
+                                &parts[partCount])) {
+        parts[partCount++].amplitude = upperAmplitude;
+    }
+    if (partCount == 0) return;
+
+    // Both parts go through one dithered, saturating add per sample; a part alone blends with itself at 0
+    const Placement &first = parts[0];
+    const Placement &second = parts[partCount - 1];
+    const int spp = samplesPerPixel;
+    const int imageWidth = TiffImageGenerator::IMAGE_WIDTH;
+
+    auto blend = [&](int row, int colBegin, int colEnd, const Placement *a, const Placement *b) {
+        if (colBegin >= colEnd) return;
+        uint16_t *out = dst + (size_t(row - firstRow) * imageWidth + colBegin) * spp;
+        const uint16_t *srcA = a->sprite + (size_t(row - a->originY) * a->size + (colBegin - a->originX)) * spp;
+        const uint16_t *srcB = srcA;
+        uint64_t ampB = 0;
+        if (b) {
+            srcB = b->sprite + (size_t(row - b->originY) * b->size + (colBegin - b->originX)) * spp;
+            ampB = b->amplitude;
+        }
+        const int count = (colEnd - colBegin) * spp;
+        const uint16_t phase = ditherPhase(row, colBegin * spp);
+        if (wide) {
+            blendRunWide(out, srcA, a->amplitude, srcB, ampB, count, phase);
+        } else {
+            blendRun(out, srcA, uint16_t(a->amplitude), srcB, uint16_t(ampB), count, bits, phase);
+        }
+    };
+
+    const int rowBegin = std::min(first.rowBegin, second.rowBegin);
+    const int rowEnd = std::max(first.rowEnd, second.rowEnd);
+    for (int row = rowBegin; row < rowEnd; row++) {
+        const bool inFirst = row >= first.rowBegin && row < first.rowEnd;
+        const bool inSecond = partCount == 2 && row >= second.rowBegin && row < second.rowEnd;
+        if (!inSecond) {
+            blend(row, first.colBegin, first.colEnd, &first, nullptr);
+        } else if (!inFirst) {
+            blend(row, second.colBegin, second.colEnd, &second, nullptr);
+        } else {
+            // Columns only one part covers on either side of where they overlap
+            const int overlapBegin = std::max(first.colBegin, second.colBegin);
+            const int overlapEnd = std::min(first.colEnd, second.colEnd);
+            const Placement &leftmost = first.colBegin < second.colBegin ? first : second;
+            const Placement &rightmost = first.colEnd > second.colEnd ? first : second;
+            if (overlapBegin < overlapEnd) {
+                blend(row, leftmost.colBegin, overlapBegin, &leftmost, nullptr);
+                blend(row, overlapBegin, overlapEnd, &first, &second);
+                blend(row, overlapEnd, rightmost.colEnd, &rightmost, nullptr);
+            } else {
+                blend(row, first.colBegin, first.colEnd, &first, nullptr);
+                blend(row, second.colBegin, second.colEnd, &second, nullptr);
+            }
+        }
+    }
+}
+
+bool PsfAtlas::place(Width &width, const TiffImageGenerator::Star &star, int reach, int firstRow, int rowCount,
+                     int samplesPerPixel, Placement *placement) {
+    reach = std::min(reach, width.radius);
+    if (star.y + reach + 1 < firstRow || star.y - reach - 1 >= firstRow + rowCount) return false;
+
+    // Sprite origin and sub-pixel phase; a phase that rounds up to a whole pixel moves the origin
+    const int phases = width.phases;
+    int originX = int(std::floor(star.x));
+    int originY = int(std::floor(star.y));
+    int phaseX = int(std::lround((star.x - originX) * phases));
+    int phaseY = int(std::lround((star.y - originY) * phases));
+    if (phaseX == phases) { originX++; phaseX = 0; }
+    if (phaseY == phases) { originY++; phaseY = 0; }
+
+    // Faint stars only blit the middle of the sprite, out to where they still add light
+    placement->rowBegin = std::max(originY - reach, firstRow);
+    placement->rowEnd = std::min(originY + reach + 1, firstRow + rowCount);
+    placement->colBegin = std::max(originX - reach, 0);
+    placement->colEnd = std::min(originX + reach + 1, int(TiffImageGenerator::IMAGE_WIDTH));
+    if (placement->rowBegin >= placement->rowEnd || placement->colBegin >= placement->colEnd) return false;
+
+    std::call_once(width.built, [this, &width]() { build(width); });
+
+    const std::vector<uint16_t> &sprites = samplesPerPixel == 1 ? width.mono : width.rgb;
+    placement->sprite = sprites.data() + (size_t(phaseY) * phases + phaseX) * width.size * width.size * samplesPerPixel;
+    placement->size = width.size;
+    placement->originX = originX - width.radius;
+    placement->originY = originY - width.radius;
+    return true;
+}
@@ -0,0 +1,108 @@
+#ifndef PSFATLAS_H
+#define PSFATLAS_H
+
+#include <QString>
+#include <mutex>
+#include <vector>
+
+#include "TiffImageGenerator.h"
+
+/**
+ * @brief Precomputed star images (PSF sprites) that are blitted instead of evaluated per pixel
+ *
+ * One atlas per profile (Gaussian, or Moffat with beta = MOFFAT_BETA, which
+ * has the extended wings of real seeing) holds sprites for a ladder of FWHMs,
+ * a quarter octave apart from MIN_FWHM to 32 pixels. Sprites up to
+ * PHASED_FWHM_MAX come in PHASES x PHASES sub-pixel centre offsets (1/8 pixel),
+ * so undersampled stars still land where they should; wider ones are placed
+ * to the nearest pixel, where the difference is invisible. Each pixel is the
+ * profile averaged over a grid inside it, 3x3 or finer for FWHMs under 2.7
+ * pixels, so flux stays the same whichever phase a narrow star lands on.
+ *
+ * Sprites are 16-bit fractions of the PSF peak (65535 = peak), stored once
+ * per sample layout: one sample per pixel, and pre-interleaved RGB so a white
+ * star is one contiguous run per row. A star whose FWHM falls between two
+ * ladder widths is drawn as a mix of both, its flux split linearly by FWHM,
+ * so half-flux radius grows smoothly with FWHM instead of in quarter-octave
+ * steps (what focus curves measure). Both sprites are scaled by their share
+ * of the peak in fixed point, summed, rounded once against an ordered dither
+ * and added with a saturating add, 8 samples at a time with SSE2 or NEON.
+ * The dither lets light under one ADU per pixel still add up to the star's
+ * flux, which is what keeps a faint, defocused star from vanishing. Runs stop
+ * where the star adds under 1/16 ADU, so faint stars cost a few short runs.
+ * A star whose peak exceeds 65535 takes a scalar path that lets the core clip
+ * and the wings keep spreading.
+ *
+ * A width's sprites are built on first use (thread-safe).
+ */
+class PsfAtlas {
+public:
+    enum Profile { Gaussian, Moffat };
+
+    static const int PHASES = 8;
+    static const int WIDTHS = 21;                   // MIN_FWHM * 2^(i / 4)
+    static constexpr float MIN_FWHM = 1.0f;         // Pixels
+    static constexpr float PHASED_FWHM_MAX = 6.0f;
+    static constexpr float MOFFAT_BETA = 3.0f;
+    static constexpr float CUTOFF = 1.0f / 2048;    // Sprites end where the profile falls below this
+
+    // Profile used by TiffImageGenerator::drawStars from now on
+    static void setDefaultProfile(Profile profile) { s_defaultProfile = profile; }
+    static Profile defaultProfile() { return s_defaultProfile; }
+    static bool parseProfile(const QString &name, Profile *profile);
+
+    static PsfAtlas &instance(Profile profile);
+
+    // Largest sprite radius (its centre pixel to the edge) that a star of this FWHM is drawn with
+    int radiusFor(float fwhm) const;
+
+    // Adds star to rows [firstRow, firstRow + rowCount) of a StripSource-layout buffer
+    void draw(const TiffImageGenerator::Star &star, uint16_t *dst, int firstRow, int rowCount,
+              int samplesPerPixel);
+
+    PsfAtlas(const PsfAtlas &) = delete;
+    PsfAtlas &operator=(const PsfAtlas &) = delete;
+
+private:
+    friend class OriginBench;
+
+    struct Width {
+        float fwhm;
+        int radius;
+        int size;                           // 2 * radius + 1
+        int phases;                         // PHASES, or 1 above PHASED_FWHM_MAX
+        std::once_flag built;
+        std::vector<uint16_t> mono;         // phases^2 sprites of size x size
+        std::vector<uint16_t> rgb;          // Same, every value three times
+    };
+
+    explicit PsfAtlas(Profile profile);
+
+    // Ladder widths either side of fwhm and the share of flux that goes to the upper one
+    static void bracket(float fwhm, int *lower, int *upper, float *upperShare);
+    // Where one part of a star lands: its sprite, and the rows and columns it adds light to
+    struct Placement {
+        const uint16_t *sprite;
+        int size;
+        int originX;                        // Image position of the sprite's top-left sample
+        int originY;
+        int rowBegin;
+        int rowEnd;
+        int colBegin;
+        int colEnd;
+        uint64_t amplitude;                 // Part's peak in fixed point, set by draw
+    };
+
+    bool place(Width &width, const TiffImageGenerator::Star &star, int reach, int firstRow, int rowCount,
+               int samplesPerPixel, Placement *placement);
+    int reachFor(const Width &width, float peak) const;
+    float profileAt(float fwhm, float r2) const;
+    void build(Width &width);
+
+    static Profile s_defaultProfile;
+
+    Profile m_profile;
+    Width m_widths[WIDTHS];
+};
+
+#endif // PSFATLAS_H
@@ -0,0 +1,330 @@
+#include "SensorNoise.h"
+#include "TiffImageGenerator.h"
+#include "Tracer.h"
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#if defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+static const int MAX_NOISE_THREADS = 8;
+
+// Philox4x32 multipliers and Weyl key increments (Salmon et al., "Random123")
+static const uint32_t PHILOX_M0 = 0xD2511F53u;
+static const uint32_t PHILOX_M1 = 0xCD9E8D57u;
+static const uint32_t PHILOX_W0 = 0x9E3779B9u;
+static const uint32_t PHILOX_W1 = 0xBB67AE85u;
+static const int PHILOX_ROUNDS = 10;
+
+// Counter word 3 separates the per-sample stream from the per-sensor one
+static const uint32_t STREAM_SAMPLES = 0;
+static const uint32_t STREAM_HOT_PIXELS = 1;
+
+// Sum of four uniform nibbles (one 16-bit half word): mean 4 * 7.5, variance 4 * (16^2 - 1) / 12
+static const float IRWIN_HALL_MEAN = 30.0f;
+static const float IRWIN_HALL_INV_SD = 1.0f / 9.2195445f;
+
+static const double READ_NOISE_FLOOR_E = 1.0;          // Plus READ_NOISE_UNITY_E at unity gain, less above it
+static const double READ_NOISE_UNITY_E = 2.0;
+static const double DARK_E_PER_S_25C = 0.05;
+static const double DARK_DOUBLING_C = 6.3;
+static const double SKY_E_PER_S = 120.0;               // Suburban sky at f/2.2
+static const float SKY_TOP = 0.8f;                     // Sky relative to centre: brighter towards the bottom (horizon)
+static const float SKY_SLOPE_Y = 0.4f;
+static const float SKY_SLOPE_X = 0.1f;
+static const double HOT_PIXEL_FRACTION = 1e-4;
+static const double HOT_E_PER_S_MIN = 5.0;             // At 25 C
+static const double HOT_E_PER_S_MAX = 200.0;
+
+void SensorNoise::philox(uint32_t counter[4], const uint32_t key[2]) {
+    uint32_t k0 = key[0];
+    uint32_t k1 = key[1];
+    for (int round = 0; round < PHILOX_ROUNDS; round++) {
+        if (round > 0) {
+            k0 += PHILOX_W0;
+            k1 += PHILOX_W1;
+        }
+        uint64_t p0 = uint64_t(PHILOX_M0) * counter[0];
+        uint64_t p1 = uint64_t(PHILOX_M1) * counter[2];
+        uint32_t c1 = counter[1];
+        uint32_t c3 = counter[3];
+        counter[0] = uint32_t(p1 >> 32) ^ c1 ^ k0;
+        counter[1] = uint32_t(p1);
+        counter[2] = uint32_t(p0 >> 32) ^ c3 ^ k1;
+        counter[3] = uint32_t(p0);
+    }
+}
+
+SensorNoise::SensorNoise(const Settings &settings, uint64_t seed, uint64_t frame)
+    : m_settings(settings) {
+    m_key[0] = uint32_t(seed);
+    m_key[1] = uint32_t(seed >> 32);
+    m_frame[0] = uint32_t(frame);
+    m_frame[1] = uint32_t(frame >> 32);
+
+    const double exposure = std::max(0.0, settings.exposure);
+    const double iso = std::max(1, settings.iso);
+    const double binArea = double(std::max(1, settings.binning)) * std::max(1, settings.binning);
+    const double darkScale = std::pow(2.0, (settings.temperature - 25.0) / DARK_DOUBLING_C) * exposure * binArea;
+    const double readNoise = READ_NOISE_FLOOR_E + READ_NOISE_UNITY_E * UNITY_ISO / iso;
+
+    m_gain = float(iso / UNITY_ISO);
+    m_invGain = 1.0f / m_gain;
+    m_readVariance = float(readNoise * readNoise * binArea);
+    m_darkElectrons = float(DARK_E_PER_S_25C * darkScale);
+    m_skyElectrons = float(SKY_E_PER_S * exposure * binArea);
+
+    // Hot photosites depend on the sensor (seed) only, never on the frame
+    const int width = TiffImageGenerator::IMAGE_WIDTH;
+    const int height = TiffImageGenerator::IMAGE_HEIGHT;
+    const int hotCount = int(double(width) * height * HOT_PIXEL_FRACTION);
+    m_hotPixels.resize(size_t(hotCount));
+    for (int n = 0; n < hotCount; n++) {
+        uint32_t counter[4] = {uint32_t(n), 0, 0, STREAM_HOT_PIXELS};
+        philox(counter, m_key);
+        double u = counter[2] / 4294967296.0;
+        HotPixel &hot = m_hotPixels[size_t(n)];
+        hot.x = int(counter[0] % uint32_t(width));
+        hot.y = int(counter[1] % uint32_t(height));
+        hot.electrons = float((HOT_E_PER_S_MIN + (HOT_E_PER_S_MAX - HOT_E_PER_S_MIN) * u * u) * darkScale);
+    }
+    std::sort(m_hotPixels.begin(), m_hotPixels.end(), [](const HotPixel &a, const HotPixel &b) {
+        return a.y != b.y ? a.y < b.y : a.x < b.x;
+    });
+
+    m_hotRowStart.assign(size_t(height) + 1, 0);
+    for (const HotPixel &hot : m_hotPixels) m_hotRowStart[size_t(hot.y) + 1]++;
+    for (int y = 0; y < height; y++) m_hotRowStart[size_t(y) + 1] += m_hotRowStart[size_t(y)];
+}
+
+void SensorNoise::apply(uint16_t *samples, int firstRow, int rowCount, int samplesPerPixel) const {
+    const size_t rowSamples = size_t(TiffImageGenerator::IMAGE_WIDTH) * samplesPerPixel;
+    for (int row = 0; row < rowCount; row++) {
+        applyRow(samples + size_t(row) * rowSamples, firstRow + row, samplesPerPixel);
+    }
+}
+
+void SensorNoise::applyFrame(uint16_t *samples, int samplesPerPixel) const {
+    TRACE_SCOPE("noise.frame");
+    const int height = TiffImageGenerator::IMAGE_HEIGHT;
+    const size_t rowSamples = size_t(TiffImageGenerator::IMAGE_WIDTH) * samplesPerPixel;
+    const int threadCount = std::max(1, std::min(MAX_NOISE_THREADS, int(std::thread::hardware_concurrency())));
+    const int rowsPerThread = (height + threadCount - 1) / threadCount;
+
+    std::vector<std::thread> workers;
+    for (int firstRow = rowsPerThread; firstRow < height; firstRow += rowsPerThread) {
+        int rows = std::min(rowsPerThread, height - firstRow);
+        workers.emplace_back([=]() { apply(samples + size_t(firstRow) * rowSamples, firstRow, rows, samplesPerPixel); });
+    }
+    apply(samples, 0, std::min(rowsPerThread, height), samplesPerPixel);
+    for (std::thread &worker : workers) worker.join();
+}
+
+void SensorNoise::applyRow(uint16_t *row, int y, int samplesPerPixel) const {
+    const int spp = samplesPerPixel;
+    const int rowSamples = TiffImageGenerator::IMAGE_WIDTH * spp;
+
+    // Hot photosites add charge before readout, so they get shot noise like everything else
+    for (int n = m_hotRowStart[size_t(y)]; n < m_hotRowStart[size_t(y) + 1]; n++) {
+        const HotPixel &hot = m_hotPixels[size_t(n)];
+        int index = spp == 1 ? hot.x : hot.x * spp + TiffImageGenerator::cfaChannel(hot.x, y);
+        row[index] = uint16_t(std::min(65535, row[index] + int(hot.electrons * m_gain + 0.5f)));
+    }
+
+    // Electrons on every sample before scene signal: sky glow gradient plus dark current
+    const float background = m_skyElectrons * (SKY_TOP + SKY_SLOPE_Y * float(y) / TiffImageGenerator::IMAGE_HEIGHT)
+                           + m_darkElectrons;
+    const float skyStep = m_skyElectrons * SKY_SLOPE_X / float(rowSamples);
+    const float bias = float(BIAS_ADU);
+
+    // Rows hold a multiple of 8 samples, so Philox blocks line up with row starts
+    uint32_t block = uint32_t(size_t(y) * rowSamples / 8);
+    int i = 0;
+
+#if defined(__SSE2__)
+    const __m128i m0 = _mm_set1_epi32(int(PHILOX_M0));
+    const __m128i m1 = _mm_set1_epi32(int(PHILOX_M1));
+    const __m128i nibbleMask = _mm_set1_epi32(0x0F0F0F0F);
+    const __m128i byteMask = _mm_set1_epi32(0x00FF00FF);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i packBias = _mm_set1_epi32(32768);
+    const __m128i packFlip = _mm_set1_epi16(short(0x8000));
+    const __m128 gainV = _mm_set1_ps(m_gain);
+    const __m128 invGainV = _mm_set1_ps(m_invGain);
+    const __m128 readV = _mm_set1_ps(m_readVariance);
+    const __m128 backgroundV = _mm_set1_ps(background);
+    const __m128 skyStepV = _mm_set1_ps(skyStep);
+    const __m128 biasV = _mm_set1_ps(bias);
+    const __m128 meanV = _mm_set1_ps(IRWIN_HALL_MEAN);
+    const __m128 invSdV = _mm_set1_ps(IRWIN_HALL_INV_SD);
+    const __m128 maxV = _mm_set1_ps(65535.0f);
+    const __m128 zeroV = _mm_setzero_ps();
+
+    // 32x32 -> 64-bit products of all four lanes, split into high and low words
+    auto mulhilo = [](__m128i a, __m128i m, __m128i &hi, __m128i &lo) {
+        __m128i even = _mm_shuffle_epi32(_mm_mul_epu32(a, m), _MM_SHUFFLE(3, 1, 2, 0));
+        __m128i odd = _mm_shuffle_epi32(_mm_mul_epu32(_mm_srli_epi64(a, 32), m), _MM_SHUFFLE(3, 1, 2, 0));
+        lo = _mm_unpacklo_epi32(even, odd);
+        hi = _mm_unpackhi_epi32(even, odd);
+    };
+    // One block's four words are eight consecutive samples, two to a word
+    auto gaussian8 = [&](__m128i words, __m128 &low, __m128 &high) {
+        __m128i sums = _mm_add_epi32(_mm_and_si128(words, nibbleMask), _mm_and_si128(_mm_srli_epi32(words, 4), nibbleMask));
+        sums = _mm_add_epi32(_mm_and_si128(sums, byteMask), _mm_and_si128(_mm_srli_epi32(sums, 8), byteMask));
+        low = _mm_mul_ps(_mm_sub_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(sums, zero)), meanV), invSdV);
+        high = _mm_mul_ps(_mm_sub_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(sums, zero)), meanV), invSdV);
+    };
+    auto noisy4 = [&](__m128 g, const uint16_t *in, int index) {
+        __m128 signal = _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(in)), zero));
+        __m128 sky = _mm_add_ps(backgroundV, _mm_mul_ps(skyStepV, _mm_cvtepi32_ps(_mm_setr_epi32(index, index + 1, index + 2, index + 3))));
+        __m128 mean = _mm_add_ps(_mm_mul_ps(signal, invGainV), sky);
+        __m128 value = _mm_add_ps(biasV, _mm_mul_ps(_mm_add_ps(mean, _mm_mul_ps(_mm_sqrt_ps(_mm_add_ps(mean, readV)), g)), gainV));
+        value = _mm_min_ps(_mm_max_ps(value, zeroV), maxV);
+        return _mm_sub_epi32(_mm_cvtps_epi32(value), packBias);
+    };
+    // Eight samples from one block's words, stored back over their input
+    auto noisy8 = [&](__m128i words, int index) {
+        __m128 low, high;
+        gaussian8(words, low, high);
+        __m128i v0 = noisy4(low, row + index, index);
+        __m128i v1 = noisy4(high, row + index + 4, index + 4);
+        // SSE2 has only a signed 32 -> 16 pack, hence the offset by 32768
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(row + index), _mm_xor_si128(_mm_packs_epi32(v0, v1), packFlip));
+    };
+
+    for (; i + 32 <= rowSamples; i += 32, block += 4) {
+        __m128i c0 = _mm_add_epi32(_mm_set1_epi32(int(block)), _mm_setr_epi32(0, 1, 2, 3));
+        __m128i c1 = _mm_set1_epi32(int(m_frame[0]));
+        __m128i c2 = _mm_set1_epi32(int(m_frame[1]));
+        __m128i c3 = _mm_set1_epi32(int(STREAM_SAMPLES));
+        uint32_t k0 = m_key[0];
+        uint32_t k1 = m_key[1];
+        for (int round = 0; round < PHILOX_ROUNDS; round++) {
+            if (round > 0) {
+                k0 += PHILOX_W0;
+                k1 += PHILOX_W1;
+            }
+            __m128i hi0, lo0, hi1, lo1;
+            mulhilo(c0, m0, hi0, lo0);
+            mulhilo(c2, m1, hi1, lo1);
+            c0 = _mm_xor_si128(_mm_xor_si128(hi1, c1), _mm_set1_epi32(int(k0)));
+            c1 = lo1;
+            c2 = _mm_xor_si128(_mm_xor_si128(hi0, c3), _mm_set1_epi32(int(k1)));
+            c3 = lo0;
+        }
+
+        // Lanes hold four blocks; transpose so each vector is one block's eight consecutive samples
+        __m128i t0 = _mm_unpacklo_epi32(c0, c1);
+        __m128i t1 = _mm_unpacklo_epi32(c2, c3);
+        __m128i t2 = _mm_unpackhi_epi32(c0, c1);
+        __m128i t3 = _mm_unpackhi_epi32(c2, c3);
+
+        noisy8(_mm_unpacklo_epi64(t0, t1), i);
+        noisy8(_mm_unpackhi_epi64(t0, t1), i + 8);
+        noisy8(_mm_unpacklo_epi64(t2, t3), i + 16);
+        noisy8(_mm_unpackhi_epi64(t2, t3), i + 24);
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    const uint32x4_t m0 = vdupq_n_u32(PHILOX_M0);
+    const uint32x4_t m1 = vdupq_n_u32(PHILOX_M1);
+    const uint32x4_t nibbleMask = vdupq_n_u32(0x0F0F0F0F);
+    const uint32x4_t byteMask = vdupq_n_u32(0x00FF00FF);
+    const float32x4_t gainV = vdupq_n_f32(m_gain);
+    const float32x4_t invGainV = vdupq_n_f32(m_invGain);
+    const float32x4_t readV = vdupq_n_f32(m_readVariance);
+    const float32x4_t backgroundV = vdupq_n_f32(background);
+    const float32x4_t skyStepV = vdupq_n_f32(skyStep);
+    const float32x4_t biasV = vdupq_n_f32(bias);
+    const float32x4_t meanV = vdupq_n_f32(IRWIN_HALL_MEAN);
+    const float32x4_t invSdV = vdupq_n_f32(IRWIN_HALL_INV_SD);
+    const float32x4_t maxV = vdupq_n_f32(65535.0f);
+    const float32x4_t zeroV = vdupq_n_f32(0.0f);
+    const uint32_t laneOffsets[4] = {0, 1, 2, 3};
+    const uint32x4_t lanes = vld1q_u32(laneOffsets);
+
+    auto mulhilo = [](uint32x4_t a, uint32x4_t m, uint32x4_t &hi, uint32x4_t &lo) {
+        uint64x2_t low = vmull_u32(vget_low_u32(a), vget_low_u32(m));
+        uint64x2_t high = vmull_u32(vget_high_u32(a), vget_high_u32(m));
+        lo = vcombine_u32(vmovn_u64(low), vmovn_u64(high));
+        hi = vcombine_u32(vshrn_n_u64(low, 32), vshrn_n_u64(high, 32));
+    };
+    // One block's four words are eight consecutive samples, two to a word
+    auto gaussian8 = [&](uint32x4_t words, float32x4_t &low, float32x4_t &high) {
+        uint32x4_t sums = vaddq_u32(vandq_u32(words, nibbleMask), vandq_u32(vshrq_n_u32(words, 4), nibbleMask));
+        sums = vaddq_u32(vandq_u32(sums, byteMask), vandq_u32(vshrq_n_u32(sums, 8), byteMask));
+        uint16x8_t halves = vreinterpretq_u16_u32(sums);
+        low = vmulq_f32(vsubq_f32(vcvtq_f32_u32(vmovl_u16(vget_low_u16(halves))), meanV), invSdV);
+        high = vmulq_f32(vsubq_f32(vcvtq_f32_u32(vmovl_u16(vget_high_u16(halves))), meanV), invSdV);
+    };
+    // Separate multiply and add, like the scalar tail, so both paths round identically
+    auto noisy4 = [&](float32x4_t g, const uint16_t *in, int index) {
+        float32x4_t signal = vcvtq_f32_u32(vmovl_u16(vld1_u16(in)));
+        float32x4_t sky = vaddq_f32(backgroundV, vmulq_f32(skyStepV, vcvtq_f32_u32(vaddq_u32(vdupq_n_u32(uint32_t(index)), lanes))));
+        float32x4_t mean = vaddq_f32(vmulq_f32(signal, invGainV), sky);
+        float32x4_t value = vaddq_f32(biasV, vmulq_f32(vaddq_f32(mean, vmulq_f32(vsqrtq_f32(vaddq_f32(mean, readV)), g)), gainV));
+        value = vminq_f32(vmaxq_f32(value, zeroV), maxV);
+        return vmovn_u32(vcvtnq_u32_f32(value));
+    };
+    // Eight samples from one block's words, stored back over their input
+    auto noisy8 = [&](uint32x4_t words, int index) {
+        float32x4_t low, high;
+        gaussian8(words, low, high);
+        vst1q_u16(row + index, vcombine_u16(noisy4(low, row + index, index), noisy4(high, row + index + 4, index + 4)));
+    };
+
+    for (; i + 32 <= rowSamples; i += 32, block += 4) {
+        uint32x4_t c0 = vaddq_u32(vdupq_n_u32(block), lanes);
+        uint32x4_t c1 = vdupq_n_u32(m_frame[0]);
+        uint32x4_t c2 = vdupq_n_u32(m_frame[1]);
+        uint32x4_t c3 = vdupq_n_u32(STREAM_SAMPLES);
+        uint32_t k0 = m_key[0];
+        uint32_t k1 = m_key[1];
+        for (int round = 0; round < PHILOX_ROUNDS; round++) {
+            if (round > 0) {
+                k0 += PHILOX_W0;
+                k1 += PHILOX_W1;
+            }
+            uint32x4_t hi0, lo0, hi1, lo1;
+            mulhilo(c0, m0, hi0, lo0);
+            mulhilo(c2, m1, hi1, lo1);
+            c0 = veorq_u32(veorq_u32(hi1, c1), vdupq_n_u32(k0));
+            c1 = lo1;
+            c2 = veorq_u32(veorq_u32(hi0, c3), vdupq_n_u32(k1));
+            c3 = lo0;
+        }
+
+        // Lanes hold four blocks; transpose so each vector is one block's eight consecutive samples
+        uint32x4x2_t t01 = vtrnq_u32(c0, c1);
+        uint32x4x2_t t23 = vtrnq_u32(c2, c3);
+        uint32x4_t b0 = vcombine_u32(vget_low_u32(t01.val[0]), vget_low_u32(t23.val[0]));
+        uint32x4_t b1 = vcombine_u32(vget_low_u32(t01.val[1]), vget_low_u32(t23.val[1]));
+        uint32x4_t b2 = vcombine_u32(vget_high_u32(t01.val[0]), vget_high_u32(t23.val[0]));
+        uint32x4_t b3 = vcombine_u32(vget_high_u32(t01.val[1]), vget_high_u32(t23.val[1]));
+
+        noisy8(b0, i);
+        noisy8(b1, i + 8);
+        noisy8(b2, i + 16);
+        noisy8(b3, i + 24);
+    }
+#endif
+
+    for (; i < rowSamples; i += 8, block++) {
+        uint32_t counter[4] = {block, m_frame[0], m_frame[1], STREAM_SAMPLES};
+        philox(counter, m_key);
+        for (int j = 0; j < 8 && i + j < rowSamples; j++) {
+            uint32_t word = counter[j / 2] >> (16 * (j % 2));
+            uint32_t sums = (word & 0x0F0Fu) + ((word >> 4) & 0x0F0Fu);
+            sums = (sums & 0xFFu) + ((sums >> 8) & 0xFFu);
+            float g = (float(int(sums)) - IRWIN_HALL_MEAN) * IRWIN_HALL_INV_SD;
+
+            float sky = background + skyStep * float(i + j);
+            float mean = float(row[i + j]) * m_invGain + sky;
+            float value = bias + (mean + std::sqrt(mean + m_readVariance) * g) * m_gain;
+            value = std::min(std::max(value, 0.0f), 65535.0f);
+            row[i + j] = uint16_t(std::nearbyint(value));
+        }
+    }
+}
@@ -0,0 +1,90 @@
+#ifndef SENSORNOISE_H
+#define SENSORNOISE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Camera noise stage that turns a noiseless rendered frame into a sensor readout
+ *
+ * Input samples are the scene signal in ADU. Each becomes scene plus a
+ * sky-glow gradient and thermal dark current, with photon shot noise on all
+ * of it, Gaussian read noise and a bias pedestal on top; a fixed set of hot
+ * pixels (a property of the sensor, so the same in every frame) adds its own
+ * dark signal. Gain and read noise follow ISO, dark current doubles every
+ * DARK_DOUBLING_C degrees of sensor temperature, sky and dark grow with
+ * exposure and with binning squared (charge from every photosite in the bin),
+ * read noise with binning.
+ *
+ * Random numbers come from Philox4x32-10, a counter-based generator: a
+ * sample's noise is a pure function of (seed, frame, sample index), so strips
+ * can be rendered on any thread in any order and a seed replays exactly.
+ * Shot and read noise are combined into one Gaussian per sample, drawn as an
+ * Irwin-Hall sum of four random nibbles, so one Philox block covers eight
+ * samples. That matches Poisson well above a few tens of electrons (tails stop
+ * at 3.25 sigma), and the sky pedestal keeps every pixel up there.
+ *
+ * The generator and noise maths run four Philox blocks (32 samples) at a time
+ * with SSE2 or AArch64 NEON, with a scalar tail that gives the same values.
+ */
+class SensorNoise {
+public:
+    struct Settings {
+        double exposure = 0.5;          // Seconds
+        int iso = 2000;
+        double temperature = 24.3;      // Sensor, degrees C
+        int binning = 1;
+    };
+
+    static const int UNITY_ISO = 800;           // One ADU per electron
+    static const int BIAS_ADU = 200;
+
+    SensorNoise(const Settings &settings, uint64_t seed, uint64_t frame = 0);
+
+    /**
+     * @brief Replace rows [firstRow, firstRow + rowCount) of a full-size frame with noisy readout
+     *
+     * samples holds rowCount * IMAGE_WIDTH * samplesPerPixel samples laid out
+     * like a TiffImageGenerator::StripSource buffer (RGB, or one RGGB mosaic
+     * sample in raw Bayer mode).
+     */
+    void apply(uint16_t *samples, int firstRow, int rowCount, int samplesPerPixel) const;
+
+    // Whole IMAGE_WIDTH x IMAGE_HEIGHT frame, rows split across worker threads
+    void applyFrame(uint16_t *samples, int samplesPerPixel) const;
+
+    const Settings &settings() const { return m_settings; }
+    float gain() const { return m_gain; }                           // ADU per electron
+    float readVarianceAdu() const { return m_readVariance * m_gain * m_gain; }
+    size_t hotPixelCount() const { return m_hotPixels.size(); }
+
+private:
+    friend class OriginBench;
+
+    struct HotPixel {
+        int x;
+        int y;
+        float electrons;
+    };
+
+    // One Philox4x32-10 block: four random words for a 128-bit counter
+    static void philox(uint32_t counter[4], const uint32_t key[2]);
+
+    void applyRow(uint16_t *row, int y, int samplesPerPixel) const;
+
+    Settings m_settings;
+    uint32_t m_key[2];
+    uint32_t m_frame[2];
+
+    float m_gain;                       // ADU per electron
+    float m_invGain;
+    float m_readVariance;               // Electrons squared
+    float m_darkElectrons;
+    float m_skyElectrons;               // At the frame centre
+
+    std::vector<HotPixel> m_hotPixels;  // Sorted by row
+    std::vector<int> m_hotRowStart;     // IMAGE_HEIGHT + 1 offsets into m_hotPixels
+};
+
+#endif // SENSORNOISE_H
@@ -0,0 +1,129 @@
+#include "SessionLog.h"
+#include <QDateTime>
+#include <QDebug>
+
+static const char SESSION_LOG_MAGIC[4] = {'O', 'S', 'L', 'G'};
+static const quint8 SESSION_LOG_VERSION = 1;
+
+// Flush often enough that a killed simulator loses at most a fraction of a second
+static const int FLUSH_BYTES = 64 * 1024;
+static const int FLUSH_INTERVAL_MS = 250;
+
+static void appendVarint(QByteArray &out, quint64 value) {
+    while (value >= 0x80) {
+        out.append(char((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.append(char(value));
+}
+
+static bool readVarint(const QByteArray &in, qsizetype &pos, quint64 &value) {
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (pos >= in.size()) return false;
+        quint8 byte = quint8(in[pos++]);
+        value |= quint64(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+SessionRecorder::SessionRecorder(const QString &path) : m_file(path) {
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "Cannot open session log" << path << ":" << m_file.errorString();
+        return;
+    }
+
+    qint64 startMs = QDateTime::currentMSecsSinceEpoch();
+    m_buffer.append(SESSION_LOG_MAGIC, 4);
+    m_buffer.append(char(SESSION_LOG_VERSION));
+    for (int i = 0; i < 8; ++i) {
+        m_buffer.append(char((startMs >> (i * 8)) & 0xFF));
+    }
+    m_elapsed.start();
+
+    qDebug() << "Recording session to" << path;
+}
+
+SessionRecorder::~SessionRecorder() {
+    flush();
+}
+
+void SessionRecorder::record(SessionRecordKind kind, quint32 connectionId, const QByteArray &payload) {
+    if (!m_file.isOpen()) return;
+
+    qint64 nowUs = m_elapsed.nsecsElapsed() / 1000;
+    appendVarint(m_buffer, quint64(qMax<qint64>(0, nowUs - m_lastUs)));
+    m_lastUs = nowUs;
+    m_buffer.append(char(kind));
+    appendVarint(m_buffer, connectionId);
+    appendVarint(m_buffer, quint64(payload.size()));
+    m_buffer.append(payload);
+
+    if (m_buffer.size() >= FLUSH_BYTES || nowUs / 1000 - m_lastFlushMs >= FLUSH_INTERVAL_MS) {
+        flush();
+    }
+}
+
+void SessionRecorder::flush() {
+    if (!m_file.isOpen() || m_buffer.isEmpty()) return;
+
+    m_file.write(m_buffer);
+    m_file.flush();
+    m_buffer.clear();
+    m_lastFlushMs = m_elapsed.elapsed();
+}
+
+bool SessionLogReader::read(const QString &path, QList<SessionRecord> &records,
+                            qint64 *startEpochMs, QString *error) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (error) *error = file.errorString();
+        return false;
+    }
+
+    QByteArray data = file.readAll();
+    if (data.size() < 13 || !data.startsWith(QByteArray(SESSION_LOG_MAGIC, 4))) {
+        if (error) *error = "Not a session log";
+        return false;
+    }
+    if (quint8(data[4]) != SESSION_LOG_VERSION) {
+        if (error) *error = QString("Unsupported session log version %1").arg(quint8(data[4]));
+        return false;
+    }
+
+    if (startEpochMs) {
+        qint64 startMs = 0;
+        for (int i = 0; i < 8; ++i) {
+            startMs |= qint64(quint8(data[5 + i])) << (i * 8);
+        }
+        *startEpochMs = startMs;
+    }
+
+    qsizetype pos = 13;
+    qint64 timestampUs = 0;
+    while (pos < data.size()) {
+        quint64 deltaUs, connectionId, length;
+        if (!readVarint(data, pos, deltaUs) || pos >= data.size()) break;
+        quint8 kind = quint8(data[pos++]);
+        if (!readVarint(data, pos, connectionId) || !readVarint(data, pos, length)
+            || length > quint64(data.size() - pos)) {
+            break;
+        }
+
+        timestampUs += qint64(deltaUs);
+        SessionRecord record;
+        record.timestampUs = timestampUs;
+        record.kind = SessionRecordKind(kind);
+        record.connectionId = quint32(connectionId);
+        record.payload = data.mid(pos, qsizetype(length));
+        records.append(record);
+        pos += qsizetype(length);
+    }
+
+    // A truncated tail just means the recorder was killed mid-write
+    if (pos < data.size()) {
+        qWarning() << "Session log" << path << "truncated after" << records.size() << "records";
+    }
+    return true;
+}
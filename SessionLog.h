@@ -0,0 +1,71 @@
+#ifndef SESSIONLOG_H
+#define SESSIONLOG_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QList>
+#include <QString>
+
+/**
+ * @brief Compact binary log of an Origin protocol session
+ *
+ * File layout:
+ *   "OSLG" magic, uint8 version, int64 (LE) wall-clock start in ms since epoch
+ *   then records of
+ *     varint  microseconds since the previous record
+ *     uint8   kind
+ *     varint  connection id
+ *     varint  payload length
+ *     bytes   payload
+ *
+ * WebSocket records carry the message text; HTTP records carry the request or
+ * response head (bodies are images and are logged only by length in the head).
+ */
+enum class SessionRecordKind : quint8 {
+    ConnectionOpened = 1,
+    ConnectionClosed = 2,
+    WebSocketInbound = 3,
+    WebSocketOutbound = 4,
+    HttpRequest = 5,
+    HttpResponse = 6
+};
+
+struct SessionRecord {
+    qint64 timestampUs = 0;        // Since the start of the session
+    SessionRecordKind kind = SessionRecordKind::ConnectionOpened;
+    quint32 connectionId = 0;
+    QByteArray payload;
+};
+
+class SessionRecorder {
+public:
+    explicit SessionRecorder(const QString &path);
+    ~SessionRecorder();
+
+    bool isOpen() const { return m_file.isOpen(); }
+    QString path() const { return m_file.fileName(); }
+
+    // Ids are unique per recorder so HTTP and WebSocket traffic can share a log
+    quint32 nextConnectionId() { return m_nextConnectionId++; }
+
+    void record(SessionRecordKind kind, quint32 connectionId, const QByteArray &payload = QByteArray());
+    void flush();
+
+private:
+    QFile m_file;
+    QElapsedTimer m_elapsed;
+    QByteArray m_buffer;
+    qint64 m_lastUs = 0;
+    qint64 m_lastFlushMs = 0;
+    quint32 m_nextConnectionId = 1;
+};
+
+class SessionLogReader {
+public:
+    // Reads a complete log; returns false with a message on malformed input
+    static bool read(const QString &path, QList<SessionRecord> &records,
+                     qint64 *startEpochMs = nullptr, QString *error = nullptr);
+};
+
+#endif // SESSIONLOG_H
@@ -0,0 +1,146 @@
+#include "SimulationClock.h"
+#include <QDebug>
+
+SimulationClock::SimulationClock() {
+    m_wallAnchorMs = QDateTime::currentMSecsSinceEpoch();
+    m_simAnchorMs = m_wallAnchorMs;
+}
+
+SimulationClock &SimulationClock::global() {
+    static SimulationClock clock;
+    return clock;
+}
+
+void SimulationClock::reanchor() {
+    qint64 now = currentMSecsSinceEpoch();
+    m_wallAnchorMs = QDateTime::currentMSecsSinceEpoch();
+    m_simAnchorMs = now;
+    m_steppedNowMs = now;
+}
+
+void SimulationClock::setRealTime() {
+    reanchor();
+    m_mode = RealTime;
+    m_scale = 1.0;
+}
+
+void SimulationClock::setScaled(double factor) {
+    reanchor();
+    m_mode = Scaled;
+    m_scale = factor > 0.0 ? factor : 1.0;
+}
+
+void SimulationClock::setStepped() {
+    reanchor();
+    m_mode = Stepped;
+}
+
+void SimulationClock::setCurrentDateTime(const QDateTime &dateTime) {
+    m_wallAnchorMs = QDateTime::currentMSecsSinceEpoch();
+    m_simAnchorMs = dateTime.toMSecsSinceEpoch();
+    m_steppedNowMs = m_simAnchorMs;
+}
+
+qint64 SimulationClock::currentMSecsSinceEpoch() const {
+    if (m_mode == Stepped) {
+        return m_steppedNowMs;
+    }
+    qint64 wallElapsed = QDateTime::currentMSecsSinceEpoch() - m_wallAnchorMs;
+    return m_simAnchorMs + static_cast<qint64>(wallElapsed * m_scale);
+}
+
+QDateTime SimulationClock::currentDateTime() const {
+    return QDateTime::fromMSecsSinceEpoch(currentMSecsSinceEpoch());
+}
+
+int SimulationClock::toWallInterval(int simMs) const {
+    if (m_mode == Scaled) {
+        return qMax(0, qRound(simMs / m_scale));
+    }
+    return simMs;
+}
+
+void SimulationClock::schedule(qint64 dueMs, QObject *context, std::function<void()> fn) {
+    m_events.emplace(std::make_pair(dueMs, m_nextSequence++), ScheduledEvent{context, std::move(fn)});
+}
+
+void SimulationClock::advance(qint64 ms) {
+    if (m_mode != Stepped) {
+        qWarning() << "SimulationClock::advance() ignored outside stepped mode";
+        return;
+    }
+    
+    qint64 target = m_steppedNowMs + qMax<qint64>(0, ms);
+    
+    // Events scheduled while running (repeating timers, follow-up singleShots) are
+    // picked up by the same loop if they fall inside the step
+    while (!m_events.empty() && m_events.begin()->first.first <= target) {
+        auto it = m_events.begin();
+        m_steppedNowMs = it->first.first;
+        ScheduledEvent event = std::move(it->second);
+        m_events.erase(it);
+        
+        if (event.context) {
+            event.fn();
+        }
+    }
+    
+    m_steppedNowMs = target;
+}
+
+void SimulationClock::singleShot(int simMs, QObject *context, std::function<void()> fn) {
+    if (m_mode == Stepped) {
+        schedule(m_steppedNowMs + simMs, context, std::move(fn));
+    } else {
+        QTimer::singleShot(toWallInterval(simMs), context, std::move(fn));
+    }
+}
+
+SimTimer::SimTimer(SimulationClock *clock, std::function<void()> callback, QObject *parent)
+    : QObject(parent), m_clock(clock), m_callback(std::move(callback)) {
+    m_timer = new QTimer(this);
+    connect(m_timer, &QTimer::timeout, this, [this]() { fire(); });
+}
+
+void SimTimer::start(int simMs) {
+    m_interval = simMs;
+    start();
+}
+
+void SimTimer::start() {
+    stop();
+    m_active = true;
+    
+    if (m_clock->mode() == SimulationClock::Stepped) {
+        scheduleStepped();
+    } else {
+        m_timer->setSingleShot(m_singleShot);
+        m_timer->start(m_clock->toWallInterval(m_interval));
+    }
+}
+
+void SimTimer::stop() {
+    m_active = false;
+    m_generation++;
+    m_timer->stop();
+}
+
+void SimTimer::scheduleStepped() {
+    // A zero interval would never let advance() finish, so step by at least 1 ms
+    quint64 generation = m_generation;
+    qint64 due = m_clock->currentMSecsSinceEpoch() + qMax(1, m_interval);
+    m_clock->schedule(due, this, [this, generation]() {
+        if (generation != m_generation || !m_active) return;
+        if (!m_singleShot) {
+            scheduleStepped();
+        }
+        fire();
+    });
+}
+
+void SimTimer::fire() {
+    if (m_singleShot) {
+        m_active = false;
+    }
+    m_callback();
+}
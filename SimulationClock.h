@@ -0,0 +1,105 @@
+#ifndef SIMULATIONCLOCK_H
+#define SIMULATIONCLOCK_H
+
+#include <QObject>
+#include <QDateTime>
+#include <QPointer>
+#include <QTimer>
+#include <functional>
+#include <map>
+
+/**
+ * @brief Source of simulated time for every timer, sidereal computation and ExpiredAt stamp
+ *
+ * Modes:
+ * - RealTime: simulated time follows the wall clock (default, matches the real telescope)
+ * - Scaled:   simulated time runs N times faster than the wall clock
+ * - Stepped:  simulated time only moves when advance() is called; due events run in
+ *             order, so a scenario produces the same message sequence on every run
+ *
+ * Pick the mode at startup, before any SimTimer is started. WebSocket heartbeats and
+ * UDP discovery stay on the wall clock because they belong to the transport.
+ */
+class SimulationClock {
+public:
+    enum Mode { RealTime, Scaled, Stepped };
+    
+    SimulationClock();
+    
+    // Process-wide clock used when nothing else is injected
+    static SimulationClock &global();
+    
+    void setRealTime();
+    void setScaled(double factor);
+    void setStepped();
+    void setCurrentDateTime(const QDateTime &dateTime);
+    
+    Mode mode() const { return m_mode; }
+    double scale() const { return m_scale; }
+    
+    qint64 currentMSecsSinceEpoch() const;
+    QDateTime currentDateTime() const;
+    
+    // Wall-clock milliseconds a QTimer should wait for a simulated interval
+    int toWallInterval(int simMs) const;
+    
+    // Stepped mode: move simulated time forward, running due events in time order
+    void advance(qint64 ms);
+    
+    // Runs fn after simMs of simulated time unless context is destroyed first
+    void singleShot(int simMs, QObject *context, std::function<void()> fn);
+    
+private:
+    friend class SimTimer;
+    
+    struct ScheduledEvent {
+        QPointer<QObject> context;
+        std::function<void()> fn;
+    };
+    
+    Mode m_mode = RealTime;
+    double m_scale = 1.0;
+    qint64 m_wallAnchorMs;
+    qint64 m_simAnchorMs;
+    qint64 m_steppedNowMs = 0;
+    quint64 m_nextSequence = 0;
+    
+    // Keyed by (due time, insertion order) so simultaneous events keep FIFO order
+    std::map<std::pair<qint64, quint64>, ScheduledEvent> m_events;
+    
+    void reanchor();
+    void schedule(qint64 dueMs, QObject *context, std::function<void()> fn);
+};
+
+/**
+ * @brief QTimer replacement driven by a SimulationClock
+ *
+ * In RealTime and Scaled modes this wraps a QTimer with a scaled interval; in
+ * Stepped mode the timeout is scheduled on the clock and fires from advance().
+ */
+class SimTimer : public QObject {
+public:
+    SimTimer(SimulationClock *clock, std::function<void()> callback, QObject *parent = nullptr);
+    
+    void start(int simMs);
+    void start();
+    void stop();
+    bool isActive() const { return m_active; }
+    int interval() const { return m_interval; }
+    void setSingleShot(bool singleShot) { m_singleShot = singleShot; }
+    bool isSingleShot() const { return m_singleShot; }
+    
+private:
+    SimulationClock *m_clock;
+    std::function<void()> m_callback;
+    QTimer *m_timer;
+    int m_interval = 0;
+    bool m_singleShot = false;
+    bool m_active = false;
+    quint64 m_generation = 0;  // Invalidates stepped events scheduled before stop()
+    
+    void fire();
+    void scheduleStepped();
+};
+
+#endif // SIMULATIONCLOCK_H
@@ -0,0 +1,50 @@
+#include "SimulatorFleet.h"
+#include <QDebug>
+#include <QDir>
+#include <cmath>
+
+SimulatorFleet::SimulatorFleet(int instanceCount, const SimulatorInstanceConfig &baseConfig,
+                               const QList<QHostAddress> &bindAddresses, QObject *parent)
+    : QObject(parent) {
+    // One HiPS client serves the whole fleet
+    m_hipsClient = new ProperHipsClient(this);
+    
+    // Instances don't probe a shared client, so test the default survey once where they all start
+    const TelescopeState initialState;
+    SkyPosition initialPos = {
+        initialState.baseRA * 180.0 / M_PI,
+        initialState.baseDec * 180.0 / M_PI,
+        "Initial_Position",
+        "Fleet starting position"
+    };
+    m_hipsClient->testSurveyAtPosition("DSS2_Color", initialPos);
+    
+    for (int i = 0; i < instanceCount; ++i) {
+        SimulatorInstanceConfig config = baseConfig;
+        
+        if (!bindAddresses.isEmpty()) {
+            config.bindAddress = bindAddresses[i % bindAddresses.size()];
+            config.port = baseConfig.port + i / bindAddresses.size();
+        } else {
+            config.port = baseConfig.port + i;
+        }
+        
+        // Sequential identities keep the Origin-NNZ names unique across the fleet
+        config.broadcastId = 10 + i;
+        config.imageStoreDir = QDir(baseConfig.imageStoreDir).absoluteFilePath(QString("origin-%1").arg(config.broadcastId));
+        config.sharedHipsClient = m_hipsClient;
+        config.randomSeed = baseConfig.randomSeed >= 0 ? baseConfig.randomSeed + i : -1;
+        if (!baseConfig.sessionLogPath.isEmpty()) {
+            config.sessionLogPath = QString("%1.%2").arg(baseConfig.sessionLogPath).arg(config.broadcastId);
+        }
+        
+        CelestronOriginSimulator *simulator = new CelestronOriginSimulator(config, this);
+        if (!simulator->isListening()) {
+            qWarning() << "Fleet instance" << simulator->identity() << "failed to listen on"
+                       << config.bindAddress.toString() << config.port;
+        }
+        m_simulators.append(simulator);
+    }
+    
+    qDebug() << "Simulator fleet started with" << m_simulators.size() << "telescopes";
+}
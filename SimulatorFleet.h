@@ -0,0 +1,40 @@
+#ifndef SIMULATORFLEET_H
+#define SIMULATORFLEET_H
+
+#include <QObject>
+#include <QList>
+#include <QHostAddress>
+
+#include "CelestronOriginSimulator.h"
+
+/**
+ * @brief Hosts several independent virtual Origin telescopes in one process
+ *
+ * Every instance gets its own TelescopeState, listening port (or virtual IP),
+ * broadcast identity and image store. The HiPS client, the decoded tile cache,
+ * the global thread pool and the static TIFF encoder are shared, so a fleet of
+ * 100 telescopes costs one Qt runtime instead of 100.
+ */
+class SimulatorFleet : public QObject {
+public:
+    /**
+     * @param instanceCount Number of telescopes to start
+     * @param baseConfig Template for every instance: port is the first listening
+     *                   port (instance i uses port + i), imageStoreDir is the parent
+     *                   of the per-instance stores, randomSeed and sessionLogPath
+     *                   are suffixed per instance
+     * @param bindAddresses Optional virtual IPs; instances are spread across them
+     *                      and only step the port once every address is used
+     */
+    SimulatorFleet(int instanceCount, const SimulatorInstanceConfig &baseConfig,
+                   const QList<QHostAddress> &bindAddresses, QObject *parent = nullptr);
+
+    int size() const { return m_simulators.size(); }
+    const QList<CelestronOriginSimulator*> &simulators() const { return m_simulators; }
+
+private:
+    ProperHipsClient *m_hipsClient;
+    QList<CelestronOriginSimulator*> m_simulators;
+};
+
+#endif // SIMULATORFLEET_H
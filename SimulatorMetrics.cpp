@@ -0,0 +1,151 @@
+#include "SimulatorMetrics.h"
+#include <QMutexLocker>
+#include <QTimer>
+#include <algorithm>
+#include <cstring>
+
+static const int EVENT_LOOP_PROBE_MS = 100;
+
+SimulatorMetrics &SimulatorMetrics::instance() {
+    static SimulatorMetrics metrics;
+    return metrics;
+}
+
+SimulatorMetrics::SimulatorMetrics() {
+    const std::vector<double> fastBuckets = {0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005,
+                                             0.01, 0.025, 0.05, 0.1, 0.25, 1.0};
+    const std::vector<double> slowBuckets = {0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5,
+                                             1.0, 2.5, 5.0, 10.0, 30.0};
+
+    declare("origin_websocket_connections", Gauge, "Open WebSocket control connections");
+    declare("origin_websocket_frames_total", Counter, "WebSocket frames by direction and opcode");
+    declare("origin_websocket_missed_pongs_total", Counter, "Heartbeat pings that timed out without a pong");
+    declare("origin_websocket_deflate_bytes_total", Counter, "permessage-deflate payload bytes before and after compression");
+    declare("origin_command_duration_seconds", Histogram, "Time to handle one WebSocket command", fastBuckets);
+    declare("origin_http_requests_total", Counter, "HTTP requests by route and status");
+    declare("origin_http_response_bytes_total", Counter, "HTTP response bytes (headers and body) by route");
+    declare("origin_live_stream_frames_total", Counter, "Binary live-view frames pushed or dropped for back-pressure");
+    declare("origin_image_render_seconds", Histogram, "Image generation and encoding time by stage", slowBuckets);
+    declare("origin_hips_tile_fetch_seconds", Histogram, "HiPS tile download latency", slowBuckets);
+    declare("origin_frame_pool_total", Counter, "Frame buffer leases served from the pool vs newly allocated");
+    declare("origin_hips_tile_cache_total", Counter, "HiPS tile lookups served from cache or disk vs downloaded");
+    declare("origin_event_loop_lag_seconds", Histogram, "Main event loop scheduling delay", fastBuckets);
+}
+
+void SimulatorMetrics::declare(const char *name, Type type, const QString &help,
+                               const std::vector<double> &bounds) {
+    Family &family = m_families[QByteArray(name)];
+    family.type = type;
+    family.help = help;
+    family.bounds = bounds;
+}
+
+SimulatorMetrics::Family *SimulatorMetrics::family(const char *name) {
+    auto it = m_families.find(QByteArray::fromRawData(name, qsizetype(std::strlen(name))));
+    return it == m_families.end() ? nullptr : &it.value();
+}
+
+QString SimulatorMetrics::label(const char *key, const QString &value) {
+    QString escaped = value;
+    escaped.replace('\\', "\\\\").replace('"', "\\\"").replace('\n', "\\n");
+    return QString("%1=\"%2\"").arg(QLatin1String(key), escaped);
+}
+
+void SimulatorMetrics::increment(const char *name, const QString &labels, double amount) {
+    QMutexLocker locker(&m_mutex);
+    if (Family *f = family(name)) f->series[labels].value += amount;
+}
+
+void SimulatorMetrics::setGauge(const char *name, double value, const QString &labels) {
+    QMutexLocker locker(&m_mutex);
+    if (Family *f = family(name)) f->series[labels].value = value;
+}
+
+void SimulatorMetrics::addGauge(const char *name, double delta, const QString &labels) {
+    QMutexLocker locker(&m_mutex);
+    if (Family *f = family(name)) f->series[labels].value += delta;
+}
+
+void SimulatorMetrics::observe(const char *name, double value, const QString &labels) {
+    QMutexLocker locker(&m_mutex);
+    Family *f = family(name);
+    if (!f || f->type != Histogram) return;
+
+    Series &series = f->series[labels];
+    if (series.buckets.empty()) series.buckets.resize(f->bounds.size() + 1, 0);
+
+    size_t bucket = size_t(std::lower_bound(f->bounds.begin(), f->bounds.end(), value) - f->bounds.begin());
+    ++series.buckets[bucket];
+    ++series.count;
+    series.value += value;
+}
+
+static QByteArray seriesName(const QByteArray &name, const char *suffix, const QString &labels,
+                             const QString &extraLabel = QString()) {
+    QByteArray out = name + suffix;
+    QString all = labels;
+    if (!extraLabel.isEmpty()) all = all.isEmpty() ? extraLabel : all + "," + extraLabel;
+    if (!all.isEmpty()) out += "{" + all.toUtf8() + "}";
+    return out;
+}
+
+QByteArray SimulatorMetrics::render() const {
+    QMutexLocker locker(&m_mutex);
+    QByteArray out;
+    out.reserve(8192);
+
+    static const char *typeNames[] = {"counter", "gauge", "histogram"};
+
+    for (auto it = m_families.begin(); it != m_families.end(); ++it) {
+        const QByteArray &name = it.key();
+        const Family &f = it.value();
+
+        out += "# HELP " + name + " " + f.help.toUtf8() + "\n";
+        out += "# TYPE " + name + " " + typeNames[f.type] + "\n";
+
+        // Unlabelled counters and gauges show up as zero before the first event
+        if (f.series.isEmpty() && f.type != Histogram) {
+            out += name + " 0\n";
+            continue;
+        }
+
+        for (auto s = f.series.begin(); s != f.series.end(); ++s) {
+            const Series &series = s.value();
+
+            if (f.type != Histogram) {
+                out += seriesName(name, "", s.key()) + " " + QByteArray::number(series.value, 'g', 15) + "\n";
+                continue;
+            }
+
+            quint64 cumulative = 0;
+            for (size_t i = 0; i < f.bounds.size(); ++i) {
+                cumulative += series.buckets[i];
+                out += seriesName(name, "_bucket", s.key(), QString("le=\"%1\"").arg(f.bounds[i]))
+                     + " " + QByteArray::number(cumulative) + "\n";
+            }
+            out += seriesName(name, "_bucket", s.key(), "le=\"+Inf\"") + " " + QByteArray::number(series.count) + "\n";
+            out += seriesName(name, "_sum", s.key()) + " " + QByteArray::number(series.value, 'g', 15) + "\n";
+            out += seriesName(name, "_count", s.key()) + " " + QByteArray::number(series.count) + "\n";
+        }
+    }
+
+    return out;
+}
+
+void SimulatorMetrics::startEventLoopProbe() {
+    if (m_lagTimer) return;
+
+    // A fixed-interval timer fires late by exactly the time the loop was busy elsewhere
+    m_lagTimer = new QTimer();
+    m_lagTimer->setTimerType(Qt::PreciseTimer);
+    m_lagTimer->setInterval(EVENT_LOOP_PROBE_MS);
+    m_lagClock.start();
+    m_lagExpectedNs = qint64(EVENT_LOOP_PROBE_MS) * 1000000;
+
+    QObject::connect(m_lagTimer, &QTimer::timeout, [this]() {
+        qint64 nowNs = m_lagClock.nsecsElapsed();
+        observe("origin_event_loop_lag_seconds", qMax<qint64>(0, nowNs - m_lagExpectedNs) / 1e9);
+        m_lagExpectedNs = nowNs + qint64(EVENT_LOOP_PROBE_MS) * 1000000;
+    });
+    m_lagTimer->start();
+}
@@ -0,0 +1,81 @@
+#ifndef SIMULATORMETRICS_H
+#define SIMULATORMETRICS_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QMap>
+#include <QMutex>
+#include <QString>
+#include <vector>
+
+class QTimer;
+
+/**
+ * @brief Process-wide counters, gauges and histograms exported on GET /metrics
+ *
+ * Output follows the Prometheus text exposition format (version 0.0.4). Every
+ * simulator in a fleet shares the registry, so any instance's /metrics shows
+ * the whole process. Updates take a short mutex, so they are safe from worker
+ * threads.
+ *
+ * Metric families:
+ *   origin_websocket_connections              gauge
+ *   origin_websocket_frames_total             counter   {direction, opcode}
+ *   origin_websocket_missed_pongs_total       counter
+ *   origin_websocket_deflate_bytes_total      counter   {stage = raw|compressed}
+ *   origin_command_duration_seconds           histogram {command}
+ *   origin_http_requests_total                counter   {route, status}
+ *   origin_http_response_bytes_total          counter   {route}
+ *   origin_live_stream_frames_total           counter   {result = sent|dropped}
+ *   origin_image_render_seconds               histogram {stage}
+ *   origin_hips_tile_fetch_seconds            histogram
+ *   origin_frame_pool_total                   counter   {result = hit|miss}
+ *   origin_hips_tile_cache_total              counter   {result = hit|miss}
+ *   origin_event_loop_lag_seconds             histogram
+ */
+class SimulatorMetrics {
+public:
+    static SimulatorMetrics &instance();
+
+    void increment(const char *name, const QString &labels = QString(), double amount = 1.0);
+    void setGauge(const char *name, double value, const QString &labels = QString());
+    void addGauge(const char *name, double delta, const QString &labels = QString());
+    void observe(const char *name, double value, const QString &labels = QString());
+
+    // Formats key="value" with Prometheus escaping; join several with ','
+    static QString label(const char *key, const QString &value);
+
+    QByteArray render() const;
+
+    // Samples main-thread scheduling delay with a 100 ms timer (call once from the GUI thread)
+    void startEventLoopProbe();
+
+private:
+    enum Type { Counter, Gauge, Histogram };
+
+    struct Series {
+        double value = 0.0;                 // Counter/gauge value, or histogram sum
+        quint64 count = 0;                  // Histogram observation count
+        std::vector<quint64> buckets;       // Non-cumulative per-bucket counts
+    };
+
+    struct Family {
+        Type type = Counter;
+        QString help;
+        std::vector<double> bounds;         // Histogram upper bounds, ascending
+        QMap<QString, Series> series;       // Keyed by rendered label set
+    };
+
+    SimulatorMetrics();
+    void declare(const char *name, Type type, const QString &help,
+                 const std::vector<double> &bounds = std::vector<double>());
+    Family *family(const char *name);
+
+    mutable QMutex m_mutex;
+    QMap<QByteArray, Family> m_families;
+    QTimer *m_lagTimer = nullptr;
+    QElapsedTimer m_lagClock;
+    qint64 m_lagExpectedNs = 0;
+};
+
+#endif // SIMULATORMETRICS_H
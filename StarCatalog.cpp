@@ -0,0 +1,216 @@
+#include "StarCatalog.h"
+#include "PsfAtlas.h"
+#include "Tracer.h"
+#include <QDataStream>
+#include <QDebug>
+#include <QFile>
+#include <QRandomGenerator>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+static const double TOTAL_STARS_AT_MAG6 = 5000.0;      // Whole sky, roughly the naked-eye count
+static const double BRIGHTEST_MAG = -1.5;
+static const double GALACTIC_PLANE_BOOST = 4.0;        // Density in the plane over the poles, minus one
+static const double GALACTIC_SCALE_HEIGHT_DEG = 15.0;
+static const double NGP_RA_DEG = 192.85948;            // North galactic pole, J2000
+static const double NGP_DEC_DEG = 27.12825;
+
+// Rendered peak for a star of REFERENCE_MAG; one magnitude brighter is 2.5x
+static const double REFERENCE_MAG = 12.0;
+static const double REFERENCE_PEAK_ADU = 150.0;
+static const float SEEING_FWHM_PX = 2.2f;              // About 3.2 arcsec at 1.47 arcsec per pixel
+
+static const double DEG = M_PI / 180.0;
+
+QString StarCatalog::s_path;
+
+StarCatalog &StarCatalog::instance() {
+    static StarCatalog catalog = [] {
+        StarCatalog shared;
+        if (s_path.isEmpty() || !shared.load(s_path)) {
+            shared.generate(DEFAULT_SEED, DEFAULT_LIMITING_MAG);
+            if (!s_path.isEmpty()) shared.save(s_path);
+        }
+        return shared;
+    }();
+    return catalog;
+}
+
+StarCatalog::StarCatalog() : m_healpix(1 << HEALPIX_ORDER, NEST, SET_NSIDE) {
+    m_cellStart.assign(size_t(m_healpix.Npix()) + 1, 0);
+}
+
+void StarCatalog::generate(quint64 seed, double limitingMag) {
+    TRACE_SCOPE("catalog.generate");
+    QRandomGenerator rng(quint32(seed ^ (seed >> 32)));
+
+    const size_t count = size_t(TOTAL_STARS_AT_MAG6 * std::pow(10.0, 0.4 * (limitingMag - 6.0)));
+    const double sinNgp = std::sin(NGP_DEC_DEG * DEG);
+    const double cosNgp = std::cos(NGP_DEC_DEG * DEG);
+
+    std::vector<Entry> stars;
+    stars.reserve(count);
+    while (stars.size() < count) {
+        // Uniform on the sphere, thinned away from the galactic plane
+        double z = 2.0 * rng.generateDouble() - 1.0;
+        double ra = 2.0 * M_PI * rng.generateDouble();
+        double cosDec = std::sqrt(1.0 - z * z);
+        double sinB = z * sinNgp + cosDec * cosNgp * std::cos(ra - NGP_RA_DEG * DEG);
+        double b = std::abs(std::asin(sinB)) / DEG;
+        double keep = (1.0 + GALACTIC_PLANE_BOOST * std::exp(-b / GALACTIC_SCALE_HEIGHT_DEG))
+                    / (1.0 + GALACTIC_PLANE_BOOST);
+        if (rng.generateDouble() > keep) continue;
+
+        // N(<m) grows 0.4 dex per magnitude, so m = limit + 2.5 log10(u)
+        double u = 1.0 - rng.generateDouble();
+        Entry star;
+        star.ra = float(ra / DEG);
+        star.dec = float(std::asin(z) / DEG);
+        star.mag = float(std::max(BRIGHTEST_MAG, limitingMag + 2.5 * std::log10(u)));
+        stars.push_back(star);
+    }
+
+    buildIndex(std::move(stars));
+    qDebug() << "Generated star catalog:" << m_stars.size() << "stars to magnitude" << limitingMag;
+}
+
+void StarCatalog::buildIndex(std::vector<Entry> stars) {
+    // Counting sort by NEST cell
+    const size_t cells = size_t(m_healpix.Npix());
+    std::vector<int> cellOf(stars.size());
+    m_cellStart.assign(cells + 1, 0);
+    for (size_t i = 0; i < stars.size(); i++) {
+        cellOf[i] = m_healpix.ang2pix(pointing((90.0 - stars[i].dec) * DEG, stars[i].ra * DEG));
+        m_cellStart[size_t(cellOf[i]) + 1]++;
+    }
+    for (size_t cell = 0; cell < cells; cell++) m_cellStart[cell + 1] += m_cellStart[cell];
+
+    std::vector<quint32> next(m_cellStart.begin(), m_cellStart.end() - 1);
+    m_stars.resize(stars.size());
+    for (size_t i = 0; i < stars.size(); i++) {
+        m_stars[next[size_t(cellOf[i])]++] = stars[i];
+    }
+}
+
+bool StarCatalog::load(const QString &path) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return false;
+
+    QDataStream in(&file);
+    in.setByteOrder(QDataStream::LittleEndian);
+    in.setFloatingPointPrecision(QDataStream::SinglePrecision);
+
+    char magic[4];
+    quint32 version = 0, order = 0, count = 0;
+    if (in.readRawData(magic, 4) != 4 || memcmp(magic, "OSCT", 4) != 0) return false;
+    in >> version >> order >> count;
+    if (version != FILE_VERSION || order != quint32(HEALPIX_ORDER)) {
+        qWarning() << "Star catalog" << path << "has version" << version << "order" << order
+                   << "- expected" << FILE_VERSION << HEALPIX_ORDER;
+        return false;
+    }
+
+    std::vector<quint32> cellStart(m_cellStart.size());
+    for (quint32 &offset : cellStart) in >> offset;
+    std::vector<Entry> stars(count);
+    for (Entry &star : stars) in >> star.ra >> star.dec >> star.mag;
+    if (in.status() != QDataStream::Ok || cellStart.back() != count) {
+        qWarning() << "Star catalog" << path << "is truncated or corrupt";
+        return false;
+    }
+
+    m_cellStart.swap(cellStart);
+    m_stars.swap(stars);
+    qDebug() << "Loaded star catalog" << path << "with" << m_stars.size() << "stars";
+    return true;
+}
+
+bool StarCatalog::save(const QString &path) const {
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "Cannot write star catalog" << path;
+        return false;
+    }
+
+    QDataStream out(&file);
+    out.setByteOrder(QDataStream::LittleEndian);
+    out.setFloatingPointPrecision(QDataStream::SinglePrecision);
+
+    out.writeRawData("OSCT", 4);
+    out << FILE_VERSION << quint32(HEALPIX_ORDER) << quint32(m_stars.size());
+    for (quint32 offset : m_cellStart) out << offset;
+    for (const Entry &star : m_stars) out << star.ra << star.dec << star.mag;
+    return out.status() == QDataStream::Ok;
+}
+
+std::vector<StarCatalog::Entry> StarCatalog::query(double ra, double dec, double radius) const {
+    rangeset<int> cells;
+    m_healpix.query_disc_inclusive(pointing(M_PI / 2.0 - dec, ra), radius, cells);
+
+    const double cosRadius = std::cos(radius);
+    const double sinDec = std::sin(dec);
+    const double cosDec = std::cos(dec);
+
+    std::vector<Entry> result;
+    for (size_t range = 0; range < cells.nranges(); range++) {
+        const Entry *first = m_stars.data() + m_cellStart[size_t(cells.ivbegin(range))];
+        const Entry *last = m_stars.data() + m_cellStart[size_t(cells.ivend(range))];
+        for (const Entry *star = first; star != last; ++star) {
+            double starDec = star->dec * DEG;
+            double cosDistance = sinDec * std::sin(starDec)
+                               + cosDec * std::cos(starDec) * std::cos(star->ra * DEG - ra);
+            if (cosDistance >= cosRadius) result.push_back(*star);
+        }
+    }
+    return result;
+}
+
+std::vector<TiffImageGenerator::Star> StarCatalog::starsInView(double ra, double dec, double orientation,
+                                                               double fovX, double fovY, float blurFwhm) const {
+    TRACE_SCOPE("catalog.starsInView");
+    const int width = TiffImageGenerator::IMAGE_WIDTH;
+    const int height = TiffImageGenerator::IMAGE_HEIGHT;
+    const double scaleX = fovX / width;                 // Radians per pixel
+    const double scaleY = fovY / height;
+    const double c = std::cos(orientation);
+    const double s = std::sin(orientation);
+    const double sinDec = std::sin(dec);
+    const double cosDec = std::cos(dec);
+
+    // Half the diagonal plus the sprite radius, for stars whose halo reaches in from outside
+    const PsfAtlas &atlas = PsfAtlas::instance(PsfAtlas::defaultProfile());
+    const int reach = atlas.radiusFor(std::hypot(SEEING_FWHM_PX, blurFwhm));
+    const double radius = 0.5 * std::hypot(fovX, fovY) + reach * std::max(scaleX, scaleY);
+
+    std::vector<TiffImageGenerator::Star> stars;
+    for (const Entry &entry : query(ra, dec, radius)) {
+        // Gnomonic projection about the pointing: xi east, eta north
+        double starDec = entry.dec * DEG;
+        double dRa = entry.ra * DEG - ra;
+        double cosC = sinDec * std::sin(starDec) + cosDec * std::cos(starDec) * std::cos(dRa);
+        if (cosC <= 0.0) continue;
+        double xi = std::cos(starDec) * std::sin(dRa) / cosC;
+        double eta = (cosDec * std::sin(starDec) - sinDec * std::cos(starDec) * std::cos(dRa)) / cosC;
+
+        // Inverse of FitsWriter's CD matrix, in top-down TIFF pixels
+        double x = (width - 1) / 2.0 + (-c * xi + s * eta) / scaleX;
+        double y = (height - 1) / 2.0 - (s * xi + c * eta) / scaleY;
+
+        TiffImageGenerator::Star star = starForMagnitude(float(x), float(y), entry.mag, blurFwhm);
+        if (star.x + reach < 0 || star.x - reach >= width) continue;
+        if (star.y + reach < 0 || star.y - reach >= height) continue;
+        stars.push_back(star);
+    }
+    return stars;
+}
+
+TiffImageGenerator::Star StarCatalog::starForMagnitude(float x, float y, float mag, float blurFwhm) {
+    TiffImageGenerator::Star star;
+    star.x = x;
+    star.y = y;
+    star.fwhm = std::hypot(SEEING_FWHM_PX, blurFwhm);  // Bright stars look bigger through saturation and the PSF wings
+    float spread = SEEING_FWHM_PX / star.fwhm;          // Same flux over a wider profile
+    star.peak = float(REFERENCE_PEAK_ADU * std::pow(10.0, 0.4 * (REFERENCE_MAG - mag))) * spread * spread;
+    return star;
+}
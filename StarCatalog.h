@@ -0,0 +1,78 @@
+#ifndef STARCATALOG_H
+#define STARCATALOG_H
+
+#include <QString>
+#include <vector>
+
+#include "healpix_base.h"
+#include "TiffImageGenerator.h"
+
+/**
+ * @brief Star positions and magnitudes indexed by HEALPix cell, for rendering what is really in the FOV
+ *
+ * Stars are kept sorted by their NEST cell at HEALPIX_ORDER with an offset
+ * per cell, so a cone query walks only the few cells under the disc
+ * (query_disc_inclusive) and costs O(stars in view), not O(catalog).
+ *
+ * The process shares one catalog. It is read from setPath() if that file
+ * exists; otherwise a procedural sky is generated from a fixed seed (star
+ * counts rising 0.4 dex per magnitude down to DEFAULT_LIMITING_MAG, denser
+ * towards the galactic plane) and, when a path is set, written there. Every
+ * simulator run therefore sees the same stars at the same coordinates, and
+ * plate-solve tests can build their index from the written file.
+ *
+ * File format (little-endian): "OSCT", version, HEALPix order, star count
+ * (quint32 each), then 12 * 4^order + 1 quint32 cell offsets, then one
+ * float32 RA (deg), Dec (deg), V magnitude triple per star in cell order.
+ */
+class StarCatalog {
+public:
+    static const int HEALPIX_ORDER = 6;                 // 49152 cells of about 0.9 degrees
+    static const quint32 FILE_VERSION = 1;
+    static constexpr double DEFAULT_LIMITING_MAG = 12.0;
+    static const quint64 DEFAULT_SEED = 20240601;
+
+    struct Entry {
+        float ra;                                       // Degrees, J2000
+        float dec;
+        float mag;
+    };
+
+    // Catalog file used by every instance() created afterwards
+    static void setPath(const QString &path) { s_path = path; }
+    static StarCatalog &instance();
+
+    StarCatalog();
+
+    void generate(quint64 seed, double limitingMag);
+    bool load(const QString &path);
+    bool save(const QString &path) const;
+    size_t size() const { return m_stars.size(); }
+
+    // Stars within radius of (ra, dec), all in radians
+    std::vector<Entry> query(double ra, double dec, double radius) const;
+
+    /**
+     * @brief Stars that land on the sensor, projected through the same TAN WCS the FITS header carries
+     *
+     * Pointing, orientation and the full-frame FOV are in radians, as in
+     * TelescopeState. Stars have seeing-limited FWHM, widened in quadrature by
+     * blurFwhm pixels (defocus); flux follows magnitude, so a blurred star's
+     * peak drops as it spreads.
+     */
+    std::vector<TiffImageGenerator::Star> starsInView(double ra, double dec, double orientation,
+                                                      double fovX, double fovY, float blurFwhm = 0.0f) const;
+
+    static TiffImageGenerator::Star starForMagnitude(float x, float y, float mag, float blurFwhm = 0.0f);
+
+private:
+    void buildIndex(std::vector<Entry> stars);
+
+    static QString s_path;
+
+    Healpix_Base m_healpix;
+    std::vector<quint32> m_cellStart;                   // cells + 1 offsets into m_stars
+    std::vector<Entry> m_stars;                         // Sorted by cell
+};
+
+#endif // STARCATALOG_H
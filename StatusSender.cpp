@@ -2,6 +2,7 @@
 #include <QJsonDocument>
 #include <QJsonArray>
 #include <QDateTime>
+#include "Tracer.h"
 
 StatusSender::StatusSender(TelescopeState *state, QObject *parent) 
     : QObject(parent), m_telescopeState(state) {
@@ -19,12 +20,14 @@ void StatusSender::removeWebSocketClient(WebSocketConnection *client) {
 
 void StatusSender::sendJsonMessage(WebSocketConnection *wsConn, const QJsonObject &obj) {
     if (!wsConn) return;
+    TRACE_SCOPE("status.serialize");
     QJsonDocument doc(obj);
     QString message = doc.toJson(QJsonDocument::Compact); // Compact like real telescope
     wsConn->sendTextMessage(message);
 }
 
 void StatusSender::sendJsonMessageToAll(const QJsonObject &obj) {
+    TRACE_SCOPE("status.serialize");
     QJsonDocument doc(obj);
     QString message = doc.toJson(QJsonDocument::Compact);
     
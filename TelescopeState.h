@@ -5,16 +5,23 @@
 #include <QDateTime>
 #include <QStringList>
 #include <QRandomGenerator>
+#include "SimulationClock.h"
 
 class TelescopeState {
 public:
+    // Time source for sidereal motion and ExpiredAt stamps (injectable for time-warped runs)
+    SimulationClock *clock = &SimulationClock::global();
+    
+    // Seedable generator so a scenario replays with identical sensor values
+    QRandomGenerator rng;
+    
     QString countryCode = "GB";  // From real data
   
     // Mount data (updated with exact real telescope values from session1.pcapng)
     QString batteryLevel = "HIGH";
     double batteryVoltage = 10.38;
     QString chargerStatus = "CHARGING";
-    QDateTime dateTime = QDateTime::currentDateTime();
+    QDateTime dateTime = clock->currentDateTime();
     QString timeZone = "Europe/London";
     double latitude = 51.5072;   // London
     double longitude = 0.1276;
@@ -44,6 +51,8 @@ public:
     bool needAutoFocus = false;
     int percentageCalibrationComplete = 100;
     int position = 18447;   // Exact position from real data
+    int bestFocusPosition = 18447;  // Where stars render sharpest (--best-focus)
+    int opticsPosition = 18447;     // Where the optics really are; lags position by up to backlash
     bool requiresCalibration = false;
     double velocity = -0.0; // Real shows -0.0
     
@@ -93,6 +102,8 @@ public:
     // Image sequence (realistic cycling)
     int sequenceNumber = 0;
     int imageCounter = 0;
+    QString imageStoreDir = "/tmp";  // Per-instance capture directory
+    int diskUpdateCount = 0;
     
     // Commands being executed
     bool isSlewing = false;
@@ -134,14 +145,16 @@ public:
 	int initializationProgress = 0;  // 0-100%
 
   void syncTracking() {
-    startTime = QDateTime::currentDateTime().toMSecsSinceEpoch() / 1000.0;
+    startTime = clock->currentMSecsSinceEpoch() / 1000.0;
   }
-    TelescopeState() {
+    explicit TelescopeState(SimulationClock *simClock = &SimulationClock::global(),
+                            quint32 seed = QRandomGenerator::global()->generate())
+        : clock(simClock), rng(seed) {
         syncTracking();
         // Initialize with some random variation like real telescope
-        ambientTemperature += (QRandomGenerator::global()->bounded(200) - 100) / 100.0; // ±1°C variation
-        cpuTemperature += (QRandomGenerator::global()->bounded(400) - 200) / 100.0;     // ±2°C variation
-        dewPoint += (QRandomGenerator::global()->bounded(100) - 50) / 100.0;            // ±0.5°C variation
+        ambientTemperature += (rng.bounded(200) - 100) / 100.0; // ±1°C variation
+        cpuTemperature += (rng.bounded(400) - 200) / 100.0;     // ±2°C variation
+        dewPoint += (rng.bounded(100) - 50) / 100.0;            // ±0.5°C variation
     }
     
     int getNextSequenceId() {
@@ -152,7 +165,7 @@ public:
     qint64 getExpiredAt() {
         // Real telescope uses timestamps around 1746444725915 (future timestamp)
         // This is roughly year 2025 + some months
-        QDateTime future = QDateTime::currentDateTime().addSecs(60); // 1 minute in future
+        QDateTime future = clock->currentDateTime().addSecs(60); // 1 minute in future
         return future.toMSecsSinceEpoch();
     }
     
@@ -167,13 +180,13 @@ public:
     
     // Update celestial coordinates based on time (simulate tracking)
     void updateCelestialCoordinates() {
-        double currentTime = QDateTime::currentDateTime().toMSecsSinceEpoch() / 1000.0;
+        double currentTime = clock->currentMSecsSinceEpoch() / 1000.0;
         double elapsedTime = currentTime - startTime;
         
         // Simulate sidereal tracking - RA changes ~15 arcsec/sec, Dec stays relatively stable
         // Real telescope shows small progressive changes
         double deltaRA = elapsedTime * 0.0000116; // Approximate sidereal rate
-        double deltaDec = (QRandomGenerator::global()->bounded(20) - 10) * 0.0000001; // Small random variation
+        double deltaDec = (rng.bounded(20) - 10) * 0.0000001; // Small random variation
         
         ra = baseRA + deltaRA;
         dec = baseDec + deltaDec;
@@ -185,9 +198,9 @@ public:
     // Update environmental sensors with realistic variation
     void updateEnvironmentalSensors() {
         // Add small random variations like real sensors
-        ambientTemperature += (QRandomGenerator::global()->bounded(10) - 5) / 1000.0;  // ±0.005°C
-        cpuTemperature += (QRandomGenerator::global()->bounded(20) - 10) / 1000.0;     // ±0.01°C
-        dewPoint += (QRandomGenerator::global()->bounded(6) - 3) / 1000.0;             // ±0.003°C
+        ambientTemperature += (rng.bounded(10) - 5) / 1000.0;  // ±0.005°C
+        cpuTemperature += (rng.bounded(20) - 10) / 1000.0;     // ±0.01°C
+        dewPoint += (rng.bounded(6) - 3) / 1000.0;             // ±0.003°C
         
         // Keep within reasonable bounds
         if (ambientTemperature < 15.0) ambientTemperature = 15.0;
@@ -196,7 +209,20 @@ public:
         if (cpuTemperature > 45.0) cpuTemperature = 45.0;
         
         // Altitude varies between 59-60 like real data
-        altitude = 59 + (QRandomGenerator::global()->bounded(2));
+        altitude = 59 + (rng.bounded(2));
+    }
+    
+    // Move the focuser: lowering the position pushes the optics along, raising it
+    // first takes up the backlash, so upward moves stop up to backlash steps short
+    void moveFocuser(int target) {
+        position = target;
+        opticsPosition = qBound(target - qMax(0, backlash), opticsPosition, target);
+    }
+    
+    // FWHM in pixels that defocus adds to every star (geometric blur disc of the f/2.2 beam)
+    double defocusBlurPixels() const {
+        const double pixelsPerStep = 0.02;  // About 50 focuser steps per pixel of blur
+        return pixelsPerStep * qAbs(opticsPosition - bestFocusPosition);
     }
     
     // Get next image filename (cycles through 0-9 like real telescope)
@@ -208,15 +234,14 @@ public:
     // Get next image filename (cycles through 0-9 like real telescope)
     QString getNextTIFFFile() {
         imageCounter = (imageCounter + 1) % 10;
-        return QString("/tmp/Images_%1.tiff").arg(imageCounter);
+        return QString("%1/Images_%2.tiff").arg(imageStoreDir).arg(imageCounter);
     }
     
     // Update disk space (slowly decreasing like real usage)
     void updateDiskSpace() {
         // Decrease free space slowly (simulate image storage)
-        static int updateCount = 0;
-        if (++updateCount % 100 == 0) { // Every 100 updates
-            freeBytes -= QRandomGenerator::global()->bounded(1000000); // Remove ~1MB
+        if (++diskUpdateCount % 100 == 0) { // Every 100 updates
+            freeBytes -= rng.bounded(1000000); // Remove ~1MB
             if (freeBytes < capacity / 2) {
                 freeBytes = capacity - 10000000; // Reset to reasonable level
             }
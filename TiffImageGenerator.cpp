@@ -5,59 +5,188 @@
 #include <cstring>
 #include <cstdlib>
 #include <cmath>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <QThread>
+#include <zlib.h>
+#include "FrameBufferPool.h"
+#include "PsfAtlas.h"
+#include "SensorNoise.h"
+#include "Tracer.h"
+
+static const int MAX_COMPRESS_THREADS = 8;
+
+TiffImageGenerator::Compression TiffImageGenerator::s_compression = TiffImageGenerator::CompressionNone;
+bool TiffImageGenerator::s_rawBayer = false;
+
+bool TiffImageGenerator::parseCompression(const QString& name, Compression* compression) {
+    const QString mode = name.toLower();
+    if (mode == "none") *compression = CompressionNone;
+    else if (mode == "lzw") *compression = CompressionLZW;
+    else if (mode == "deflate") *compression = CompressionDeflate;
+    else if (mode == "zstd") *compression = CompressionZSTD;
+    else return false;
+    return true;
+}
+
+// TIFF-flavour LZW: MSB-first codes of 9..12 bits, Clear = 256, EOI = 257, and
+// the code width grows one code early (as soon as the next free code would not fit)
+static void lzwEncode(const uint8_t *src, size_t size, std::vector<uint8_t> &out) {
+    const int CODE_CLEAR = 256;
+    const int CODE_EOI = 257;
+    const int CODE_FIRST = 258;
+    const int CODE_LIMIT = 4094;             // Table full: emit Clear and start over
+    const int HASH_SIZE = 9973;              // Prime, a bit over twice the table size
+
+    // Open-addressed (prefix, byte) -> code table
+    std::vector<int32_t> hashKeys(HASH_SIZE);
+    std::vector<uint16_t> hashCodes(HASH_SIZE);
+
+    uint32_t bitBuffer = 0;
+    int bitCount = 0;
+    int nbits = 9;
+    int freeCode = CODE_FIRST;
+
+    out.clear();
+    out.reserve(size / 2 + 16);
+
+    auto putCode = [&](int code) {
+        bitBuffer = (bitBuffer << nbits) | uint32_t(code);
+        bitCount += nbits;
+        while (bitCount >= 8) {
+            bitCount -= 8;
+            out.push_back(uint8_t(bitBuffer >> bitCount));
+        }
+    };
+    auto resetTable = [&]() {
+        std::fill(hashKeys.begin(), hashKeys.end(), -1);
+        nbits = 9;
+        freeCode = CODE_FIRST;
+    };
+    // The decoder adds an entry for every code after the first, so the width
+    // tracks the table as it will look once the code just written is decoded
+    auto addEntry = [&]() {
+        if (++freeCode == CODE_LIMIT) {
+            putCode(CODE_CLEAR);
+            resetTable();
+        } else if (freeCode > (1 << nbits) - 1) {
+            nbits++;
+        }
+    };
+
+    resetTable();
+    putCode(CODE_CLEAR);
+    if (size == 0) {
+        putCode(CODE_EOI);
+    } else {
+        int prefix = src[0];
+        for (size_t i = 1; i < size; i++) {
+            int c = src[i];
+            int32_t key = (prefix << 8) | c;
+            size_t h = size_t(key) % HASH_SIZE;
+            while (hashKeys[h] != -1 && hashKeys[h] != key) {
+                h = h + 1 == size_t(HASH_SIZE) ? 0 : h + 1;
+            }
+            if (hashKeys[h] == key) {
+                prefix = hashCodes[h];
+                continue;
+            }
+
+            putCode(prefix);
+            int code = freeCode;
+            addEntry();
+            if (freeCode != CODE_FIRST) {        // Not just cleared
+                hashKeys[h] = key;
+                hashCodes[h] = uint16_t(code);
+            }
+            prefix = c;
+        }
+        putCode(prefix);
+        addEntry();
+        putCode(CODE_EOI);
+    }
+
+    if (bitCount > 0) out.push_back(uint8_t(bitBuffer << (8 - bitCount)));
+}
+
+// Horizontal differencing (TIFF predictor 2) in place, then LZW or zlib
+static bool encodeStrip(TiffImageGenerator::Compression compression, uint16_t *samples,
+                        int width, int rows, int spp, std::vector<uint8_t> &out) {
+    for (int row = 0; row < rows; row++) {
+        uint16_t *line = samples + size_t(row) * width * spp;
+        for (int i = width * spp - 1; i >= spp; i--) {
+            line[i] = uint16_t(line[i] - line[i - spp]);
+        }
+    }
+
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(samples);
+    size_t size = size_t(rows) * width * spp * sizeof(uint16_t);
+
+    if (compression == TiffImageGenerator::CompressionLZW) {
+        lzwEncode(bytes, size, out);
+        return true;
+    }
+
+    uLongf length = compressBound(uLong(size));
+    out.resize(length);
+    if (compress2(out.data(), &length, bytes, uLong(size), Z_DEFAULT_COMPRESSION) != Z_OK) return false;
+    out.resize(length);
+    return true;
+}
 
 bool TiffImageGenerator::generateOriginFormatTiff(const QString& outputPath, 
                                                     const QImage& sourceImage) {
     qDebug() << "Generating Origin-format TIFF:" << outputPath;
     
-    // Allocate 16-bit RGB buffer (3 channels, 16-bit each)
-    size_t pixelCount = IMAGE_WIDTH * IMAGE_HEIGHT;
-    size_t bufferSize = pixelCount * SAMPLES_PER_PIXEL * sizeof(uint16_t);
-    uint16_t* imageData = (uint16_t*)malloc(bufferSize);
+    StripSource source;
+    QImage scaled;
+    const bool raw = s_rawBayer;
     
-    if (!imageData) {
-        qDebug() << "Failed to allocate image buffer";
-        return false;
-    }
-    
-    // Initialize with default data
     if (sourceImage.isNull()) {
         // Create a simple gradient for testing
-        for (int y = 0; y < IMAGE_HEIGHT; y++) {
-            for (int x = 0; x < IMAGE_WIDTH; x++) {
-                size_t idx = (y * IMAGE_WIDTH + x) * SAMPLES_PER_PIXEL;
-                
-                // Create a subtle gradient (16-bit range: 0-65535)
-                uint16_t value = (uint16_t)((x * 65535.0) / IMAGE_WIDTH);
-                
-                imageData[idx + 0] = value;      // R
-                imageData[idx + 1] = value / 2;  // G
-                imageData[idx + 2] = value / 3;  // B
+        source = [raw](uint16_t *dst, int firstRow, int rowCount) {
+            for (int row = 0; row < rowCount; row++) {
+                for (int x = 0; x < IMAGE_WIDTH; x++) {
+                    // Create a subtle gradient (16-bit range: 0-65535)
+                    uint16_t value = (uint16_t)((x * 65535.0) / IMAGE_WIDTH);
+                    
+                    if (raw) {
+                        *dst++ = value / (cfaChannel(x, firstRow + row) + 1);
+                        continue;
+                    }
+                    *dst++ = value;      // R
+                    *dst++ = value / 2;  // G
+                    *dst++ = value / 3;  // B
+                }
             }
-        }
+            return true;
+        };
     } else {
-        // Scale and convert source image
-        QImage scaled = sourceImage.scaled(IMAGE_WIDTH, IMAGE_HEIGHT, 
-                                           Qt::IgnoreAspectRatio, 
-                                           Qt::SmoothTransformation);
+        // Scale only when needed; the mosaic path already hands us a full-size RGB888 frame
+        scaled = sourceImage;
+        if (scaled.width() != IMAGE_WIDTH || scaled.height() != IMAGE_HEIGHT) {
+            scaled = scaled.scaled(IMAGE_WIDTH, IMAGE_HEIGHT, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+        }
+        scaled = scaled.convertToFormat(QImage::Format_RGB888);
         
-        for (int y = 0; y < IMAGE_HEIGHT; y++) {
-            for (int x = 0; x < IMAGE_WIDTH; x++) {
-                QRgb pixel = scaled.pixel(x, y);
-                size_t idx = (y * IMAGE_WIDTH + x) * SAMPLES_PER_PIXEL;
-                
-                // Convert 8-bit RGB to 16-bit RGB (scale 0-255 to 0-65535)
-                imageData[idx + 0] = (uint16_t)((qRed(pixel) * 65535) / 255);
-                imageData[idx + 1] = (uint16_t)((qGreen(pixel) * 65535) / 255);
-                imageData[idx + 2] = (uint16_t)((qBlue(pixel) * 65535) / 255);
+        source = [&scaled, raw](uint16_t *dst, int firstRow, int rowCount) {
+            for (int row = 0; row < rowCount; row++) {
+                const uchar *line = scaled.constScanLine(firstRow + row);
+                if (raw) {
+                    uint16_t *out = dst + size_t(row) * IMAGE_WIDTH;
+                    for (int x = 0; x < IMAGE_WIDTH; x++) {
+                        out[x] = uint16_t(line[x * 3 + cfaChannel(x, firstRow + row)] * 257);
+                    }
+                } else {
+                    convert8BitTo16Bit(line, dst + size_t(row) * IMAGE_WIDTH * SAMPLES_PER_PIXEL, IMAGE_WIDTH, 1);
+                }
             }
-        }
+            return true;
+        };
     }
     
-    // Write TIFF
-    bool success = writeTiff16BitRGB(outputPath, imageData, IMAGE_WIDTH, IMAGE_HEIGHT);
-    
-    free(imageData);
+    bool success = writeTiff16BitStrips(outputPath, IMAGE_WIDTH, IMAGE_HEIGHT, samplesPerPixel(), source);
     
     if (success) {
         qDebug() << "Successfully generated TIFF:" << outputPath;
@@ -69,60 +198,64 @@ bool TiffImageGenerator::generateOriginFormatTiff(const QString& outputPath,
 }
 
 bool TiffImageGenerator::generateSyntheticStarField(const QString& outputPath, int numStars) {
-    qDebug() << "Generating synthetic star field with" << numStars << "stars";
-    
-    // Allocate 16-bit RGB buffer
-    size_t pixelCount = IMAGE_WIDTH * IMAGE_HEIGHT;
-    size_t bufferSize = pixelCount * SAMPLES_PER_PIXEL * sizeof(uint16_t);
-    uint16_t* imageData = (uint16_t*)malloc(bufferSize);
+    return generateSyntheticStarField(outputPath, numStars,
+                                      SensorNoise(SensorNoise::Settings(), quint64(QDateTime::currentMSecsSinceEpoch())));
+}
+
+bool TiffImageGenerator::generateSyntheticStarField(const QString& outputPath, int numStars,
+                                                    const SensorNoise& noise) {
+    // Place the stars up front so each strip can draw the ones that touch it
+    srand(QDateTime::currentMSecsSinceEpoch());
+    return generateSyntheticStarField(outputPath, randomStars(numStars), noise);
+}
+
+bool TiffImageGenerator::generateSyntheticStarField(const QString& outputPath, const std::vector<Star>& stars,
+                                                    const SensorNoise& noise) {
+    TRACE_SCOPE("tiff.starField");
+    qDebug() << "Generating synthetic star field with" << stars.size() << "stars";
     
-    if (!imageData) {
-        qDebug() << "Failed to allocate image buffer";
-        return false;
+    // Bucket stars by the strips their sprites touch, so a dense field costs
+    // O(stars) per frame rather than O(stars) per strip
+    const PsfAtlas &atlas = PsfAtlas::instance(PsfAtlas::defaultProfile());
+    const int stripCount = (IMAGE_HEIGHT + ROWS_PER_STRIP - 1) / ROWS_PER_STRIP;
+    std::vector<std::vector<Star>> starsByStrip(size_t(stripCount));
+    for (const Star &star : stars) {
+        int reach = atlas.radiusFor(star.fwhm) + 1;
+        int first = qMax(0, int(std::floor(star.y)) - reach) / ROWS_PER_STRIP;
+        int last = qMin(IMAGE_HEIGHT - 1, int(std::floor(star.y)) + reach) / ROWS_PER_STRIP;
+        for (int strip = first; strip <= last; strip++) starsByStrip[size_t(strip)].push_back(star);
     }
     
-    // Initialize with dark sky background (slight noise)
-    for (size_t i = 0; i < pixelCount * SAMPLES_PER_PIXEL; i++) {
-        imageData[i] = rand() % 500;  // Dark background with noise
+    // In raw Bayer mode every pixel carries one filtered sample, a third of the work
+    const int spp = samplesPerPixel();
+    // Drawing and noise only read shared state, so strips render on the writer's workers
+    return writeTiff16BitStrips(outputPath, IMAGE_WIDTH, IMAGE_HEIGHT, spp,
+                                [&starsByStrip, &noise, spp](uint16_t *dst, int firstRow, int rowCount) {
+        // Noiseless scene first, then sky, dark current and readout on top
+        memset(dst, 0, size_t(rowCount) * IMAGE_WIDTH * spp * sizeof(uint16_t));
+        drawStars(starsByStrip[size_t(firstRow / ROWS_PER_STRIP)], dst, firstRow, rowCount, spp);
+        noise.apply(dst, firstRow, rowCount, spp);
+        return true;
+    }, true);
+}
+
+std::vector<TiffImageGenerator::Star> TiffImageGenerator::randomStars(int numStars) {
+    std::vector<Star> stars(size_t(qMax(0, numStars)));
+    for (Star &star : stars) {
+        star.x = rand() % IMAGE_WIDTH;
+        star.y = rand() % IMAGE_HEIGHT;
+        star.peak = 20000 + (rand() % 45535);  // Bright stars
+        star.fwhm = 1.67f * (1 + (rand() % 3));  // Star size
     }
-    
-    // Add stars
-    srand(QDateTime::currentMSecsSinceEpoch());
-    
-    for (int i = 0; i < numStars; i++) {
-        int x = rand() % IMAGE_WIDTH;
-        int y = rand() % IMAGE_HEIGHT;
-        uint16_t brightness = 20000 + (rand() % 45535);  // Bright stars
-        int radius = 1 + (rand() % 3);  // Star size
-        
-        // Draw star with Gaussian-like profile
-        for (int dy = -radius; dy <= radius; dy++) {
-            for (int dx = -radius; dx <= radius; dx++) {
-                int px = x + dx;
-                int py = y + dy;
-                
-                if (px >= 0 && px < IMAGE_WIDTH && py >= 0 && py < IMAGE_HEIGHT) {
-                    float dist = sqrt(dx*dx + dy*dy);
-                    float intensity = exp(-dist * dist / (radius * radius));
-                    
-                    size_t idx = (py * IMAGE_WIDTH + px) * SAMPLES_PER_PIXEL;
-                    uint16_t starValue = (uint16_t)(brightness * intensity);
-                    
-                    // Add to all channels (white star)
-                    imageData[idx + 0] = std::min(65535, (int)imageData[idx + 0] + starValue);
-                    imageData[idx + 1] = std::min(65535, (int)imageData[idx + 1] + starValue);
-                    imageData[idx + 2] = std::min(65535, (int)imageData[idx + 2] + starValue);
-                }
-            }
-        }
+    return stars;
+}
+
+void TiffImageGenerator::drawStars(const std::vector<Star>& stars, uint16_t* dst, int firstRow, int rowCount,
+                                   int samplesPerPixel) {
+    PsfAtlas &atlas = PsfAtlas::instance(PsfAtlas::defaultProfile());
+    for (const Star &star : stars) {
+        atlas.draw(star, dst, firstRow, rowCount, samplesPerPixel);
     }
-    
-    // Write TIFF
-    bool success = writeTiff16BitRGB(outputPath, imageData, IMAGE_WIDTH, IMAGE_HEIGHT);
-    
-    free(imageData);
-    
-    return success;
 }
 
 bool TiffImageGenerator::convertToOriginTiff(const QString& inputPath, 
@@ -141,6 +274,53 @@ bool TiffImageGenerator::convertToOriginTiff(const QString& inputPath,
 bool TiffImageGenerator::writeTiff16BitRGB(const QString& outputPath, 
                                             const uint16_t* imageData,
                                             int width, int height) {
+    size_t rowSamples = size_t(width) * SAMPLES_PER_PIXEL;
+    return writeTiff16BitStrips(outputPath, width, height, SAMPLES_PER_PIXEL,
+                                [&](uint16_t *dst, int firstRow, int rowCount) {
+        memcpy(dst, imageData + size_t(firstRow) * rowSamples, size_t(rowCount) * rowSamples * sizeof(uint16_t));
+        return true;
+    });
+}
+
+bool TiffImageGenerator::writeTiff16BitBayer(const QString& outputPath, const uint16_t* cfa,
+                                             int width, int height) {
+    return writeTiff16BitStrips(outputPath, width, height, 1, [&](uint16_t *dst, int firstRow, int rowCount) {
+        memcpy(dst, cfa + size_t(firstRow) * width, size_t(rowCount) * width * sizeof(uint16_t));
+        return true;
+    });
+}
+
+void TiffImageGenerator::convertToBayer(const QImage& rgb888, uint16_t* cfa) {
+    TRACE_SCOPE("tiff.toBayer");
+    for (int y = 0; y < IMAGE_HEIGHT; y++) {
+        const uchar *line = rgb888.constScanLine(y);
+        uint16_t *out = cfa + size_t(y) * IMAGE_WIDTH;
+        for (int x = 0; x < IMAGE_WIDTH; x++) {
+            out[x] = uint16_t(line[x * 3 + cfaChannel(x, y)] * 257);
+        }
+    }
+}
+
+QImage TiffImageGenerator::debayerSuperpixel(const uint16_t* cfa, int width, int height) {
+    TRACE_SCOPE("tiff.debayer");
+    QImage preview(width / 2, height / 2, QImage::Format_RGB888);
+    for (int y = 0; y < preview.height(); y++) {
+        const uint16_t *top = cfa + size_t(2 * y) * width;
+        const uint16_t *bottom = top + width;
+        uchar *out = preview.scanLine(y);
+        for (int x = 0; x < preview.width(); x++) {
+            *out++ = uchar(top[2 * x] >> 8);                                    // R
+            *out++ = uchar((int(top[2 * x + 1]) + bottom[2 * x]) >> 9);         // mean of the two Gs
+            *out++ = uchar(bottom[2 * x + 1] >> 8);                             // B
+        }
+    }
+    return preview;
+}
+
+bool TiffImageGenerator::writeTiff16BitStrips(const QString& outputPath, int width, int height,
+                                              int samplesPerPixel, const StripSource& source,
+                                              bool threadSafeSource) {
+    TRACE_SCOPE("tiff.write");
     // Open TIFF file for writing
     TIFF* tif = TIFFOpen(outputPath.toUtf8().constData(), "w");
     if (!tif) {
@@ -152,29 +332,84 @@ bool TiffImageGenerator::writeTiff16BitRGB(const QString& outputPath,
     TIFFSetField(tif, TIFFTAG_IMAGEWIDTH, width);
     TIFFSetField(tif, TIFFTAG_IMAGELENGTH, height);
     TIFFSetField(tif, TIFFTAG_BITSPERSAMPLE, 16);
-    TIFFSetField(tif, TIFFTAG_SAMPLESPERPIXEL, 3);
-    TIFFSetField(tif, TIFFTAG_PHOTOMETRIC, PHOTOMETRIC_RGB);
-    TIFFSetField(tif, TIFFTAG_COMPRESSION, COMPRESSION_NONE);
+    TIFFSetField(tif, TIFFTAG_SAMPLESPERPIXEL, samplesPerPixel);
+    if (samplesPerPixel == 1) {
+        // Raw sensor mosaic; no portable CFA tag outside DNG, so say it in the description
+        TIFFSetField(tif, TIFFTAG_PHOTOMETRIC, PHOTOMETRIC_MINISBLACK);
+        TIFFSetField(tif, TIFFTAG_IMAGEDESCRIPTION, "Bayer RGGB");
+    } else {
+        TIFFSetField(tif, TIFFTAG_PHOTOMETRIC, PHOTOMETRIC_RGB);
+    }
     TIFFSetField(tif, TIFFTAG_PLANARCONFIG, PLANARCONFIG_CONTIG);  // Single image plane
     TIFFSetField(tif, TIFFTAG_ORIENTATION, ORIENTATION_TOPLEFT);
-    TIFFSetField(tif, TIFFTAG_ROWSPERSTRIP, TIFFDefaultStripSize(tif, width * 3 * 2));
+    TIFFSetField(tif, TIFFTAG_ROWSPERSTRIP, ROWS_PER_STRIP);
+    
+    Compression compression = s_compression;
+    if (compression == CompressionZSTD && !TIFFIsCODECConfigured(COMPRESSION_ZSTD)) {
+        qWarning() << "libtiff was built without ZSTD, writing Deflate instead";
+        compression = CompressionDeflate;
+    }
+    
+    switch (compression) {
+        case CompressionNone: TIFFSetField(tif, TIFFTAG_COMPRESSION, COMPRESSION_NONE); break;
+        case CompressionLZW: TIFFSetField(tif, TIFFTAG_COMPRESSION, COMPRESSION_LZW); break;
+        case CompressionDeflate: TIFFSetField(tif, TIFFTAG_COMPRESSION, COMPRESSION_ADOBE_DEFLATE); break;
+        case CompressionZSTD: TIFFSetField(tif, TIFFTAG_COMPRESSION, COMPRESSION_ZSTD); break;
+    }
+    if (compression != CompressionNone) {
+        TIFFSetField(tif, TIFFTAG_PREDICTOR, PREDICTOR_HORIZONTAL);
+    }
     
     // Set software tag to match Origin
     QString softwareTag = QString("OriginSimulator %1")
                           .arg(QDateTime::currentDateTime().toString("MM-dd-yyyy HH:mm"));
     TIFFSetField(tif, TIFFTAG_SOFTWARE, softwareTag.toUtf8().constData());
     
-    // Write image data row by row
-    size_t rowSize = width * SAMPLES_PER_PIXEL * sizeof(uint16_t);
+    if (compression == CompressionLZW || compression == CompressionDeflate) {
+        bool success = writeCompressedStrips(tif, compression, width, height, samplesPerPixel, source,
+                                             threadSafeSource);
+        TIFFClose(tif);
+        return success;
+    }
     
-    for (int row = 0; row < height; row++) {
-        const uint16_t* rowData = imageData + (row * width * SAMPLES_PER_PIXEL);
+    // Pooled strip buffers refilled by the source, one at a time unless it may
+    // run on several threads; libtiff applies the ZSTD codec itself
+    const int stripCount = (height + ROWS_PER_STRIP - 1) / ROWS_PER_STRIP;
+    const int workers = threadSafeSource ? qBound(1, QThread::idealThreadCount(), MAX_COMPRESS_THREADS) : 1;
+    const int batchSize = threadSafeSource ? workers * 2 : 1;
+    size_t rowSamples = size_t(width) * samplesPerPixel;
+    std::vector<FrameLease> strips;
+    for (int i = 0; i < batchSize; i++) {
+        strips.push_back(FrameBufferPool::instance().acquire(rowSamples * ROWS_PER_STRIP * sizeof(uint16_t)));
+        if (strips.back().isNull()) {
+            TIFFClose(tif);
+            return false;
+        }
+    }
+    
+    for (int batchStart = 0; batchStart < stripCount; batchStart += batchSize) {
+        const int count = qMin(batchSize, stripCount - batchStart);
         
-        if (TIFFWriteScanline(tif, (void*)rowData, row, 0) < 0) {
-            qDebug() << "Failed to write TIFF scanline" << row;
+        bool filled = runOnWorkers(count, workers, [&](int i) {
+            int firstRow = (batchStart + i) * ROWS_PER_STRIP;
+            return source(strips[size_t(i)].samples16(), firstRow, qMin(ROWS_PER_STRIP, height - firstRow));
+        });
+        if (!filled) {
+            qDebug() << "TIFF strip source failed from row" << batchStart * ROWS_PER_STRIP;
             TIFFClose(tif);
             return false;
         }
+        
+        for (int i = 0; i < count; i++) {
+            int firstRow = (batchStart + i) * ROWS_PER_STRIP;
+            int rowCount = qMin(ROWS_PER_STRIP, height - firstRow);
+            tmsize_t stripBytes = tmsize_t(size_t(rowCount) * rowSamples * sizeof(uint16_t));
+            if (TIFFWriteEncodedStrip(tif, uint32_t(batchStart + i), strips[size_t(i)].samples16(), stripBytes) < 0) {
+                qDebug() << "Failed to write TIFF strip at row" << firstRow;
+                TIFFClose(tif);
+                return false;
+            }
+        }
     }
     
     // Close the TIFF file
@@ -182,3 +417,88 @@ bool TiffImageGenerator::writeTiff16BitRGB(const QString& outputPath,
     
     return true;
 }
+
+bool TiffImageGenerator::writeCompressedStrips(TIFF* tif, Compression compression, int width, int height,
+                                              int samplesPerPixel, const StripSource& source,
+                                              bool threadSafeSource) {
+    TRACE_SCOPE("tiff.compress");
+    const int stripCount = (height + ROWS_PER_STRIP - 1) / ROWS_PER_STRIP;
+    const int workers = qBound(1, QThread::idealThreadCount(), MAX_COMPRESS_THREADS);
+    
+    // Strips go in batches of a couple per worker: filled (here, unless the
+    // source is thread-safe), compressed in parallel, then written in strip order
+    const int batchSize = workers * 2;
+    size_t rowSamples = size_t(width) * samplesPerPixel;
+    std::vector<FrameLease> strips;
+    for (int i = 0; i < batchSize; i++) {
+        strips.push_back(FrameBufferPool::instance().acquire(rowSamples * ROWS_PER_STRIP * sizeof(uint16_t)));
+        if (strips.back().isNull()) return false;
+    }
+    std::vector<std::vector<uint8_t>> encoded(size_t(batchSize));
+    
+    for (int batchStart = 0; batchStart < stripCount; batchStart += batchSize) {
+        const int count = qMin(batchSize, stripCount - batchStart);
+        
+        auto fillStrip = [&](int i) {
+            int firstRow = (batchStart + i) * ROWS_PER_STRIP;
+            if (source(strips[size_t(i)].samples16(), firstRow, qMin(ROWS_PER_STRIP, height - firstRow))) return true;
+            qDebug() << "TIFF strip source failed at row" << firstRow;
+            return false;
+        };
+        if (!threadSafeSource) {
+            for (int i = 0; i < count; i++) {
+                if (!fillStrip(i)) return false;
+            }
+        }
+        
+        bool compressed = runOnWorkers(count, workers, [&](int i) {
+            if (threadSafeSource && !fillStrip(i)) return false;
+            int firstRow = (batchStart + i) * ROWS_PER_STRIP;
+            return encodeStrip(compression, strips[size_t(i)].samples16(), width,
+                               qMin(ROWS_PER_STRIP, height - firstRow), samplesPerPixel, encoded[size_t(i)]);
+        });
+        if (!compressed) {
+            qDebug() << "Failed to compress TIFF strips from row" << batchStart * ROWS_PER_STRIP;
+            return false;
+        }
+        
+        for (int i = 0; i < count; i++) {
+            const std::vector<uint8_t> &data = encoded[size_t(i)];
+            if (TIFFWriteRawStrip(tif, uint32_t(batchStart + i), (void*)data.data(), tmsize_t(data.size())) < 0) {
+                qDebug() << "Failed to write TIFF strip" << batchStart + i;
+                return false;
+            }
+        }
+    }
+    
+    return true;
+}
+
+bool TiffImageGenerator::runOnWorkers(int count, int workers, const std::function<bool(int)>& work) {
+    std::atomic<int> next{0};
+    std::atomic<bool> failed{false};
+    auto worker = [&]() {
+        for (int i = next++; i < count; i = next++) {
+            if (!work(i)) failed = true;
+        }
+    };
+    
+    std::vector<std::thread> threads;
+    for (int t = 1; t < qMin(workers, count); t++) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+    return !failed;
+}
+
+void TiffImageGenerator::convert8BitTo16Bit(const uint8_t* src8bit, uint16_t* dst16bit, 
+                                            int width, int height) {
+    // x * 257 maps 0..255 exactly onto 0..65535, same as (x * 65535) / 255
+    size_t count = size_t(width) * height * SAMPLES_PER_PIXEL;
+    for (size_t i = 0; i < count; i++) {
+        dst16bit[i] = uint16_t(src8bit[i] * 257);
+    }
+}
@@ -4,6 +4,10 @@
 #include <QString>
 #include <QImage>
 #include <tiffio.h>
+#include <functional>
+#include <vector>
+
+class SensorNoise;
 
 /**
  * @brief Generates TIFF images matching Origin telescope format
@@ -16,6 +20,14 @@
  * - Photometric Interpretation: RGB color
  * - Compression: None
  * - Planar Configuration: single image plane
+ *
+ * setCompression() trades that exact tag set for smaller files: LZW and
+ * Deflate strips are encoded on worker threads and appended in order, ZSTD
+ * goes through libtiff's codec when it was built with one.
+ *
+ * setRawBayer() switches captures to what the one-shot-colour sensor really
+ * records: one 16-bit plane of RGGB colour-filter samples, a third of the
+ * size and render cost. Clients debayer it themselves.
  */
 class TiffImageGenerator {
 public:
@@ -24,6 +36,51 @@ public:
     static const int IMAGE_HEIGHT = 2048;
     static const int BITS_PER_SAMPLE = 16;
     static const int SAMPLES_PER_PIXEL = 3; // RGB
+    static const int ROWS_PER_STRIP = 16;   // ~290 KB of 16-bit RGB per strip at full width
+    
+    enum Compression {
+        CompressionNone,        // Matches the real Origin
+        CompressionLZW,
+        CompressionDeflate,
+        CompressionZSTD
+    };
+    
+    // Applies to every TIFF written afterwards; compressed modes add a horizontal predictor
+    static void setCompression(Compression compression) { s_compression = compression; }
+    static Compression compression() { return s_compression; }
+    static bool parseCompression(const QString& name, Compression* compression);
+    
+    // Raw RGGB mosaic (1 sample per pixel) instead of RGB for every capture written afterwards
+    static void setRawBayer(bool enabled) { s_rawBayer = enabled; }
+    static bool rawBayer() { return s_rawBayer; }
+    static int samplesPerPixel() { return s_rawBayer ? 1 : SAMPLES_PER_PIXEL; }
+    
+    // Colour filter over pixel (x, y) in the RGGB pattern: 0 = R, 1 = G, 2 = B
+    static int cfaChannel(int x, int y) { return (y & 1) ? ((x & 1) ? 2 : 1) : ((x & 1) ? 1 : 0); }
+    
+    /**
+     * @brief Sample a full-size RGB888 frame through the RGGB filter into a 16-bit mosaic
+     * @param cfa IMAGE_WIDTH * IMAGE_HEIGHT samples
+     */
+    static void convertToBayer(const QImage& rgb888, uint16_t* cfa);
+    
+    /**
+     * @brief Write a 16-bit single-plane RGGB mosaic as a capture TIFF
+     */
+    static bool writeTiff16BitBayer(const QString& outputPath, const uint16_t* cfa, int width, int height);
+    
+    /**
+     * @brief Half-resolution 8-bit preview: each 2x2 RGGB cell becomes one RGB pixel
+     */
+    static QImage debayerSuperpixel(const uint16_t* cfa, int width, int height);
+    
+    /**
+     * @brief Fills rows [firstRow, firstRow + rowCount) with interleaved 16-bit samples
+     *
+     * dst holds rowCount * width * samplesPerPixel samples (RGB, or one RGGB
+     * mosaic sample in raw Bayer mode). Return false to abort the write.
+     */
+    using StripSource = std::function<bool(uint16_t *dst, int firstRow, int rowCount)>;
     
     /**
      * @brief Generate a 16-bit RGB TIFF file matching Origin format
@@ -42,6 +99,24 @@ public:
      */
     static bool generateSyntheticStarField(const QString& outputPath, int numStars = 100);
     
+    /**
+     * @brief Same, read out through the given sensor noise model (default settings, clock seed above)
+     */
+    static bool generateSyntheticStarField(const QString& outputPath, int numStars, const SensorNoise& noise);
+    
+    struct Star {
+        float x;            // Pixel centres are at whole numbers; fractions land between pixels
+        float y;
+        float peak;         // ADU at the PSF centre; above 65535 the core clips and the wings spread
+        float fwhm;         // Pixels
+    };
+    
+    /**
+     * @brief Render the given stars (e.g. StarCatalog::starsInView) and read them out through noise
+     */
+    static bool generateSyntheticStarField(const QString& outputPath, const std::vector<Star>& stars,
+                                           const SensorNoise& noise);
+    
     /**
      * @brief Convert existing JPG/PNG to 16-bit RGB TIFF
      * @param inputPath Path to source image
@@ -49,8 +124,48 @@ public:
      * @return true if successful, false otherwise
      */
     static bool convertToOriginTiff(const QString& inputPath, const QString& outputPath);
+    
+    // Random star positions and sizes across the sensor (uses rand())
+    static std::vector<Star> randomStars(int numStars);
+    
+    /**
+     * @brief Add white stars to rows [firstRow, firstRow + rowCount) of dst
+     *
+     * dst is laid out as a StripSource buffer with samplesPerPixel samples per pixel;
+     * stars outside the rows are skipped, so callers can draw strip by strip.
+     * Stars are blitted from the PsfAtlas of PsfAtlas::defaultProfile().
+     */
+    static void drawStars(const std::vector<Star>& stars, uint16_t* dst, int firstRow, int rowCount,
+                          int samplesPerPixel);
+    
+    /**
+     * @brief Write a 16-bit TIFF (RGB, or RGGB mosaic with 1 sample per pixel) one strip at a time
+     *
+     * Only one strip buffer is alive at once, so rendering a frame costs a few
+     * hundred KB instead of a full 37 MB image. A threadSafeSource is instead
+     * called for a couple of strips per worker thread at once.
+     */
+    static bool writeTiff16BitStrips(const QString& outputPath, int width, int height,
+                                     int samplesPerPixel, const StripSource& source,
+                                     bool threadSafeSource = false);
 
 private:
+    friend class OriginBench;
+    
+    static Compression s_compression;
+    static bool s_rawBayer;
+    
+    /**
+     * @brief Compress strips on worker threads and append them in order as raw strips
+     */
+    static bool writeCompressedStrips(TIFF* tif, Compression compression, int width, int height,
+                                      int samplesPerPixel, const StripSource& source, bool threadSafeSource);
+    
+    /**
+     * @brief Call work(i) for each i in [0, count) on up to workers threads; false if any call failed
+     */
+    static bool runOnWorkers(int count, int workers, const std::function<bool(int)>& work);
+    
     /**
      * @brief Write 16-bit RGB TIFF using libtiff
      */
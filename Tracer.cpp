@@ -0,0 +1,201 @@
+#include "Tracer.h"
+#include <QDebug>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+#include <chrono>
+#include <vector>
+
+static const int RING_CAPACITY = 16384;          // Spans kept per thread
+static const int HEARTBEAT_INTERVAL_MS = 20;
+static const int MONITOR_INTERVAL_MS = 10;
+
+struct TraceEvent {
+    const char *name;
+    qint64 startNs;
+    qint64 durationNs;
+};
+
+struct TraceRing {
+    TraceEvent events[RING_CAPACITY];
+    std::atomic<quint64> head{0};
+    int threadIndex = 0;
+    QByteArray threadName;
+
+    // Innermost open span, read by the watchdog thread
+    std::atomic<const char *> activeName{nullptr};
+    std::atomic<qint64> activeStartNs{0};
+
+    void push(const char *name, qint64 startNs, qint64 durationNs) {
+        quint64 index = head.load(std::memory_order_relaxed);
+        events[index % RING_CAPACITY] = {name, startNs, durationNs};
+        head.store(index + 1, std::memory_order_release);
+    }
+};
+
+std::atomic<bool> Tracer::s_enabled{true};
+
+static QMutex s_ringsMutex;
+static std::vector<TraceRing *> s_rings;         // Never freed; a thread's spans outlive it
+static std::atomic<TraceRing *> s_mainRing{nullptr};
+static thread_local TraceRing *t_ring = nullptr;
+
+static TraceRing *localRing() {
+    if (!t_ring) {
+        TraceRing *ring = new TraceRing();
+        QString name = QThread::currentThread()->objectName();
+
+        QMutexLocker locker(&s_ringsMutex);
+        ring->threadIndex = int(s_rings.size()) + 1;
+        ring->threadName = name.isEmpty() ? QByteArray("thread-") + QByteArray::number(ring->threadIndex)
+                                          : name.toUtf8();
+        s_rings.push_back(ring);
+        t_ring = ring;
+    }
+    return t_ring;
+}
+
+qint64 Tracer::nowNs() {
+    static const auto epoch = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+void Tracer::recordSpan(const char *name, qint64 startNs, qint64 durationNs) {
+    if (!isEnabled()) return;
+    localRing()->push(name, startNs, durationNs);
+}
+
+void Tracer::markMainThread() {
+    TraceRing *ring = localRing();
+    ring->threadName = "main";
+    s_mainRing.store(ring, std::memory_order_release);
+}
+
+const char *Tracer::mainThreadActiveSpan(qint64 *sinceNs) {
+    TraceRing *ring = s_mainRing.load(std::memory_order_acquire);
+    if (!ring) return nullptr;
+
+    const char *name = ring->activeName.load(std::memory_order_acquire);
+    if (sinceNs) *sinceNs = ring->activeStartNs.load(std::memory_order_relaxed);
+    return name;
+}
+
+QByteArray Tracer::chromeTraceJson() {
+    std::vector<TraceRing *> rings;
+    {
+        QMutexLocker locker(&s_ringsMutex);
+        rings = s_rings;
+    }
+
+    QByteArray out;
+    out.reserve(1024 * 1024);
+    out += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+
+    for (TraceRing *ring : rings) {
+        QByteArray tid = QByteArray::number(ring->threadIndex);
+
+        out += first ? "" : ",";
+        first = false;
+        out += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" + tid
+             + ",\"args\":{\"name\":\"" + ring->threadName + "\"}}";
+
+        quint64 head = ring->head.load(std::memory_order_acquire);
+        quint64 begin = head > quint64(RING_CAPACITY) ? head - RING_CAPACITY : 0;
+        for (quint64 i = begin; i < head; ++i) {
+            const TraceEvent event = ring->events[i % RING_CAPACITY];
+            if (!event.name) continue;
+            out += ",{\"name\":\"";
+            out += event.name;
+            out += "\",\"ph\":\"X\",\"pid\":1,\"tid\":" + tid
+                 + ",\"ts\":" + QByteArray::number(event.startNs / 1000.0, 'f', 3)
+                 + ",\"dur\":" + QByteArray::number(event.durationNs / 1000.0, 'f', 3) + "}";
+        }
+    }
+
+    out += "]}";
+    return out;
+}
+
+TraceScope::TraceScope(const char *name) : m_name(nullptr) {
+    if (!Tracer::isEnabled()) return;
+
+    TraceRing *ring = localRing();
+    m_name = name;
+    m_parentName = ring->activeName.load(std::memory_order_relaxed);
+    m_parentStartNs = ring->activeStartNs.load(std::memory_order_relaxed);
+    m_startNs = Tracer::nowNs();
+    ring->activeStartNs.store(m_startNs, std::memory_order_relaxed);
+    ring->activeName.store(name, std::memory_order_release);
+}
+
+TraceScope::~TraceScope() {
+    if (!m_name) return;
+
+    TraceRing *ring = t_ring;
+    ring->push(m_name, m_startNs, Tracer::nowNs() - m_startNs);
+    ring->activeStartNs.store(m_parentStartNs, std::memory_order_relaxed);
+    ring->activeName.store(m_parentName, std::memory_order_release);
+}
+
+StallWatchdog::~StallWatchdog() {
+    stop();
+}
+
+void StallWatchdog::start(int thresholdMs) {
+    if (thresholdMs <= 0 || m_running) return;
+
+    Tracer::markMainThread();
+    m_thresholdMs = thresholdMs;
+    m_lastBeatNs = Tracer::nowNs();
+
+    m_heartbeatTimer = new QTimer();
+    m_heartbeatTimer->setTimerType(Qt::PreciseTimer);
+    m_heartbeatTimer->setInterval(HEARTBEAT_INTERVAL_MS);
+    QObject::connect(m_heartbeatTimer, &QTimer::timeout, [this]() {
+        m_lastBeatNs.store(Tracer::nowNs(), std::memory_order_relaxed);
+    });
+    m_heartbeatTimer->start();
+
+    m_running = true;
+    m_thread = std::thread([this]() { monitor(); });
+}
+
+void StallWatchdog::stop() {
+    if (!m_running) return;
+
+    m_running = false;
+    if (m_thread.joinable()) m_thread.join();
+    delete m_heartbeatTimer;
+    m_heartbeatTimer = nullptr;
+}
+
+void StallWatchdog::monitor() {
+    const qint64 thresholdNs = qint64(m_thresholdMs) * 1000000;
+    qint64 stalledBeatNs = -1;       // Heartbeat value when the current stall was reported
+    const char *stalledSpan = nullptr;
+
+    while (m_running.load(std::memory_order_relaxed)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(MONITOR_INTERVAL_MS));
+
+        qint64 beat = m_lastBeatNs.load(std::memory_order_relaxed);
+        qint64 now = Tracer::nowNs();
+
+        if (stalledBeatNs < 0 && now - beat > thresholdNs) {
+            qint64 spanStartNs = 0;
+            stalledSpan = Tracer::mainThreadActiveSpan(&spanStartNs);
+            stalledBeatNs = beat;
+            qWarning().noquote() << QString("Event loop stalled for %1 ms, main thread in span '%2'%3")
+                                        .arg((now - beat) / 1000000)
+                                        .arg(stalledSpan ? stalledSpan : "<untraced>")
+                                        .arg(stalledSpan ? QString(" (open %1 ms)").arg((now - spanStartNs) / 1000000)
+                                                         : QString());
+        } else if (stalledBeatNs >= 0 && beat != stalledBeatNs) {
+            qWarning().noquote() << QString("Event loop recovered after %1 ms stall in '%2'")
+                                        .arg((beat - stalledBeatNs) / 1000000 - HEARTBEAT_INTERVAL_MS)
+                                        .arg(stalledSpan ? stalledSpan : "<untraced>");
+            stalledBeatNs = -1;
+            stalledSpan = nullptr;
+        }
+    }
+}
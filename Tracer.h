@@ -0,0 +1,88 @@
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <QByteArray>
+#include <QTimer>
+#include <atomic>
+#include <thread>
+
+/**
+ * @brief Scoped span tracer with per-thread ring buffers
+ *
+ * TRACE_SCOPE("name") records how long the enclosing block took. Each thread
+ * writes only to its own fixed-size ring (no locks, no allocation after the
+ * thread's first span); the oldest spans are overwritten. chromeTraceJson()
+ * snapshots every ring as Chrome trace-event JSON for chrome://tracing or
+ * Perfetto. A snapshot taken while a thread is wrapping its ring may contain
+ * a torn event or two; that is the price of a lock-free writer.
+ *
+ * Span names must be string literals (only the pointer is stored).
+ */
+class Tracer {
+public:
+    static qint64 nowNs();
+
+    static void setEnabled(bool enabled) { s_enabled.store(enabled, std::memory_order_relaxed); }
+    static bool isEnabled() { return s_enabled.load(std::memory_order_relaxed); }
+
+    // For work whose start and end happen in different callbacks (e.g. network replies)
+    static void recordSpan(const char *name, qint64 startNs, qint64 durationNs);
+
+    // Innermost open span on the main thread, for the stall watchdog
+    static const char *mainThreadActiveSpan(qint64 *sinceNs = nullptr);
+    static void markMainThread();
+
+    static QByteArray chromeTraceJson();
+
+private:
+    friend class TraceScope;
+    static std::atomic<bool> s_enabled;
+};
+
+class TraceScope {
+public:
+    explicit TraceScope(const char *name);
+    ~TraceScope();
+
+    TraceScope(const TraceScope &) = delete;
+    TraceScope &operator=(const TraceScope &) = delete;
+
+private:
+    const char *m_name;
+    const char *m_parentName;
+    qint64 m_parentStartNs;
+    qint64 m_startNs;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope_, __LINE__)(name)
+
+/**
+ * @brief Logs main event-loop stalls together with the span that caused them
+ *
+ * A main-thread timer bumps a heartbeat every few ms; a monitor thread warns
+ * once the heartbeat is older than the threshold, naming the span open on the
+ * main thread at that moment, and again with the total when the loop recovers.
+ * This catches the blocking calls that make clients miss pongs.
+ */
+class StallWatchdog {
+public:
+    StallWatchdog() = default;
+    ~StallWatchdog();
+
+    // Must be called from the main thread; thresholdMs <= 0 leaves the watchdog off
+    void start(int thresholdMs);
+    void stop();
+
+private:
+    void monitor();
+
+    QTimer *m_heartbeatTimer = nullptr;
+    std::thread m_thread;
+    std::atomic<bool> m_running{false};
+    std::atomic<qint64> m_lastBeatNs{0};
+    int m_thresholdMs = 0;
+};
+
+#endif // TRACER_H
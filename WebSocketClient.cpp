@@ -0,0 +1,180 @@
+#include "WebSocketClient.h"
+#include <QCryptographicHash>
+#include <QRandomGenerator>
+
+WebSocketClient::WebSocketClient(QObject *parent) : QObject(parent) {
+    m_socket = new QTcpSocket(this);
+    m_socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+
+    connect(m_socket, &QTcpSocket::readyRead, this, [this]() { handleData(); });
+    connect(m_socket, &QTcpSocket::disconnected, this, [this]() {
+        m_open = false;
+        if (onDisconnected) onDisconnected();
+    });
+    connect(m_socket, &QTcpSocket::errorOccurred, this, [this](QAbstractSocket::SocketError) {
+        if (onError) onError(m_socket->errorString());
+    });
+}
+
+void WebSocketClient::connectToHost(const QString &host, quint16 port, const QString &path) {
+    QByteArray nonce(16, Qt::Uninitialized);
+    for (char &byte : nonce) {
+        byte = char(QRandomGenerator::global()->bounded(256));
+    }
+    QByteArray key = nonce.toBase64();
+    m_expectedAccept = QCryptographicHash::hash(key + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11",
+                                                QCryptographicHash::Sha1).toBase64();
+
+    connect(m_socket, &QTcpSocket::connected, this, [this, host, port, path, key]() {
+        QByteArray request = "GET " + path.toUtf8() + " HTTP/1.1\r\n";
+        request += "Host: " + host.toUtf8() + ":" + QByteArray::number(port) + "\r\n";
+        request += "Upgrade: websocket\r\n";
+        request += "Connection: Upgrade\r\n";
+        request += "Sec-WebSocket-Key: " + key + "\r\n";
+        request += "Sec-WebSocket-Version: 13\r\n\r\n";
+        m_socket->write(request);
+    }, Qt::SingleShotConnection);
+
+    m_socket->connectToHost(host, port);
+}
+
+void WebSocketClient::close() {
+    if (m_open) {
+        sendFrame(0x08, QByteArray::fromHex("03e8")); // 1000 normal closure
+    }
+    m_socket->disconnectFromHost();
+}
+
+void WebSocketClient::sendTextMessage(const QByteArray &utf8) {
+    if (m_open) sendFrame(0x01, utf8);
+}
+
+void WebSocketClient::sendFrame(quint8 opcode, const QByteArray &payload) {
+    QByteArray frame;
+    frame.reserve(payload.size() + 14);
+    frame.append(char(0x80 | opcode));
+
+    // Client frames must be masked
+    if (payload.size() < 126) {
+        frame.append(char(0x80 | payload.size()));
+    } else if (payload.size() < 65536) {
+        frame.append(char(0x80 | 126));
+        frame.append(char((payload.size() >> 8) & 0xFF));
+        frame.append(char(payload.size() & 0xFF));
+    } else {
+        frame.append(char(0x80 | 127));
+        for (int i = 7; i >= 0; --i) {
+            frame.append(char((quint64(payload.size()) >> (i * 8)) & 0xFF));
+        }
+    }
+
+    quint32 maskValue = QRandomGenerator::global()->generate();
+    char mask[4];
+    for (int i = 0; i < 4; ++i) {
+        mask[i] = char((maskValue >> (i * 8)) & 0xFF);
+    }
+    frame.append(mask, 4);
+
+    qsizetype offset = frame.size();
+    frame.append(payload);
+    char *data = frame.data() + offset;
+    for (qsizetype i = 0; i < payload.size(); ++i) {
+        data[i] ^= mask[i & 3];
+    }
+
+    m_socket->write(frame);
+}
+
+void WebSocketClient::handleData() {
+    m_buffer.append(m_socket->readAll());
+
+    if (!m_open) {
+        int headerEnd = m_buffer.indexOf("\r\n\r\n");
+        if (headerEnd < 0) return;
+
+        QByteArray head = m_buffer.left(headerEnd);
+        m_buffer.remove(0, headerEnd + 4);
+
+        if (!head.startsWith("HTTP/1.1 101") || !head.contains(m_expectedAccept)) {
+            if (onError) onError("WebSocket upgrade rejected: " + QString::fromUtf8(head.left(head.indexOf("\r\n"))));
+            m_socket->disconnectFromHost();
+            return;
+        }
+
+        m_open = true;
+        if (onConnected) onConnected();
+    }
+
+    processFrames();
+}
+
+void WebSocketClient::processFrames() {
+    qsizetype pos = 0;
+
+    while (m_buffer.size() - pos >= 2) {
+        const uchar *header = reinterpret_cast<const uchar *>(m_buffer.constData() + pos);
+        bool fin = header[0] & 0x80;
+        quint8 opcode = header[0] & 0x0F;
+        bool masked = header[1] & 0x80;
+        quint64 length = header[1] & 0x7F;
+        qsizetype headerSize = 2;
+
+        if (length == 126) {
+            if (m_buffer.size() - pos < 4) break;
+            length = (quint64(header[2]) << 8) | header[3];
+            headerSize = 4;
+        } else if (length == 127) {
+            if (m_buffer.size() - pos < 10) break;
+            length = 0;
+            for (int i = 0; i < 8; ++i) {
+                length = (length << 8) | header[2 + i];
+            }
+            headerSize = 10;
+        }
+        if (masked) headerSize += 4;
+
+        if (quint64(m_buffer.size() - pos - headerSize) < length) break;
+
+        QByteArray payload = m_buffer.mid(pos + headerSize, qsizetype(length));
+        if (masked) {
+            const char *mask = m_buffer.constData() + pos + headerSize - 4;
+            for (qsizetype i = 0; i < payload.size(); ++i) {
+                payload[i] = payload[i] ^ mask[i & 3];
+            }
+        }
+        pos += headerSize + qsizetype(length);
+
+        // Data frames accumulate until FIN; control frames may arrive in between
+        if (opcode <= 0x02) {
+            if (opcode != 0x00) {
+                m_messageOpcode = opcode;
+                m_message.clear();
+            }
+            m_message.append(payload);
+            if (!fin) continue;
+            payload.swap(m_message);
+            m_message.clear();
+            opcode = m_messageOpcode;
+        }
+
+        switch (opcode) {
+            case 0x01:
+                if (onTextMessage) onTextMessage(payload);
+                break;
+            case 0x02:
+                if (onBinaryMessage) onBinaryMessage(payload);
+                break;
+            case 0x08:
+                m_open = false;
+                m_socket->disconnectFromHost();
+                break;
+            case 0x09:
+                sendFrame(0x0A, payload);
+                break;
+            default:
+                break;
+        }
+    }
+
+    m_buffer.remove(0, pos);
+}
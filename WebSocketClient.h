@@ -0,0 +1,47 @@
+#ifndef WEBSOCKETCLIENT_H
+#define WEBSOCKETCLIENT_H
+
+#include <QObject>
+#include <QTcpSocket>
+#include <functional>
+
+/**
+ * @brief Minimal client side of the Origin WebSocket endpoint
+ *
+ * Used by the replay and load tools, which drive the simulator the same way the
+ * Origin app does: HTTP upgrade, masked text frames out, unmasked frames in.
+ * Fragmented messages are reassembled and pings are answered automatically. Callbacks run on the socket's thread.
+ */
+class WebSocketClient : public QObject {
+public:
+    explicit WebSocketClient(QObject *parent = nullptr);
+
+    void connectToHost(const QString &host, quint16 port,
+                       const QString &path = "/SmartScope-1.0/mountControlEndpoint");
+    void close();
+
+    bool isOpen() const { return m_open; }
+    QTcpSocket *socket() const { return m_socket; }
+
+    void sendTextMessage(const QByteArray &utf8);
+
+    std::function<void()> onConnected;
+    std::function<void(const QByteArray &)> onTextMessage;
+    std::function<void(const QByteArray &)> onBinaryMessage;
+    std::function<void(const QString &)> onError;
+    std::function<void()> onDisconnected;
+
+private:
+    void handleData();
+    void processFrames();
+    void sendFrame(quint8 opcode, const QByteArray &payload);
+
+    QTcpSocket *m_socket;
+    QByteArray m_buffer;
+    QByteArray m_expectedAccept;
+    bool m_open = false;
+    quint8 m_messageOpcode = 0;      // Opcode of a fragmented message in progress
+    QByteArray m_message;
+};
+
+#endif // WEBSOCKETCLIENT_H
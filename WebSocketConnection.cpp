@@ -2,17 +2,109 @@
 // This will help us see exactly what's happening with frame processing
 
 #include "WebSocketConnection.h"
+#include "HttpRequest.h"
+#include "SessionLog.h"
+#include "SimulatorMetrics.h"
+#include "Tracer.h"
 #include <QCryptographicHash>
 #include <QDebug>
 #include <QTime>
+#include <cstring>
+#include <zlib.h>
+#ifdef Q_OS_UNIX
+#include <cerrno>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#endif
+#if defined(__SSE2__) || defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
 
 enum {debug=true};
 
+// Messages shorter than this go out uncompressed (RSV1 clear); deflate can't win on them
+static const int DEFLATE_MIN_SIZE = 64;
+
+// Binary frames at least this large are streamed to binaryDataReceived as they arrive
+static const int STREAM_THRESHOLD = 64 * 1024;
+
+// Queued outbound data is written immediately once it reaches either limit
+static const qint64 WRITE_BATCH_BYTES = 256 * 1024;
+static const int WRITE_BATCH_CHUNKS = 64;
+
+// Negotiated permessage-deflate state; raw deflate streams that persist across
+// messages unless the peer asked for no context takeover
+struct WebSocketDeflate {
+    z_stream deflater;
+    z_stream inflater;
+    bool serverNoContextTakeover = false;
+    bool clientNoContextTakeover = false;
+    
+    WebSocketDeflate(int serverWindowBits) {
+        memset(&deflater, 0, sizeof(deflater));
+        memset(&inflater, 0, sizeof(inflater));
+        deflateInit2(&deflater, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -serverWindowBits, 8, Z_DEFAULT_STRATEGY);
+        inflateInit2(&inflater, -15);
+    }
+    
+    ~WebSocketDeflate() {
+        deflateEnd(&deflater);
+        inflateEnd(&inflater);
+    }
+};
+
+bool WebSocketConnection::s_deflateEnabled = false;
+qint64 WebSocketConnection::s_maxMessageSize = 16 * 1024 * 1024;
+int WebSocketConnection::s_fragmentSize = 256 * 1024;
+
+// Label sets are built once so counting a frame doesn't format strings
+static const QString &frameLabels(bool outbound, quint8 opcode) {
+    static QString labels[2][16];
+    QString &entry = labels[outbound][opcode & 0x0F];
+    if (entry.isEmpty()) {
+        static const char *names[16] = {"continuation", "text", "binary", "3", "4", "5", "6", "7",
+                                        "close", "ping", "pong", "11", "12", "13", "14", "15"};
+        entry = QString("direction=\"%1\",opcode=\"%2\"").arg(outbound ? "out" : "in", names[opcode & 0x0F]);
+    }
+    return entry;
+}
+
 void WebSocketConnection::sendTextMessage(const QString &message) {
     if (!m_handshakeComplete || !m_socket) return;
     
     QByteArray data = message.toUtf8();
-    sendFrame(0x01, data); // Text frame
+    if (m_recorder) m_recorder->record(SessionRecordKind::WebSocketOutbound, m_connectionId, data);
+    sendMessage(0x01, data); // Text message
+}
+
+void WebSocketConnection::sendBinaryMessage(const QByteArray &data) {
+    if (!m_handshakeComplete || !m_socket) return;
+    
+    sendMessage(0x02, data); // Binary message
+}
+
+// Compresses when negotiated and splits anything over s_fragmentSize into a
+// first frame plus continuation frames; only the first carries RSV1
+void WebSocketConnection::sendMessage(quint8 opcode, const QByteArray &data) {
+    QByteArray compressed;
+    // Binary messages carry JPEG frames, which deflate only makes slower
+    bool isCompressed = m_deflate && opcode == 0x01 && data.size() >= DEFLATE_MIN_SIZE && deflateMessage(data, compressed);
+    const QByteArray &payload = isCompressed ? compressed : data;
+    
+    if (s_fragmentSize <= 0 || payload.size() <= s_fragmentSize) {
+        sendFrame(opcode, payload, false, isCompressed);
+        return;
+    }
+    
+    for (qsizetype offset = 0; offset < payload.size(); offset += s_fragmentSize) {
+        qsizetype length = qMin<qsizetype>(s_fragmentSize, payload.size() - offset);
+        bool first = offset == 0;
+        bool last = offset + length == payload.size();
+        quint8 firstByte = (last ? 0x80 : 0x00) | (first && isCompressed ? 0x40 : 0x00) | (first ? opcode : 0x00);
+        queueFrame(firstByte, payload, offset, length, false);
+    }
 }
 
 void WebSocketConnection::sendPongMessage(const QByteArray &payload) {
@@ -36,55 +128,145 @@ void WebSocketConnection::sendPingMessage(const QByteArray &payload) {
      if (debug) qDebug() << "WebSocket ping sent with payload size:" << payload.size();
 }
 
-void WebSocketConnection::sendFrame(quint8 opcode, const QByteArray &payload, bool masked) {
-    QByteArray frame;
+void WebSocketConnection::sendFrame(quint8 opcode, const QByteArray &payload, bool masked, bool compressed, bool fin) {
+    quint8 firstByte = (fin ? 0x80 : 0x00) | (compressed ? 0x40 : 0x00) | opcode; // FIN, RSV1=compressed, Opcode
+    queueFrame(firstByte, payload, 0, payload.size(), masked);
+}
+
+// Queues header and payload as separate chunks; the payload QByteArray is shared,
+// not copied. Everything queued during one event-loop pass goes out in flushFrames().
+void WebSocketConnection::queueFrame(quint8 firstByte, const QByteArray &payload, qsizetype offset, qsizetype length, bool masked) {
+    TRACE_SCOPE("ws.sendFrame");
     
     // Frame format: FIN(1) + RSV(3) + Opcode(4) + MASK(1) + Payload Length(7+) + Payload
-    frame.append(0x80 | opcode); // FIN=1, Opcode
-    
-    if (payload.size() < 126) {
-        frame.append(payload.size() | (masked ? 0x80 : 0x00));
-    } else if (payload.size() < 65536) {
-        frame.append(126 | (masked ? 0x80 : 0x00));
-        frame.append((payload.size() >> 8) & 0xFF);
-        frame.append(payload.size() & 0xFF);
+    char header[10];
+    int headerSize = 2;
+    header[0] = char(firstByte);
+    if (length < 126) {
+        header[1] = char(length | (masked ? 0x80 : 0x00));
+    } else if (length < 65536) {
+        header[1] = char(126 | (masked ? 0x80 : 0x00));
+        header[2] = char((length >> 8) & 0xFF);
+        header[3] = char(length & 0xFF);
+        headerSize = 4;
     } else {
-        frame.append(127 | (masked ? 0x80 : 0x00));
+        header[1] = char(127 | (masked ? 0x80 : 0x00));
         for (int i = 7; i >= 0; --i) {
-            frame.append((payload.size() >> (i * 8)) & 0xFF);
+            header[9 - i] = char((quint64(length) >> (i * 8)) & 0xFF);
         }
+        headerSize = 10;
     }
     
     // Note: Server-to-client frames are not masked (as per WebSocket spec)
-    frame.append(payload);
-    
-    if (0) if (debug) qDebug() << "Sending WebSocket frame - Opcode:" << QString("0x%1").arg(opcode, 2, 16, QChar('0'))
-             << "Size:" << frame.size() << "Payload size:" << payload.size();
+    m_writeQueue.append({QByteArray(header, headerSize), 0, headerSize});
+    if (length > 0) m_writeQueue.append({payload, offset, length});
+    m_queuedBytes += headerSize + length;
+    
+    if (0) if (debug) qDebug() << "Queued WebSocket frame - Opcode:" << QString("0x%1").arg(firstByte & 0x0F, 2, 16, QChar('0'))
+             << "Payload size:" << length;
+    
+    SimulatorMetrics::instance().increment("origin_websocket_frames_total", frameLabels(true, firstByte & 0x0F));
+    
+    // Large backlogs (image pushes, loops without an event loop) are written right away
+    if (m_queuedBytes >= WRITE_BATCH_BYTES || m_writeQueue.size() >= WRITE_BATCH_CHUNKS) {
+        flushFrames();
+    } else if (!m_flushScheduled) {
+        m_flushScheduled = true;
+        QMetaObject::invokeMethod(this, [this]() {
+            m_flushScheduled = false;
+            flushFrames();
+        }, Qt::QueuedConnection);
+    }
+}
+
+// Writes all queued chunks with one gather write where the platform has one.
+// Qt's own write buffer is only bypassed while it is empty, so bytes never
+// overtake data Qt is still holding; whatever the kernel refuses goes through it.
+void WebSocketConnection::flushFrames() {
+    if (m_writeQueue.isEmpty()) return;
+    TRACE_SCOPE("ws.flush");
+    
+    if (!m_socket || m_socket->state() != QAbstractSocket::ConnectedState) {
+        m_writeQueue.clear();
+        m_queuedBytes = 0;
+        return;
+    }
     
-    qint64 bytesWritten = m_socket->write(frame);
-    if (debug && bytesWritten != frame.size()) qDebug() << "Bytes written to socket:" << bytesWritten << "Expected:" << frame.size();
+    int next = 0;
+    qsizetype partial = 0;    // Bytes of m_writeQueue[next] already sent
+    
+#ifdef Q_OS_UNIX
+    qintptr fd = m_socket->socketDescriptor();
+    if (fd != -1 && m_socket->bytesToWrite() == 0) {
+        while (next < m_writeQueue.size()) {
+            iovec iov[WRITE_BATCH_CHUNKS];
+            int count = 0;
+            for (int i = next; i < m_writeQueue.size() && count < WRITE_BATCH_CHUNKS; ++i, ++count) {
+                const QueuedChunk &chunk = m_writeQueue[i];
+                qsizetype skip = (i == next) ? partial : 0;
+                iov[count].iov_base = const_cast<char *>(chunk.data.constData() + chunk.offset + skip);
+                iov[count].iov_len = size_t(chunk.length - skip);
+            }
+            
+            msghdr message = {};
+            message.msg_iov = iov;
+            message.msg_iovlen = count;
+#ifdef MSG_NOSIGNAL
+            ssize_t sent = ::sendmsg(int(fd), &message, MSG_NOSIGNAL);
+#else
+            ssize_t sent = ::sendmsg(int(fd), &message, 0);
+#endif
+            if (sent < 0) {
+                if (errno == EINTR) continue;
+                break; // EAGAIN or a real error: let Qt buffer the rest and report errors
+            }
+            
+            // Advance past fully written chunks
+            while (sent > 0) {
+                qsizetype left = m_writeQueue[next].length - partial;
+                if (sent >= left) {
+                    sent -= left;
+                    partial = 0;
+                    ++next;
+                } else {
+                    partial += sent;
+                    sent = 0;
+                }
+            }
+            if (partial > 0) break; // Kernel buffer is full
+        }
+    }
+#endif
+    
+    for (int i = next; i < m_writeQueue.size(); ++i) {
+        const QueuedChunk &chunk = m_writeQueue[i];
+        qsizetype skip = (i == next) ? partial : 0;
+        if (skip == 0 && chunk.offset == 0 && chunk.length == chunk.data.size()) {
+            m_socket->write(chunk.data);    // Shared into Qt's ring buffer, no copy
+        } else {
+            m_socket->write(chunk.data.constData() + chunk.offset + skip, chunk.length - skip);
+        }
+    }
     
-    // Force flush to ensure data is sent immediately
-    m_socket->flush();
+    m_writeQueue.clear();
+    m_queuedBytes = 0;
 }
 
 
 // Updated performHandshake to set completion flag and start ping cycle
 bool WebSocketConnection::performHandshake(const QByteArray &requestData) {
-    QString request = QString::fromUtf8(requestData);
-    QStringList lines = request.split("\r\n");
+    HttpRequest request;
+    if (request.parse(requestData) != HttpRequest::Complete) return false;
+    return performHandshake(request);
+}
+
+bool WebSocketConnection::performHandshake(const HttpRequest &request) {
+    TRACE_SCOPE("ws.handshake");
     
      if (debug) qDebug() << "*** PERFORMING WEBSOCKET HANDSHAKE ***";
-     if (debug) qDebug() << "Request lines:" << lines.size();
-    
-    QString webSocketKey;
-    for (const QString &line : lines) {
-        if (line.startsWith("Sec-WebSocket-Key:", Qt::CaseInsensitive)) {
-            webSocketKey = line.mid(18).trimmed();
-            break;
-        }
-    }
+     if (debug) qDebug() << "Request headers:" << request.headers().size();
     
+    QByteArrayView webSocketKey = request.header("Sec-WebSocket-Key");
     if (webSocketKey.isEmpty()) {
          if (debug) qDebug() << "*** HANDSHAKE FAILED: No WebSocket key found ***";
         return false;
@@ -93,18 +275,22 @@ bool WebSocketConnection::performHandshake(const QByteArray &requestData) {
      if (debug) qDebug() << "WebSocket key found:" << webSocketKey;
     
     // Generate WebSocket accept key
-    QString acceptKey = webSocketKey + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
-    QByteArray acceptHash = QCryptographicHash::hash(acceptKey.toUtf8(), QCryptographicHash::Sha1);
-    QString acceptValue = acceptHash.toBase64();
+    QByteArray acceptKey = webSocketKey.toByteArray() + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+    QByteArray acceptValue = QCryptographicHash::hash(acceptKey, QCryptographicHash::Sha1).toBase64();
     
     // Send WebSocket handshake response
-    QString response = "HTTP/1.1 101 Switching Protocols\r\n";
+    QByteArray response = "HTTP/1.1 101 Switching Protocols\r\n";
     response += "Upgrade: websocket\r\n";
     response += "Connection: Upgrade\r\n";
-    response += QString("Sec-WebSocket-Accept: %1\r\n").arg(acceptValue);
+    response += "Sec-WebSocket-Accept: " + acceptValue + "\r\n";
+    
+    QByteArray extensions = negotiateDeflate(request);
+    if (!extensions.isEmpty()) {
+        response += "Sec-WebSocket-Extensions: " + extensions + "\r\n";
+    }
     response += "\r\n";
     
-    qint64 bytesWritten = m_socket->write(response.toUtf8());
+    qint64 bytesWritten = m_socket->write(response);
     m_socket->flush();
     
      if (debug) qDebug() << "*** HANDSHAKE RESPONSE SENT ***";
@@ -133,6 +319,12 @@ void WebSocketConnection::handleData() {
         return;
     }
     
+    // After we started a close for a protocol error nothing more is parsed
+    if (m_closing) {
+        m_socket->readAll();
+        return;
+    }
+    
     qint64 bytesAvailable = m_socket->bytesAvailable();
      if (debug) qDebug() << "*** WEBSOCKET DATA HANDLER CALLED ***";
      if (debug) qDebug() << "Bytes available:" << bytesAvailable;
@@ -159,6 +351,10 @@ void WebSocketConnection::handleData() {
     // Process all complete frames
     while (!m_pendingData.isEmpty()) {
         int frameSize = processFrame(m_pendingData);
+        if (m_closing) {
+            m_pendingData.clear();
+            break;
+        }
         if (frameSize <= 0) {
             if (debug) qDebug() << "Waiting for more data to complete frame";
             break;
@@ -169,11 +365,61 @@ void WebSocketConnection::handleData() {
     }
 }
 
+// XOR a client payload with its masking key while copying it out of the receive
+// buffer (dst may equal src). offset is the payload position of src[0]. The key is
+// rotated to line up with dst[0], broadcast across a vector register and applied
+// 32/16 bytes at a time, then 8, then byte by byte for the tail.
+void WebSocketConnection::unmaskPayload(char *dst, const char *src, qint64 size, const quint8 mask[4], qint64 offset) {
+    quint8 key[4];
+    for (int i = 0; i < 4; ++i) key[i] = mask[(offset + i) & 3];
+    quint32 key32;
+    memcpy(&key32, key, 4);
+    
+    qint64 i = 0;
+#if defined(__AVX2__)
+    const __m256i key256 = _mm256_set1_epi32(int(key32));
+    for (; i + 32 <= size; i += 32) {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), _mm256_xor_si256(block, key256));
+    }
+#endif
+#if defined(__SSE2__)
+    const __m128i key128 = _mm_set1_epi32(int(key32));
+    for (; i + 16 <= size; i += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_xor_si128(block, key128));
+    }
+#elif defined(__ARM_NEON)
+    const uint8x16_t key128 = vreinterpretq_u8_u32(vdupq_n_u32(key32));
+    for (; i + 16 <= size; i += 16) {
+        uint8x16_t block = vld1q_u8(reinterpret_cast<const uint8_t *>(src + i));
+        vst1q_u8(reinterpret_cast<uint8_t *>(dst + i), veorq_u8(block, key128));
+    }
+#endif
+    const quint64 key64 = (quint64(key32) << 32) | key32;
+    for (; i + 8 <= size; i += 8) {
+        quint64 word;
+        memcpy(&word, src + i, 8);
+        word ^= key64;
+        memcpy(dst + i, &word, 8);
+    }
+    // i is a multiple of 4 here, so key[] is still aligned with the payload
+    for (; i < size; ++i) {
+        dst[i] = char(quint8(src[i]) ^ key[i & 3]);
+    }
+}
+
 // HEAVILY INSTRUMENTED VERSION for debugging
 int WebSocketConnection::processFrame(const QByteArray &data) {
+    TRACE_SCOPE("ws.parseFrame");
      if (debug) qDebug() << "\n*** PROCESSING FRAME ***";
      if (debug) qDebug() << "Input data size:" << data.size();
     
+    // Middle of a large binary frame: hand over whatever payload has arrived
+    if (m_streamRemaining > 0) {
+        return streamFramePayload(data);
+    }
+    
     if (data.size() < 2) {
          if (debug) qDebug() << "Not enough data for frame header";
         return 0; // Not enough data for a frame header
@@ -183,6 +429,7 @@ int WebSocketConnection::processFrame(const QByteArray &data) {
     quint8 secondByte = data[1];
     
     bool fin = (firstByte & 0x80) != 0;
+    bool rsv1 = (firstByte & 0x40) != 0;
     quint8 opcode = firstByte & 0x0F;
     bool masked = (secondByte & 0x80) != 0;
     quint64 payloadLength = secondByte & 0x7F;
@@ -218,6 +465,76 @@ int WebSocketConnection::processFrame(const QByteArray &data) {
          if (debug) qDebug() << "Frame is masked, header size:" << headerSize;
     }
     
+    if (data.size() < headerSize) {
+         if (debug) qDebug() << "Incomplete frame header";
+        return 0;
+    }
+    
+    // RFC 6455 5.4/5.5: control frames are short and unfragmented, data frames
+    // either start a message or continue the one in progress
+    bool control = (opcode & 0x08) != 0;
+    if (control && (!fin || payloadLength > 125)) {
+        closeWithStatus(1002, "Invalid control frame");
+        return 0;
+    }
+    if (!control && opcode != 0x00 && opcode != 0x01 && opcode != 0x02) {
+        closeWithStatus(1002, "Unknown opcode");
+        return 0;
+    }
+    if (opcode == 0x00 && m_messageOpcode == 0) {
+        closeWithStatus(1002, "Unexpected continuation frame");
+        return 0;
+    }
+    if ((opcode == 0x01 || opcode == 0x02) && m_messageOpcode != 0) {
+        closeWithStatus(1002, "Expected continuation frame");
+        return 0;
+    }
+    // RSV1 marks a permessage-deflate message; only legal on the first frame of a negotiated connection
+    if (rsv1 && (!m_deflate || control || opcode == 0x00)) {
+        closeWithStatus(1002, "Unexpected RSV1");
+        return 0;
+    }
+    
+    if (!control) {
+        quint64 messageSize = (opcode == 0x00 ? quint64(m_messageSize) : 0) + payloadLength;
+        if (messageSize > quint64(s_maxMessageSize)) {
+            if (debug) qDebug() << "Message of" << messageSize << "bytes exceeds limit" << s_maxMessageSize;
+            closeWithStatus(1009, "Message too big");
+            return 0;
+        }
+    }
+    
+    // Message state is only committed once the frame is actually consumed
+    auto beginFrame = [&]() {
+        if (control) return;
+        if (opcode != 0x00) {
+            m_messageOpcode = opcode;
+            m_messageCompressed = rsv1;
+            m_messageSize = 0;
+        }
+        m_messageSize += qint64(payloadLength);
+    };
+    
+    quint8 mask[4] = {0, 0, 0, 0};
+    if (masked) {
+        for (int i = 0; i < 4; ++i) mask[i] = quint8(data[headerSize - 4 + i]);
+    }
+    
+    // Large uncompressed binary frames are delivered as their bytes arrive
+    // instead of waiting for the whole frame to sit in m_pendingData
+    bool binaryMessage = opcode == 0x02 || (opcode == 0x00 && m_messageOpcode == 0x02);
+    bool compressedMessage = opcode == 0x00 ? m_messageCompressed : rsv1;
+    if (binaryMessage && !compressedMessage && payloadLength >= quint64(STREAM_THRESHOLD)) {
+        beginFrame();
+        SimulatorMetrics::instance().increment("origin_websocket_frames_total", frameLabels(false, opcode));
+        m_streamRemaining = qint64(payloadLength);
+        m_streamOffset = 0;
+        m_streamFin = fin;
+        m_streamMasked = masked;
+        memcpy(m_streamMask, mask, 4);
+        return headerSize;
+    }
+    
     // Check if we have a complete frame
     qint64 totalFrameSize = headerSize + payloadLength;
      if (debug) qDebug() << "Total frame size needed:" << totalFrameSize << "Available:" << data.size();
@@ -227,27 +544,29 @@ int WebSocketConnection::processFrame(const QByteArray &data) {
         return 0; // Incomplete frame
     }
     
-    QByteArray payload = data.mid(headerSize, payloadLength);
+    beginFrame();
+    QByteArray payload;
+    if (masked) {
+        // Unmask straight from the receive buffer into the payload: one pass, one copy
+        payload.resize(qsizetype(payloadLength));
+        unmaskPayload(payload.data(), data.constData() + headerSize, payload.size(), mask);
+         if (debug) qDebug() << "Unmasked payload:" << payload.left(32).toHex(); // First 32 bytes
+    } else {
+        payload = data.mid(headerSize, payloadLength);
+    }
      if (debug) qDebug() << "Extracted payload size:" << payload.size();
     
-    if (masked && headerSize >= 6) {
-        QByteArray maskKey = data.mid(headerSize - 4, 4);
-         if (debug) qDebug() << "Unmasking with key:" << maskKey.toHex();
-        for (int i = 0; i < payload.size(); ++i) {
-            payload[i] = payload[i] ^ maskKey[i % 4];
-        }
-         if (debug) qDebug() << "Unmasked payload:" << payload.left(32).toHex(); // First 32 bytes
+    SimulatorMetrics::instance().increment("origin_websocket_frames_total", frameLabels(false, opcode));
+    
+    if (!control) {
+        deliverMessageData(payload, fin);
+        return totalFrameSize;
     }
     
     // Process the frame based on opcode
      if (debug) qDebug() << "Processing opcode:" << QString("0x%1").arg(opcode, 2, 16, QChar('0'));
     
     switch (opcode) {
-        case 0x01: // Text frame
-            if (debug) qDebug() << "TEXT FRAME received:" << QString::fromUtf8(payload).left(100);
-            emit textMessageReceived(QString::fromUtf8(payload));
-            break;
-            
         case 0x08: // Close frame
             if (debug) qDebug() << "CLOSE FRAME received";
             sendFrame(0x08, payload);
@@ -297,6 +616,64 @@ int WebSocketConnection::processFrame(const QByteArray &data) {
     return totalFrameSize;
 }
 
+// Consumes payload bytes of a frame whose header was already parsed by processFrame
+int WebSocketConnection::streamFramePayload(const QByteArray &data) {
+    qint64 chunkSize = qMin<qint64>(data.size(), m_streamRemaining);
+    if (chunkSize == 0) return 0;
+    
+    QByteArray chunk;
+    if (m_streamMasked) {
+        chunk.resize(chunkSize);
+        unmaskPayload(chunk.data(), data.constData(), chunkSize, m_streamMask, m_streamOffset);
+    } else {
+        chunk = data.left(chunkSize);
+    }
+    m_streamOffset += chunkSize;
+    m_streamRemaining -= chunkSize;
+    
+     if (debug) qDebug() << "Streamed" << chunkSize << "binary bytes," << m_streamRemaining << "left in frame";
+    
+    deliverMessageData(chunk, m_streamFin && m_streamRemaining == 0);
+    return int(chunkSize);
+}
+
+// Reassembles data frames into messages. Text and compressed messages are
+// buffered until FIN; plain binary data is passed on fragment by fragment.
+void WebSocketConnection::deliverMessageData(const QByteArray &payload, bool final) {
+    quint8 opcode = m_messageOpcode;
+    
+    if (opcode == 0x02 && !m_messageCompressed) {
+        if (final) m_messageOpcode = 0;
+        emit binaryDataReceived(payload, final);
+        return;
+    }
+    
+    m_messageBuffer.append(payload);
+    if (!final) return;
+    
+    QByteArray message;
+    message.swap(m_messageBuffer);
+    m_messageOpcode = 0;
+    
+    if (m_messageCompressed) {
+        QByteArray inflated;
+        if (!inflateMessage(message, inflated)) {
+            if (debug) qDebug() << "Rejecting undecodable compressed message";
+            closeWithStatus(1007, "Invalid compressed message");
+            return;
+        }
+        message.swap(inflated);
+    }
+    
+    if (opcode == 0x01) {
+        if (debug) qDebug() << "TEXT MESSAGE received:" << QString::fromUtf8(message).left(100);
+        if (m_recorder) m_recorder->record(SessionRecordKind::WebSocketInbound, m_connectionId, message);
+        emit textMessageReceived(QString::fromUtf8(message));
+    } else {
+        emit binaryDataReceived(message, true);
+    }
+}
+
 void WebSocketConnection::startPingCycle(int intervalMs) {
     if (m_autoPingTimer->isActive()) {
         m_autoPingTimer->stop();
@@ -354,6 +731,7 @@ void WebSocketConnection::onPingTimeout() {
     
     m_waitingForPong = false;
     m_missedPongCount++;
+    SimulatorMetrics::instance().increment("origin_websocket_missed_pongs_total");
     
      if (debug) qDebug() << "Missed consecutive pongs:" << m_missedPongCount;
     
@@ -361,20 +739,7 @@ void WebSocketConnection::onPingTimeout() {
     if (m_missedPongCount >= 3) {
          if (debug) qDebug() << "Too many missed pongs, disconnecting client";
         
-        QByteArray closePayload;
-        closePayload.append(char(1011 >> 8));
-        closePayload.append(char(1011 & 0xFF));
-        closePayload.append("Ping timeout");
-        
-        sendFrame(0x08, closePayload);
-        stopPingCycle();
-        
-        QTimer::singleShot(1000, this, [this]() {
-            if (m_socket && m_socket->state() == QAbstractSocket::ConnectedState) {
-                m_socket->disconnectFromHost();
-            }
-        });
-        
+        closeWithStatus(1011, "Ping timeout");
         m_missedPongCount = 0;
     }
     
@@ -405,6 +770,147 @@ WebSocketConnection::WebSocketConnection(QTcpSocket *socket, QObject *parent, bo
     }
 }
 
+WebSocketConnection::~WebSocketConnection() {
+    delete m_deflate;
+}
+
+void WebSocketConnection::closeWithStatus(quint16 code, const QByteArray &reason) {
+    if (m_closing) return;
+    m_closing = true;
+    
+    QByteArray closePayload;
+    closePayload.append(char(code >> 8));
+    closePayload.append(char(code & 0xFF));
+    closePayload.append(reason);
+    
+    sendFrame(0x08, closePayload);
+    stopPingCycle();
+    
+    QTimer::singleShot(1000, this, [this]() {
+        if (m_socket && m_socket->state() == QAbstractSocket::ConnectedState) {
+            m_socket->disconnectFromHost();
+        }
+    });
+}
+
+// Picks the first acceptable permessage-deflate offer and returns the response
+// extension header value (empty when declined or disabled)
+QByteArray WebSocketConnection::negotiateDeflate(const HttpRequest &request) {
+    if (!s_deflateEnabled) return QByteArray();
+    
+    QStringList offers;
+    for (const HttpRequest::Header &header : request.headers()) {
+        if (HttpRequest::equalsIgnoreCase(header.name, "Sec-WebSocket-Extensions")) {
+            offers += QString::fromLatin1(header.value).split(',', Qt::SkipEmptyParts);
+        }
+    }
+    
+    for (const QString &offer : offers) {
+        QStringList params = offer.split(';');
+        if (params.takeFirst().trimmed().compare("permessage-deflate", Qt::CaseInsensitive) != 0) continue;
+        
+        bool acceptable = true;
+        bool serverNoContextTakeover = false;
+        bool clientNoContextTakeover = false;
+        int serverWindowBits = 15;
+        bool serverWindowBitsRequested = false;
+        
+        for (const QString &param : params) {
+            QString name = param.section('=', 0, 0).trimmed().toLower();
+            QString value = param.section('=', 1).trimmed().remove('"');
+            
+            if (name == "server_no_context_takeover") {
+                serverNoContextTakeover = true;
+            } else if (name == "client_no_context_takeover") {
+                clientNoContextTakeover = true;
+            } else if (name == "server_max_window_bits") {
+                bool ok = false;
+                serverWindowBits = value.toInt(&ok);
+                serverWindowBitsRequested = true;
+                // zlib's raw deflate can't keep to an 8-bit window, so offers that require one are declined
+                acceptable = acceptable && ok && serverWindowBits >= 9 && serverWindowBits <= 15;
+            } else if (name == "client_max_window_bits") {
+                // Our inflater always uses a 32K window, which decodes any client window
+            } else {
+                acceptable = false;
+            }
+        }
+        if (!acceptable) continue;
+        
+        m_deflate = new WebSocketDeflate(serverWindowBits);
+        m_deflate->serverNoContextTakeover = serverNoContextTakeover;
+        m_deflate->clientNoContextTakeover = clientNoContextTakeover;
+        
+        QByteArray response = "permessage-deflate";
+        if (serverNoContextTakeover) response += "; server_no_context_takeover";
+        if (clientNoContextTakeover) response += "; client_no_context_takeover";
+        if (serverWindowBitsRequested) response += "; server_max_window_bits=" + QByteArray::number(serverWindowBits);
+        
+        if (debug) qDebug() << "Negotiated" << response;
+        return response;
+    }
+    
+    return QByteArray();
+}
+
+bool WebSocketConnection::deflateMessage(const QByteArray &payload, QByteArray &compressed) {
+    z_stream &stream = m_deflate->deflater;
+    stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(payload.constData()));
+    stream.avail_in = uInt(payload.size());
+    
+    compressed.resize(deflateBound(&stream, uLong(payload.size())) + 16);
+    qsizetype produced = 0;
+    do {
+        if (produced == compressed.size()) compressed.resize(compressed.size() * 2);
+        stream.next_out = reinterpret_cast<Bytef *>(compressed.data() + produced);
+        stream.avail_out = uInt(compressed.size() - produced);
+        if (deflate(&stream, Z_SYNC_FLUSH) == Z_STREAM_ERROR) return false;
+        produced = compressed.size() - stream.avail_out;
+    } while (stream.avail_out == 0);
+    
+    // RFC 7692 7.2.1: drop the 00 00 FF FF tail of the sync flush
+    compressed.resize(produced >= 4 ? produced - 4 : produced);
+    
+    if (m_deflate->serverNoContextTakeover) deflateReset(&stream);
+    
+    SimulatorMetrics::instance().increment("origin_websocket_deflate_bytes_total", SimulatorMetrics::label("stage", "raw"), payload.size());
+    SimulatorMetrics::instance().increment("origin_websocket_deflate_bytes_total", SimulatorMetrics::label("stage", "compressed"), compressed.size());
+    return true;
+}
+
+bool WebSocketConnection::inflateMessage(const QByteArray &compressed, QByteArray &payload) {
+    static const char syncTail[4] = {0x00, 0x00, char(0xFF), char(0xFF)};
+    QByteArray input = compressed;
+    input.append(syncTail, 4);
+    
+    z_stream &stream = m_deflate->inflater;
+    stream.next_in = reinterpret_cast<Bytef *>(input.data());
+    stream.avail_in = uInt(input.size());
+    
+    payload.resize(qMax<qsizetype>(256, compressed.size() * 4));
+    qsizetype produced = 0;
+    while (true) {
+        stream.next_out = reinterpret_cast<Bytef *>(payload.data() + produced);
+        stream.avail_out = uInt(payload.size() - produced);
+        int result = inflate(&stream, Z_SYNC_FLUSH);
+        produced = payload.size() - stream.avail_out;
+        
+        if (result != Z_OK && result != Z_BUF_ERROR && result != Z_STREAM_END) return false;
+        if (result == Z_STREAM_END) {
+            // Peer closed its deflate block stream (BFINAL); the next message starts fresh
+            inflateReset(&stream);
+            break;
+        }
+        if (stream.avail_in == 0 && stream.avail_out > 0) break;
+        if (payload.size() >= s_maxMessageSize) return false;
+        payload.resize(qMin<qsizetype>(payload.size() * 2, s_maxMessageSize));
+    }
+    payload.resize(produced);
+    
+    if (m_deflate->clientNoContextTakeover) inflateReset(&stream);
+    return true;
+}
+
 // New method to take socket ownership after handshake
 void WebSocketConnection::takeSocketOwnership() {
      if (debug) qDebug() << "*** TAKING EXCLUSIVE SOCKET OWNERSHIP ***";
@@ -421,6 +927,11 @@ void WebSocketConnection::takeSocketOwnership() {
      if (debug) qDebug() << "*** SOCKET OWNERSHIP ESTABLISHED ***";
 }
 
+void WebSocketConnection::setSessionRecorder(SessionRecorder *recorder, quint32 connectionId) {
+    m_recorder = recorder;
+    m_connectionId = connectionId;
+}
+
 void WebSocketConnection::resetPingState() {
     m_pingCounter = 0;
     m_missedPongCount = 0;
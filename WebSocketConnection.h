@@ -5,17 +5,37 @@
 #include <QTcpSocket>
 #include <QTimer>
 
+class HttpRequest;
+class SessionRecorder;
+struct WebSocketDeflate;
+
 class WebSocketConnection : public QObject {
     Q_OBJECT
     
 public:
     // Updated constructor with optional delayed ownership
     explicit WebSocketConnection(QTcpSocket *socket, QObject *parent = nullptr, bool takeOwnership = true);
+    ~WebSocketConnection();
+    
+    // Accept RFC 7692 permessage-deflate when a client offers it (off by default, like the real telescope)
+    static void setDeflateEnabled(bool enabled) { s_deflateEnabled = enabled; }
+    bool isDeflateNegotiated() const { return m_deflate != nullptr; }
+    
+    // Inbound messages larger than this close the connection with 1009 (default 16 MB)
+    static void setMaxMessageSize(qint64 bytes) { s_maxMessageSize = bytes; }
+    // Outbound messages larger than this are sent as continuation frames (0 = never fragment)
+    static void setFragmentSize(int bytes) { s_fragmentSize = bytes; }
     
     void sendTextMessage(const QString &message);
+    void sendBinaryMessage(const QByteArray &data);
+    
+    QTcpSocket *socket() const { return m_socket; }
+    // Bytes the socket has accepted but not yet handed to the kernel (back-pressure)
+    qint64 bytesToWrite() const { return m_queuedBytes + (m_socket ? m_socket->bytesToWrite() : 0); }
     void sendPongMessage(const QByteArray &payload);
     void sendPingMessage(const QByteArray &payload = QByteArray());
     bool performHandshake(const QByteArray &requestData);
+    bool performHandshake(const HttpRequest &request);
     
     // New method to take ownership after handshake
     void takeSocketOwnership();
@@ -24,6 +44,9 @@ public:
     void startPingCycle(int intervalMs = 5000);
     void stopPingCycle();
     
+    // Log every text message in both directions under the given connection id
+    void setSessionRecorder(SessionRecorder *recorder, quint32 connectionId);
+    
     // Debug and monitoring methods
     void resetPingState();
     void verifyTimerSetup();
@@ -31,6 +54,8 @@ public:
 
 signals:
     void textMessageReceived(const QString &message);
+    // Binary messages arrive in pieces as frames come in; concatenate until messageComplete
+    void binaryDataReceived(const QByteArray &data, bool messageComplete);
     void pingReceived(const QByteArray &payload);
     void pongReceived(const QByteArray &payload);
     void disconnected();
@@ -42,6 +67,8 @@ private slots:
     void sendAutomaticPing();
 
 private:
+    friend class OriginBench;
+    
     QTcpSocket *m_socket;
     bool m_handshakeComplete;
     QTimer *m_pingTimeoutTimer;
@@ -50,9 +77,52 @@ private:
     QByteArray m_pendingData;    // For handling incomplete frames
     int m_pingCounter;
     int m_missedPongCount;
+    SessionRecorder *m_recorder = nullptr;
+    quint32 m_connectionId = 0;
+    WebSocketDeflate *m_deflate = nullptr;    // Non-null once permessage-deflate is negotiated
+    bool m_closing = false;                   // Close sent for a protocol error; ignore further input
+    
+    // Message reassembly across continuation frames
+    quint8 m_messageOpcode = 0;               // 0x01/0x02 while a message is open, else 0
+    bool m_messageCompressed = false;
+    qint64 m_messageSize = 0;
+    QByteArray m_messageBuffer;               // Text and compressed messages only
+    
+    // Large binary frame being streamed (header already consumed)
+    qint64 m_streamRemaining = 0;
+    qint64 m_streamOffset = 0;
+    bool m_streamFin = false;
+    bool m_streamMasked = false;
+    quint8 m_streamMask[4] = {0, 0, 0, 0};
+    
+    // Outbound frames waiting for the end of the current event-loop pass
+    struct QueuedChunk {
+        QByteArray data;                      // Shared with the caller's buffer
+        qsizetype offset;
+        qsizetype length;
+    };
+    QList<QueuedChunk> m_writeQueue;
+    qint64 m_queuedBytes = 0;
+    bool m_flushScheduled = false;
+    
+    static bool s_deflateEnabled;
+    static qint64 s_maxMessageSize;
+    static int s_fragmentSize;
   
-    void sendFrame(quint8 opcode, const QByteArray &payload, bool masked = false);
+    void sendMessage(quint8 opcode, const QByteArray &data);
+    void sendFrame(quint8 opcode, const QByteArray &payload, bool masked = false, bool compressed = false, bool fin = true);
+    void queueFrame(quint8 firstByte, const QByteArray &payload, qsizetype offset, qsizetype length, bool masked);
+    void flushFrames();
     int processFrame(const QByteArray &data);
+    static void unmaskPayload(char *dst, const char *src, qint64 size, const quint8 mask[4], qint64 offset = 0);
+    int streamFramePayload(const QByteArray &data);
+    void deliverMessageData(const QByteArray &payload, bool final);
+    void closeWithStatus(quint16 code, const QByteArray &reason);
+    
+    // permessage-deflate helpers
+    QByteArray negotiateDeflate(const HttpRequest &request);
+    bool deflateMessage(const QByteArray &payload, QByteArray &compressed);
+    bool inflateMessage(const QByteArray &compressed, QByteArray &payload);
 };
 
 #endif // WEBSOCKETCONNECTION_H
\ No newline at end of file
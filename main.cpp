@@ -1,11 +1,132 @@
 #include <QApplication>
+#include <QCommandLineParser>
 #include <QDebug>
 #include "CelestronOriginSimulator.h"
+#include "LiveStacker.h"
+#include "PsfAtlas.h"
+#include "SimulatorFleet.h"
+#include "StarCatalog.h"
+#include "TiffImageGenerator.h"
+#include "Tracer.h"
+#include "WebSocketConnection.h"
 
 int main(int argc, char *argv[]) {
     QApplication app(argc, argv);
     
-    CelestronOriginSimulator simulator;
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Celestron Origin telescope simulator");
+    parser.addHelpOption();
+    QCommandLineOption instancesOption("instances", "Number of virtual telescopes to host (fleet mode).", "count", "1");
+    QCommandLineOption basePortOption("base-port", "Listening port of the first telescope.", "port", QString::number(SERVER_PORT));
+    QCommandLineOption bindOption("bind", "Comma-separated virtual IPs to spread fleet instances across.", "addresses");
+    QCommandLineOption imageDirOption("image-dir", "Root directory for per-instance image stores.", "dir", "/tmp");
+    parser.addOption(instancesOption);
+    parser.addOption(basePortOption);
+    parser.addOption(bindOption);
+    QCommandLineOption clockOption("clock", "Simulation clock: realtime, scaled or stepped.", "mode", "realtime");
+    QCommandLineOption timeScaleOption("time-scale", "Simulated seconds per wall second in scaled mode.", "factor", "1");
+    QCommandLineOption startTimeOption("start-time", "Initial simulated UTC time (ISO 8601).", "datetime");
+    QCommandLineOption seedOption("seed", "Random seed for reproducible sensor behaviour.", "seed");
+    QCommandLineOption recordOption("record", "Record all WebSocket and HTTP traffic to a session log.", "file");
+    QCommandLineOption stallOption("stall-threshold", "Log event-loop stalls longer than this (0 = off).", "ms", "250");
+    QCommandLineOption noTraceOption("no-trace", "Disable span tracing (GET /debug/trace).");
+    parser.addOption(imageDirOption);
+    parser.addOption(clockOption);
+    parser.addOption(timeScaleOption);
+    parser.addOption(startTimeOption);
+    parser.addOption(seedOption);
+    parser.addOption(recordOption);
+    parser.addOption(stallOption);
+    parser.addOption(noTraceOption);
+    QCommandLineOption deflateOption("deflate", "Accept permessage-deflate on the WebSocket control channel.");
+    parser.addOption(deflateOption);
+    QCommandLineOption maxMessageOption("max-message-size", "Largest inbound WebSocket message accepted.", "bytes", "16777216");
+    QCommandLineOption fragmentOption("fragment-size", "Split outbound WebSocket messages above this size (0 = never).", "bytes", "262144");
+    parser.addOption(maxMessageOption);
+    parser.addOption(fragmentOption);
+    QCommandLineOption tiffCompressionOption("tiff-compression", "Capture TIFF compression: none, lzw, deflate or zstd.", "mode", "none");
+    parser.addOption(tiffCompressionOption);
+    QCommandLineOption rawBayerOption("raw-bayer", "Capture single-plane 16-bit RGGB mosaics instead of RGB.");
+    parser.addOption(rawBayerOption);
+    QCommandLineOption stackModeOption("stack-mode", "RunImaging live-stack combine: mean or sigma (3-sigma clipped).", "mode", "mean");
+    parser.addOption(stackModeOption);
+    QCommandLineOption starCatalogOption("star-catalog", "Binary star catalog to render captures from (written there if missing).", "file");
+    parser.addOption(starCatalogOption);
+    QCommandLineOption psfOption("psf", "Star profile: moffat (seeing wings) or gaussian.", "profile", "moffat");
+    parser.addOption(psfOption);
+    QCommandLineOption bestFocusOption("best-focus", "Focuser position at which stars render sharpest.", "steps", "18447");
+    parser.addOption(bestFocusOption);
+    parser.process(app);
+    
+    Tracer::setEnabled(!parser.isSet(noTraceOption));
+    WebSocketConnection::setDeflateEnabled(parser.isSet(deflateOption));
+    WebSocketConnection::setMaxMessageSize(parser.value(maxMessageOption).toLongLong());
+    WebSocketConnection::setFragmentSize(parser.value(fragmentOption).toInt());
+    TiffImageGenerator::Compression tiffCompression;
+    if (TiffImageGenerator::parseCompression(parser.value(tiffCompressionOption), &tiffCompression)) {
+        TiffImageGenerator::setCompression(tiffCompression);
+    } else {
+        qWarning() << "Ignoring invalid --tiff-compression" << parser.value(tiffCompressionOption);
+    }
+    TiffImageGenerator::setRawBayer(parser.isSet(rawBayerOption));
+    LiveStacker::Mode stackMode;
+    if (LiveStacker::parseMode(parser.value(stackModeOption), &stackMode)) {
+        LiveStacker::setDefaultMode(stackMode);
+    } else {
+        qWarning() << "Ignoring invalid --stack-mode" << parser.value(stackModeOption);
+    }
+    PsfAtlas::Profile psfProfile;
+    if (PsfAtlas::parseProfile(parser.value(psfOption), &psfProfile)) {
+        PsfAtlas::setDefaultProfile(psfProfile);
+    } else {
+        qWarning() << "Ignoring invalid --psf" << parser.value(psfOption);
+    }
+    // Load or generate the catalog now rather than inside the first capture
+    StarCatalog::setPath(parser.value(starCatalogOption));
+    StarCatalog::instance();
+    StallWatchdog watchdog;
+    watchdog.start(parser.value(stallOption).toInt());
+    
+    // Configure the shared clock before any simulator starts its timers
+    SimulationClock &clock = SimulationClock::global();
+    const QString clockMode = parser.value(clockOption).toLower();
+    if (clockMode == "scaled") {
+        clock.setScaled(parser.value(timeScaleOption).toDouble());
+    } else if (clockMode == "stepped") {
+        clock.setStepped();
+    } else if (clockMode != "realtime") {
+        qWarning() << "Unknown clock mode" << clockMode << "- using realtime";
+    }
+    if (parser.isSet(startTimeOption)) {
+        QDateTime start = QDateTime::fromString(parser.value(startTimeOption), Qt::ISODate);
+        if (start.isValid()) {
+            clock.setCurrentDateTime(start);
+        } else {
+            qWarning() << "Ignoring invalid --start-time" << parser.value(startTimeOption);
+        }
+    }
+    
+    SimulatorInstanceConfig config;
+    config.port = parser.value(basePortOption).toUShort();
+    config.imageStoreDir = parser.value(imageDirOption);
+    config.randomSeed = parser.isSet(seedOption) ? parser.value(seedOption).toLongLong() : -1;
+    config.bestFocusPosition = parser.value(bestFocusOption).toInt();
+    config.sessionLogPath = parser.value(recordOption);
+    
+    int instances = qMax(1, parser.value(instancesOption).toInt());
+    
+    if (instances == 1 && !parser.isSet(bindOption)) {
+        // Classic single telescope, on port 80 unless --base-port says otherwise
+        CelestronOriginSimulator simulator(config);
+        return app.exec();
+    }
+    
+    QList<QHostAddress> bindAddresses;
+    for (const QString &address : parser.value(bindOption).split(',', Qt::SkipEmptyParts)) {
+        bindAddresses.append(QHostAddress(address.trimmed()));
+    }
+    
+    SimulatorFleet fleet(instances, config, bindAddresses);
     
 //     if (false) qDebug() << "Celestron Origin Simulator is running...";
 //     if (false) qDebug() << "WebSocket endpoint: ws://localhost/SmartScope-1.0/mountControlEndpoint";
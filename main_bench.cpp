@@ -0,0 +1,556 @@
+// OriginBench - microbenchmarks for the simulator's hot paths.
+//
+// Every case runs a fixed fixture until --min-time has elapsed and reports ns/op,
+// heap allocations/op and MB/s. --save writes the results as JSON; --compare reads
+// such a file back and fails when any case got slower than --tolerance percent.
+//
+//   ./OriginBench                          run everything
+//   ./OriginBench --filter ws.             only the WebSocket cases
+//   ./OriginBench --save base.json         record a baseline
+//   ./OriginBench --compare base.json      guard against regressions
+
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTemporaryDir>
+#include <QDebug>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <new>
+
+#include "CelestronOriginSimulator.h"
+#include "TiffImageGenerator.h"
+#include "LiveStacker.h"
+#include "SensorNoise.h"
+#include "StarCatalog.h"
+
+// ---------------------------------------------------------------------------
+// Allocation counting. Qt containers allocate with malloc, so on glibc the libc
+// entry points are wrapped as well; elsewhere only operator new is counted.
+// ---------------------------------------------------------------------------
+
+static std::atomic<qint64> g_allocations{0};
+
+#if defined(__GLIBC__)
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t count, size_t size);
+extern "C" void *__libc_realloc(void *ptr, size_t size);
+
+extern "C" void *malloc(size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t count, size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(count, size);
+}
+
+extern "C" void *realloc(void *ptr, size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(ptr, size);
+}
+#else
+void *operator new(size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *ptr = std::malloc(size ? size : 1)) return ptr;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { std::free(ptr); }
+#endif
+
+// ---------------------------------------------------------------------------
+// Harness
+// ---------------------------------------------------------------------------
+
+struct BenchResult {
+    QString name;
+    qint64 iterations = 0;
+    double nsPerOp = 0.0;
+    double allocsPerOp = 0.0;
+    double mbPerSec = 0.0;
+};
+
+class OriginBench {
+public:
+    OriginBench(int minTimeMs, const QString &filter) : m_minTimeMs(minTimeMs), m_filter(filter) {}
+
+    void runAll();
+    const QList<BenchResult> &results() const { return m_results; }
+    int failedChecks() const { return m_failedChecks; }
+
+private:
+    // Runs op in growing batches until minTime is reached; bytesPerOp feeds the MB/s column
+    void bench(const QString &name, qint64 bytesPerOp, const std::function<void()> &op);
+
+    void setupLoopback();
+    void drainLoopback();
+
+    void benchWebSocket();
+    void benchStatusSender();
+    void benchCommandHandler();
+    void benchTiff();
+    void benchMosaic();
+    
+    // Correctness checks that need full frames, run alongside the timings
+    void checkStackConvergence();
+
+    int m_minTimeMs;
+    QString m_filter;
+    QList<BenchResult> m_results;
+    int m_failedChecks = 0;
+    QTemporaryDir m_tempDir;
+
+    // Connected socket pair so send paths hit a real kernel socket
+    QTcpServer m_server;
+    QTcpSocket *m_clientSide = nullptr;
+    QTcpSocket *m_serverSide = nullptr;
+    int m_sendsSinceDrain = 0;
+};
+
+void OriginBench::bench(const QString &name, qint64 bytesPerOp, const std::function<void()> &op) {
+    if (!m_filter.isEmpty() && !name.contains(m_filter)) return;
+
+    // Warm caches, lazy statics and the allocator
+    op();
+
+    qint64 iterations = 0;
+    qint64 batch = 1;
+    qint64 allocations = 0;
+    QElapsedTimer timer;
+    timer.start();
+
+    while (timer.elapsed() < m_minTimeMs) {
+        qint64 before = g_allocations.load(std::memory_order_relaxed);
+        for (qint64 i = 0; i < batch; ++i) op();
+        allocations += g_allocations.load(std::memory_order_relaxed) - before;
+        iterations += batch;
+        if (timer.elapsed() < m_minTimeMs / 10) batch *= 2;
+    }
+
+    BenchResult result;
+    result.name = name;
+    result.iterations = iterations;
+    result.nsPerOp = double(timer.nsecsElapsed()) / iterations;
+    result.allocsPerOp = double(allocations) / iterations;
+    result.mbPerSec = bytesPerOp > 0 ? bytesPerOp / result.nsPerOp * 1e9 / (1024.0 * 1024.0) : 0.0;
+    m_results.append(result);
+
+    qInfo().noquote() << QString("%1 %2 %3 %4 %5").arg(name, -34).arg(iterations, 10)
+                             .arg(result.nsPerOp, 14, 'f', 1).arg(result.allocsPerOp, 10, 'f', 1)
+                             .arg(bytesPerOp > 0 ? QString::number(result.mbPerSec, 'f', 1) : QString("-"), 10);
+}
+
+void OriginBench::setupLoopback() {
+    m_server.listen(QHostAddress::LocalHost, 0);
+    m_clientSide = new QTcpSocket(&m_server);
+    m_clientSide->connectToHost(QHostAddress::LocalHost, m_server.serverPort());
+    m_server.waitForNewConnection(5000);
+    m_serverSide = m_server.nextPendingConnection();
+    m_clientSide->waitForConnected(5000);
+}
+
+// Keep the kernel buffers from filling so send benchmarks measure the send path, not back-pressure
+void OriginBench::drainLoopback() {
+    if (++m_sendsSinceDrain < 32) return;
+    m_sendsSinceDrain = 0;
+    while (m_serverSide->bytesToWrite() > 0 && m_serverSide->waitForBytesWritten(0)) {}
+    while (m_clientSide->waitForReadyRead(0)) m_clientSide->readAll();
+}
+
+static QByteArray maskedTextFrame(const QByteArray &payload) {
+    QByteArray frame;
+    frame.append(char(0x81));
+    if (payload.size() < 126) {
+        frame.append(char(0x80 | payload.size()));
+    } else if (payload.size() < 65536) {
+        frame.append(char(0x80 | 126));
+        frame.append(char(payload.size() >> 8));
+        frame.append(char(payload.size() & 0xFF));
+    } else {
+        frame.append(char(0x80 | 127));
+        for (int i = 7; i >= 0; --i) frame.append(char((quint64(payload.size()) >> (i * 8)) & 0xFF));
+    }
+    const char mask[4] = {0x12, 0x34, 0x56, 0x78};
+    frame.append(mask, 4);
+    for (qsizetype i = 0; i < payload.size(); ++i) frame.append(char(payload[i] ^ mask[i & 3]));
+    return frame;
+}
+
+void OriginBench::benchWebSocket() {
+    WebSocketConnection connection(m_serverSide, nullptr, false);
+
+    // Unmasking: the original per-byte QByteArray loop against the vector kernel
+    const quint8 mask[4] = {0x12, 0x34, 0x56, 0x78};
+    const QByteArray maskKey(reinterpret_cast<const char *>(mask), 4);
+    for (qint64 size : {qint64(100), qint64(4 * 1024), qint64(1024 * 1024)}) {
+        QString suffix = size >= 1024 * 1024 ? "1m" : size >= 1024 ? "4k" : "100";
+        QByteArray payload(size, 'x');
+        bench("ws.unmask.bytewise." + suffix, size, [&]() {
+            for (int i = 0; i < payload.size(); ++i) payload[i] = payload[i] ^ maskKey[i % 4];
+        });
+        bench("ws.unmask.vector." + suffix, size, [&]() {
+            WebSocketConnection::unmaskPayload(payload.data(), payload.constData(), payload.size(), mask);
+        });
+    }
+
+    QByteArray command = R"({"Command":"GetStatus","Destination":"Mount","SequenceID":42,"Source":"iPhone","Type":"Command"})";
+    QByteArray smallFrame = maskedTextFrame(command);
+    QByteArray largeFrame = maskedTextFrame(QByteArray(64 * 1024, 'x'));
+
+    QByteArray upgrade = "GET /SmartScope-1.0/mountControlEndpoint HTTP/1.1\r\nHost: 192.168.1.10\r\n"
+                         "Upgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+                         "Sec-WebSocket-Version: 13\r\nUser-Agent: ixwebsocket/11.4.3 macos ssl/SecureTransport zlib 1.2.12\r\n\r\n";
+    bench("http.parseRequest.upgrade", upgrade.size(), [&]() {
+        HttpRequest request;
+        request.parse(upgrade);
+        if (!request.headerHasToken("Upgrade", "websocket")) qFatal("upgrade header not found");
+    });
+
+    bench("ws.processFrame.command", smallFrame.size(), [&]() { connection.processFrame(smallFrame); });
+    bench("ws.processFrame.64k", largeFrame.size(), [&]() { connection.processFrame(largeFrame); });
+
+    QByteArray smallPayload = command;
+    QByteArray largePayload(64 * 1024, 'x');
+    bench("ws.sendFrame.command", smallPayload.size(), [&]() {
+        connection.sendFrame(0x01, smallPayload);
+        connection.flushFrames();
+        drainLoopback();
+    });
+    bench("ws.sendFrame.64k", largePayload.size(), [&]() {
+        connection.sendFrame(0x01, largePayload);
+        connection.flushFrames();
+        drainLoopback();
+    });
+    // A status burst: 16 frames queued in one event-loop pass, then one gather write
+    bench("ws.sendFrame.burst16", smallPayload.size() * 16, [&]() {
+        for (int i = 0; i < 16; ++i) connection.sendFrame(0x01, smallPayload);
+        connection.flushFrames();
+        drainLoopback();
+    });
+}
+
+void OriginBench::benchStatusSender() {
+    TelescopeState state(&SimulationClock::global(), 1);
+    StatusSender sender(&state);
+    WebSocketConnection connection(m_serverSide, nullptr, false);
+
+    bench("status.mount", 0, [&]() {
+        sender.sendMountStatus(&connection, 1, "Bench");
+        drainLoopback();
+    });
+    bench("status.focuser", 0, [&]() {
+        sender.sendFocuserStatus(&connection, 1, "Bench");
+        drainLoopback();
+    });
+    bench("status.cameraParams", 0, [&]() {
+        sender.sendCameraParams(&connection, 1, "Bench");
+        drainLoopback();
+    });
+    bench("status.newImageReady", 0, [&]() {
+        sender.sendNewImageReady(&connection);
+        drainLoopback();
+    });
+}
+
+void OriginBench::benchCommandHandler() {
+    TelescopeState state(&SimulationClock::global(), 1);
+    CommandHandler handler(&state);
+    WebSocketConnection connection(m_serverSide, nullptr, false);
+
+    auto parse = [](const char *json) { return QJsonDocument::fromJson(json).object(); };
+    QJsonObject cameraInfo = parse(R"({"Command":"GetCameraInfo","Destination":"Camera","SequenceID":7,"Source":"Bench","Type":"Command"})");
+    QJsonObject gotoRaDec = parse(R"({"Command":"GotoRaDec","Destination":"Mount","Ra":3.5,"Dec":0.4,"SequenceID":8,"Source":"Bench","Type":"Command"})");
+    QJsonObject setCapture = parse(R"({"Command":"SetCaptureParameters","Destination":"Camera","Exposure":2.0,"ISO":200,"SequenceID":9,"Source":"Bench","Type":"Command"})");
+
+    bench("command.GetCameraInfo", 0, [&]() {
+        handler.processCommand(cameraInfo, &connection);
+        drainLoopback();
+    });
+    bench("command.GotoRaDec", 0, [&]() {
+        handler.processCommand(gotoRaDec, &connection);
+        drainLoopback();
+    });
+    bench("command.SetCaptureParameters", 0, [&]() {
+        handler.processCommand(setCapture, &connection);
+        drainLoopback();
+    });
+}
+
+void OriginBench::benchTiff() {
+    const int width = TiffImageGenerator::IMAGE_WIDTH;
+    const int height = TiffImageGenerator::IMAGE_HEIGHT;
+    const qint64 bytes = qint64(width) * height * TiffImageGenerator::SAMPLES_PER_PIXEL * sizeof(uint16_t);
+
+    std::vector<uint16_t> pixels(size_t(bytes / sizeof(uint16_t)));
+    for (size_t i = 0; i < pixels.size(); ++i) pixels[i] = uint16_t((i * 2654435761u) >> 16);
+
+    QString path = m_tempDir.filePath("bench.tiff");
+    bench("tiff.writeTiff16BitRGB", bytes, [&]() {
+        TiffImageGenerator::writeTiff16BitRGB(path, pixels.data(), width, height);
+    });
+    bench("tiff.syntheticStarField", bytes, [&]() {
+        TiffImageGenerator::generateSyntheticStarField(path, 150);
+    });
+    
+    TiffImageGenerator::setCompression(TiffImageGenerator::CompressionLZW);
+    bench("tiff.syntheticStarField.lzw", bytes, [&]() {
+        TiffImageGenerator::generateSyntheticStarField(path, 150);
+    });
+    TiffImageGenerator::setCompression(TiffImageGenerator::CompressionDeflate);
+    bench("tiff.syntheticStarField.deflate", bytes, [&]() {
+        TiffImageGenerator::generateSyntheticStarField(path, 150);
+    });
+    TiffImageGenerator::setCompression(TiffImageGenerator::CompressionNone);
+    
+    TiffImageGenerator::setRawBayer(true);
+    bench("tiff.syntheticStarField.bayer", bytes / TiffImageGenerator::SAMPLES_PER_PIXEL, [&]() {
+        TiffImageGenerator::generateSyntheticStarField(path, 150);
+    });
+    TiffImageGenerator::setRawBayer(false);
+    
+    // Blitting PSF sprites: today's 150 bright stars, and a dense faint Milky Way field
+    srand(1);
+    std::vector<TiffImageGenerator::Star> sparse = TiffImageGenerator::randomStars(150);
+    std::vector<TiffImageGenerator::Star> dense = TiffImageGenerator::randomStars(20000);
+    for (TiffImageGenerator::Star &star : dense) {
+        star.x += (rand() % 8) / 8.0f;
+        star.peak = 30 + rand() % 400;
+        star.fwhm = 2.2f;
+    }
+    bench("psf.drawStars.150", bytes, [&]() {
+        TiffImageGenerator::drawStars(sparse, pixels.data(), 0, height, TiffImageGenerator::SAMPLES_PER_PIXEL);
+    });
+    bench("psf.drawStars.20000", bytes, [&]() {
+        TiffImageGenerator::drawStars(dense, pixels.data(), 0, height, TiffImageGenerator::SAMPLES_PER_PIXEL);
+    });
+    
+    // The same field 1000 focuser steps out, as at the edge of an autofocus run
+    std::vector<TiffImageGenerator::Star> defocused = dense;
+    for (TiffImageGenerator::Star &star : defocused) {
+        star.fwhm = std::hypot(2.2f, 20.0f);
+        star.peak *= 2.2f * 2.2f / (star.fwhm * star.fwhm);    // Same flux, spread wider
+    }
+    bench("psf.drawStars.defocused", bytes, [&]() {
+        TiffImageGenerator::drawStars(defocused, pixels.data(), 0, height, TiffImageGenerator::SAMPLES_PER_PIXEL);
+    });
+    
+    // Stars under the Origin's FOV at M51 and in the Cygnus Milky Way
+    StarCatalog catalog;
+    catalog.generate(StarCatalog::DEFAULT_SEED, StarCatalog::DEFAULT_LIMITING_MAG);
+    const double deg = M_PI / 180.0;
+    bench("catalog.starsInView.m51", 0, [&]() {
+        catalog.starsInView(202.4696 * deg, 47.1952 * deg, 0.0, 0.0219, 0.0147);
+    });
+    bench("catalog.starsInView.cygnus", 0, [&]() {
+        catalog.starsInView(305.0 * deg, 40.0 * deg, 0.0, 0.0219, 0.0147);
+    });
+    
+    // Camera noise over one full RGB frame, on one thread and across workers
+    SensorNoise noise(SensorNoise::Settings(), 42);
+    bench("noise.apply", bytes, [&]() {
+        noise.apply(pixels.data(), 0, height, TiffImageGenerator::SAMPLES_PER_PIXEL);
+    });
+    bench("noise.applyFrame", bytes, [&]() {
+        noise.applyFrame(pixels.data(), TiffImageGenerator::SAMPLES_PER_PIXEL);
+    });
+    
+    // Folding one full RGB sub into the running stack
+    LiveStacker stacker;
+    stacker.begin(LiveStacker::Mean, TiffImageGenerator::SAMPLES_PER_PIXEL, {});
+    bench("stack.fold.mean", bytes, [&]() {
+        stacker.addFrame(pixels.data());
+    });
+    stacker.begin(LiveStacker::SigmaClip, TiffImageGenerator::SAMPLES_PER_PIXEL, {});
+    bench("stack.fold.sigmaClip", bytes, [&]() {
+        stacker.addFrame(pixels.data());
+    });
+    stacker.end();
+}
+
+// A sigma-clipped stack of clean noisy subs has to land on the plain mean, without positions
+// that lock onto their first few samples and reject the rest
+void OriginBench::checkStackConvergence() {
+    const QString name = "check.stack.converge";
+    if (!m_filter.isEmpty() && !name.contains(m_filter)) return;
+
+    const int subs = 30;
+    const size_t count = size_t(TiffImageGenerator::IMAGE_WIDTH) * TiffImageGenerator::IMAGE_HEIGHT;
+    LiveStacker clipped;
+    LiveStacker plain;
+    clipped.begin(LiveStacker::SigmaClip, 1, {});
+    plain.begin(LiveStacker::Mean, 1, {});
+    std::vector<uint16_t> frame(count);
+    for (int i = 0; i < subs; i++) {
+        SensorNoise noise(SensorNoise::Settings(), 42, quint64(i));
+        std::fill(frame.begin(), frame.end(), uint16_t(0));
+        noise.applyFrame(frame.data(), 1);
+        clipped.setExpectedNoise(noise);
+        clipped.addFrame(frame.data());
+        plain.addFrame(frame.data());
+    }
+
+    std::vector<float> difference(count);
+    size_t lockedOut = 0;
+    double rejected = 0.0;
+    for (size_t i = 0; i < count; i++) {
+        difference[i] = std::abs(clipped.m_mean[i] - plain.m_mean[i]);
+        if (clipped.m_kept[i] < subs / 2) lockedOut++;
+        rejected += subs - clipped.m_kept[i];
+    }
+    std::nth_element(difference.begin(), difference.begin() + count * 99 / 100, difference.end());
+    const float p99 = difference[count * 99 / 100];
+    const double rejectedFraction = rejected / (double(count) * subs);
+
+    // 3-sigma clipping of Gaussian noise drops 0.27% of samples
+    const bool passed = lockedOut * 10000 < count && rejectedFraction < 0.01;
+    if (!passed) m_failedChecks++;
+    qInfo().noquote() << QString("%1 %2: p99 |clipped - mean| %3 ADU, %4% of samples rejected, "
+                                 "%5 positions kept under half")
+                             .arg(passed ? "PASS" : "FAIL", name).arg(p99, 0, 'f', 2)
+                             .arg(rejectedFraction * 100.0, 0, 'f', 3).arg(lockedOut);
+    clipped.end();
+    plain.end();
+}
+
+void OriginBench::benchMosaic() {
+    EnhancedMosaicCreator creator;
+    creator.m_outputDir = m_tempDir.path();
+    creator.m_customTarget = SkyPosition{202.4696, 47.1952, "M51", "Bench"};
+    creator.m_actualTarget = creator.m_customTarget;
+
+    // Nine synthetic 512x512 tiles stand in for downloaded HiPS tiles
+    for (int gy = 0; gy < 3; ++gy) {
+        for (int gx = 0; gx < 3; ++gx) {
+            EnhancedMosaicCreator::SimpleTile tile;
+            tile.gridX = gx;
+            tile.gridY = gy;
+            tile.healpixPixel = gy * 3 + gx;
+            tile.downloaded = true;
+            tile.image = QImage(512, 512, QImage::Format_RGB32);
+            tile.image.fill(QColor(20 * gx, 20 * gy, 40));
+            tile.skyCoordinates = SkyPosition{202.4696 + (gx - 1) * 0.2, 47.1952 + (gy - 1) * 0.2, "", ""};
+            creator.m_tiles.append(tile);
+        }
+    }
+
+    bench("mosaic.assembleCentered", qint64(1536) * 1536 * 4, [&]() { creator.assembleFinalMosaicCentered(); });
+}
+
+void OriginBench::runAll() {
+    setupLoopback();
+    if (!m_serverSide) {
+        qCritical() << "Cannot open loopback socket pair";
+        return;
+    }
+
+    qInfo().noquote() << QString("%1 %2 %3 %4 %5").arg("benchmark", -34).arg("iters", 10)
+                             .arg("ns/op", 14).arg("allocs/op", 10).arg("MB/s", 10);
+
+    benchWebSocket();
+    benchStatusSender();
+    benchCommandHandler();
+    benchTiff();
+    benchMosaic();
+    checkStackConvergence();
+}
+
+// ---------------------------------------------------------------------------
+
+static void silentMessageHandler(QtMsgType type, const QMessageLogContext &, const QString &message) {
+    if (type == QtInfoMsg || type >= QtCriticalMsg) {
+        fprintf(stderr, "%s\n", qPrintable(message));
+    }
+}
+
+int main(int argc, char *argv[]) {
+    // The mosaic case paints text, which needs a GUI platform even when headless
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Microbenchmarks for OriginSimulator hot paths");
+    parser.addHelpOption();
+    QCommandLineOption filterOption("filter", "Only run benchmarks whose name contains this.", "text");
+    QCommandLineOption minTimeOption("min-time", "Minimum measuring time per benchmark.", "ms", "500");
+    QCommandLineOption saveOption("save", "Write results as JSON.", "file");
+    QCommandLineOption compareOption("compare", "Compare against a saved JSON baseline.", "file");
+    QCommandLineOption toleranceOption("tolerance", "Allowed ns/op regression in percent.", "percent", "10");
+    QCommandLineOption verboseOption("verbose", "Keep the simulator's debug output.");
+    parser.addOption(filterOption);
+    parser.addOption(minTimeOption);
+    parser.addOption(saveOption);
+    parser.addOption(compareOption);
+    parser.addOption(toleranceOption);
+    parser.addOption(verboseOption);
+    parser.process(app);
+
+    if (!parser.isSet(verboseOption)) {
+        qInstallMessageHandler(silentMessageHandler);
+    }
+
+    OriginBench bench(qMax(10, parser.value(minTimeOption).toInt()), parser.value(filterOption));
+    bench.runAll();
+
+    if (parser.isSet(saveOption)) {
+        QJsonArray array;
+        for (const BenchResult &result : bench.results()) {
+            QJsonObject obj;
+            obj["name"] = result.name;
+            obj["iterations"] = result.iterations;
+            obj["nsPerOp"] = result.nsPerOp;
+            obj["allocsPerOp"] = result.allocsPerOp;
+            obj["mbPerSec"] = result.mbPerSec;
+            array.append(obj);
+        }
+        QFile file(parser.value(saveOption));
+        if (file.open(QIODevice::WriteOnly)) {
+            file.write(QJsonDocument(array).toJson());
+        } else {
+            qCritical() << "Cannot write" << file.fileName();
+        }
+    }
+
+    int regressions = 0;
+    if (parser.isSet(compareOption)) {
+        QFile file(parser.value(compareOption));
+        if (!file.open(QIODevice::ReadOnly)) {
+            qCritical() << "Cannot read baseline" << file.fileName();
+            return 2;
+        }
+
+        QHash<QString, double> baseline;
+        for (const QJsonValue &value : QJsonDocument::fromJson(file.readAll()).array()) {
+            baseline[value["name"].toString()] = value["nsPerOp"].toDouble();
+        }
+
+        double tolerance = parser.value(toleranceOption).toDouble() / 100.0;
+        for (const BenchResult &result : bench.results()) {
+            if (!baseline.contains(result.name)) continue;
+            double before = baseline[result.name];
+            double change = (result.nsPerOp - before) / before;
+            if (change > tolerance) {
+                ++regressions;
+                qInfo().noquote() << QString("REGRESSION %1: %2 -> %3 ns/op (%4%)").arg(result.name)
+                                         .arg(before, 0, 'f', 1).arg(result.nsPerOp, 0, 'f', 1)
+                                         .arg(change * 100.0, 0, 'f', 1);
+            }
+        }
+    }
+
+    return regressions || bench.failedChecks() ? 1 : 0;
+}
@@ -0,0 +1,413 @@
+// OriginLoadGen - headless load generator for the simulator's WebSocket and HTTP endpoints.
+//
+// Opens N sessions the way the Origin app does, fires a weighted mix of commands,
+// downloads the image announced by every NewImageReady and reports per-command
+// latency and per-endpoint throughput.
+//
+//   ./OriginLoadGen --sessions 50 --duration 30 --mix GetStatus=8,GotoRaDec=1,RunSampleCapture=1
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMap>
+#include <QRandomGenerator>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QtEndian>
+#include <QDebug>
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "WebSocketClient.h"
+
+struct LoadOptions {
+    QString host = "127.0.0.1";
+    quint16 port = 80;
+    int sessions = 10;
+    int durationSec = 30;
+    double rate = 0.0;              // Commands per second per session, 0 = closed loop
+    int rampMs = 1000;              // Connections are spread over this interval
+    bool downloadImages = true;
+    int liveStreamFps = 0;          // Ask for binary live-view push at this rate, 0 = off
+    QString imageDir = "/tmp";      // The simulator's --image-dir, whose files it serves as captures
+    QList<QPair<QString, int>> mix;
+    int totalWeight = 0;
+};
+
+struct LatencySamples {
+    qint64 count = 0;
+    qint64 errors = 0;
+    std::vector<qint64> us;
+
+    void add(qint64 value) { ++count; us.push_back(value); }
+
+    qint64 percentile(double p) {
+        if (us.empty()) return 0;
+        size_t index = std::min(us.size() - 1, size_t(p * us.size()));
+        std::nth_element(us.begin(), us.begin() + index, us.end());
+        return us[index];
+    }
+};
+
+struct EndpointStats {
+    qint64 requests = 0;
+    qint64 failures = 0;
+    qint64 bytesIn = 0;
+    qint64 bytesOut = 0;
+    LatencySamples latency;
+};
+
+struct LoadStats {
+    QMap<QString, LatencySamples> commands;
+    QMap<QString, EndpointStats> endpoints;
+    qint64 notifications = 0;
+    int connected = 0;
+    int failedSessions = 0;
+};
+
+// HTTP downloads are keyed by the route prefixes the simulator registers in setupRoutes(),
+// so JPEG live view, TIFF captures and stacked masters show up separately
+static QString endpointForPath(const QString &path, const QString &imageDir) {
+    const QString dev2 = "/SmartScope-1.0/dev2/";
+    if (path.startsWith(dev2 + "Images/Temp/")) return "http:Images/Temp";
+    if (path.startsWith(dev2 + "Images/Stacked/")) return "http:Images/Stacked";
+    if (path.startsWith(dev2 + "Images/Astrophotography/") || path.startsWith(dev2 + "/tmp")
+        || (!imageDir.isEmpty() && path.startsWith(dev2 + imageDir))) {
+        return "http:Astrophotography";
+    }
+    return "http:other";
+}
+
+class LoadSession {
+public:
+    LoadSession(int index, const LoadOptions &options, LoadStats &stats, const QElapsedTimer &clock)
+        : m_options(options), m_stats(stats), m_clock(clock),
+          m_rng(QRandomGenerator::global()->generate()) {
+        m_source = QString("LoadGen-%1").arg(index);
+    }
+
+    void start() {
+        m_client = std::make_unique<WebSocketClient>();
+        m_client->onConnected = [this]() {
+            ++m_stats.connected;
+            if (m_options.liveStreamFps > 0) startLiveStream();
+            if (m_options.rate > 0.0) {
+                m_rateTimer = std::make_unique<QTimer>();
+                m_rateTimer->setInterval(qMax(1, int(1000.0 / m_options.rate)));
+                QObject::connect(m_rateTimer.get(), &QTimer::timeout, [this]() { sendNext(); });
+                m_rateTimer->start();
+            }
+            sendNext();
+        };
+        m_client->onTextMessage = [this](const QByteArray &message) { handleMessage(message); };
+        m_client->onBinaryMessage = [this](const QByteArray &message) { handleLiveFrame(message); };
+        m_client->onError = [this](const QString &error) {
+            if (!m_stopped && !m_client->isOpen()) ++m_stats.failedSessions;
+            qWarning() << m_source << ":" << error;
+        };
+        m_client->connectToHost(m_options.host, m_options.port);
+    }
+
+    void stop() {
+        m_stopped = true;
+        if (m_rateTimer) m_rateTimer->stop();
+        if (m_client) m_client->close();
+    }
+
+private:
+    QString pickCommand() {
+        int roll = int(m_rng.bounded(m_options.totalWeight));
+        for (const auto &entry : m_options.mix) {
+            if (roll < entry.second) return entry.first;
+            roll -= entry.second;
+        }
+        return m_options.mix.first().first;
+    }
+
+    void sendNext() {
+        if (m_stopped || !m_client->isOpen()) return;
+
+        static const char *statusDevices[] = {"Mount", "Focuser", "Environment", "Disk", "TaskController"};
+
+        QJsonObject obj;
+        QString command = pickCommand();
+        obj["Command"] = command;
+        obj["SequenceID"] = ++m_sequenceId;
+        obj["Source"] = m_source;
+        obj["Type"] = "Command";
+
+        if (command == "GetStatus") {
+            obj["Destination"] = statusDevices[m_rng.bounded(5)];
+        } else if (command == "GotoRaDec") {
+            obj["Destination"] = "Mount";
+            obj["Ra"] = m_rng.bounded(2.0 * M_PI);
+            obj["Dec"] = m_rng.bounded(M_PI * 0.75) - M_PI / 4.0;
+        } else if (command == "RunSampleCapture") {
+            obj["Destination"] = "Camera";
+            obj["ExposureTime"] = 1.0;
+            obj["ISO"] = 200;
+        } else if (command == "RunInitialize") {
+            obj["Destination"] = "TaskController";
+            obj["FakeInitialize"] = true;
+        } else {
+            obj["Destination"] = "System";
+        }
+
+        QByteArray payload = QJsonDocument(obj).toJson(QJsonDocument::Compact);
+        m_pending[m_sequenceId] = {command, m_clock.nsecsElapsed() / 1000};
+        m_stats.endpoints["ws:mountControlEndpoint"].bytesOut += payload.size();
+        m_client->sendTextMessage(payload);
+    }
+
+    void startLiveStream() {
+        QJsonObject obj;
+        obj["Command"] = "StartLiveStream";
+        obj["Destination"] = "Simulator";
+        obj["FrameRate"] = m_options.liveStreamFps;
+        obj["SequenceID"] = ++m_sequenceId;
+        obj["Source"] = m_source;
+        obj["Type"] = "Command";
+        m_client->sendTextMessage(QJsonDocument(obj).toJson(QJsonDocument::Compact));
+    }
+
+    // "OLV1" | sequence u32 | send time ms i64 | JPEG; latency is only ms-accurate and
+    // assumes the simulator shares this host's clock
+    void handleLiveFrame(const QByteArray &message) {
+        EndpointStats &stats = m_stats.endpoints["ws:liveStream"];
+        stats.bytesIn += message.size();
+        if (message.size() < 16 || !message.startsWith("OLV1")) {
+            ++stats.failures;
+            return;
+        }
+        ++stats.requests;
+        qint64 sentMs = qFromBigEndian<qint64>(message.constData() + 8);
+        stats.latency.add(qMax<qint64>(0, QDateTime::currentMSecsSinceEpoch() - sentMs) * 1000);
+    }
+
+    void handleMessage(const QByteArray &message) {
+        m_stats.endpoints["ws:mountControlEndpoint"].bytesIn += message.size();
+        QJsonObject obj = QJsonDocument::fromJson(message).object();
+        QString type = obj["Type"].toString();
+
+        if (type == "Response" && obj["Destination"].toString() == m_source) {
+            auto pending = m_pending.find(obj["SequenceID"].toInt());
+            if (pending == m_pending.end()) return;
+
+            LatencySamples &samples = m_stats.commands[pending->first];
+            samples.add(m_clock.nsecsElapsed() / 1000 - pending->second);
+            if (obj["ErrorCode"].toInt() != 0) ++samples.errors;
+            m_pending.erase(pending);
+
+            if (m_options.rate <= 0.0) sendNext();
+        } else if (type == "Notification") {
+            ++m_stats.notifications;
+            if (m_options.downloadImages && obj["Command"].toString() == "NewImageReady") {
+                downloadImage(obj["FileLocation"].toString());
+            }
+        }
+    }
+
+    // One download at a time per session, like the app; newer announcements replace queued ones
+    void downloadImage(const QString &fileLocation) {
+        if (fileLocation.isEmpty() || m_stopped) return;
+        QString path = fileLocation.startsWith("/SmartScope-1.0/")
+                           ? fileLocation : "/SmartScope-1.0/dev2/" + fileLocation;
+        if (m_download) {
+            m_queuedDownload = path;
+            return;
+        }
+
+        QString endpoint = endpointForPath(path, m_options.imageDir);
+        qint64 startUs = m_clock.nsecsElapsed() / 1000;
+        m_download = std::make_unique<QTcpSocket>();
+        auto received = std::make_shared<QByteArray>();
+
+        QObject::connect(m_download.get(), &QTcpSocket::connected, [this, path, endpoint]() {
+            QByteArray request = "GET " + path.toUtf8() + " HTTP/1.1\r\nHost: " + m_options.host.toUtf8()
+                               + "\r\nConnection: close\r\n\r\n";
+            m_stats.endpoints[endpoint].bytesOut += request.size();
+            m_download->write(request);
+        });
+        QObject::connect(m_download.get(), &QTcpSocket::readyRead, [this, received]() {
+            received->append(m_download->readAll());
+        });
+        QObject::connect(m_download.get(), &QTcpSocket::disconnected, [this, received, endpoint, startUs]() {
+            EndpointStats &stats = m_stats.endpoints[endpoint];
+            ++stats.requests;
+            stats.bytesIn += received->size();
+            if (received->startsWith("HTTP/1.1 200")) {
+                stats.latency.add(m_clock.nsecsElapsed() / 1000 - startUs);
+            } else {
+                ++stats.failures;
+            }
+
+            m_download.release()->deleteLater();
+            if (!m_queuedDownload.isEmpty()) {
+                QString next = m_queuedDownload;
+                m_queuedDownload.clear();
+                downloadImage(next);
+            }
+        });
+        m_download->connectToHost(m_options.host, m_options.port);
+    }
+
+    QString m_source;
+    const LoadOptions &m_options;
+    LoadStats &m_stats;
+    const QElapsedTimer &m_clock;
+    QRandomGenerator m_rng;
+    std::unique_ptr<WebSocketClient> m_client;
+    std::unique_ptr<QTimer> m_rateTimer;
+    std::unique_ptr<QTcpSocket> m_download;
+    QString m_queuedDownload;
+    QHash<int, QPair<QString, qint64>> m_pending;   // SequenceID -> command, send time
+    int m_sequenceId = 0;
+    bool m_stopped = false;
+};
+
+static void printReport(LoadStats &stats, double seconds) {
+    qInfo().noquote() << QString("\n%1 sessions connected (%2 failed), %3 notifications in %4 s")
+                             .arg(stats.connected).arg(stats.failedSessions)
+                             .arg(stats.notifications).arg(seconds, 0, 'f', 1);
+
+    qInfo().noquote() << QString("%1 %2 %3 %4 %5 %6 %7").arg("Command", -22).arg("count", 9).arg("errors", 7)
+                             .arg("ops/s", 9).arg("p50 us", 9).arg("p99 us", 9).arg("max us", 9);
+    for (auto it = stats.commands.begin(); it != stats.commands.end(); ++it) {
+        LatencySamples &samples = it.value();
+        qInfo().noquote() << QString("%1 %2 %3 %4 %5 %6 %7").arg(it.key(), -22).arg(samples.count, 9)
+                                 .arg(samples.errors, 7).arg(samples.count / seconds, 9, 'f', 1)
+                                 .arg(samples.percentile(0.50), 9).arg(samples.percentile(0.99), 9)
+                                 .arg(samples.percentile(1.0), 9);
+    }
+
+    qInfo().noquote() << QString("\n%1 %2 %3 %4 %5 %6 %7").arg("Endpoint", -26).arg("requests", 9).arg("failed", 7)
+                             .arg("in KB/s", 10).arg("out KB/s", 10).arg("p50 ms", 8).arg("p99 ms", 8);
+    for (auto it = stats.endpoints.begin(); it != stats.endpoints.end(); ++it) {
+        EndpointStats &endpoint = it.value();
+        qInfo().noquote() << QString("%1 %2 %3 %4 %5 %6 %7").arg(it.key(), -26).arg(endpoint.requests, 9)
+                                 .arg(endpoint.failures, 7)
+                                 .arg(endpoint.bytesIn / 1024.0 / seconds, 10, 'f', 1)
+                                 .arg(endpoint.bytesOut / 1024.0 / seconds, 10, 'f', 1)
+                                 .arg(endpoint.latency.percentile(0.50) / 1000.0, 8, 'f', 1)
+                                 .arg(endpoint.latency.percentile(0.99) / 1000.0, 8, 'f', 1);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Load generator for the Celestron Origin simulator");
+    parser.addHelpOption();
+    QCommandLineOption hostOption("host", "Simulator host.", "host", "127.0.0.1");
+    QCommandLineOption portOption("port", "Simulator port.", "port", "80");
+    QCommandLineOption sessionsOption("sessions", "Concurrent WebSocket sessions.", "count", "10");
+    QCommandLineOption durationOption("duration", "Test length in seconds.", "seconds", "30");
+    QCommandLineOption rateOption("rate", "Commands per second per session (0 = closed loop).", "rate", "0");
+    QCommandLineOption rampOption("ramp", "Spread session start-up over this many ms.", "ms", "1000");
+    QCommandLineOption mixOption("mix", "Weighted command mix.", "Command=weight,...",
+                                 "GetStatus=8,GotoRaDec=1,RunSampleCapture=1");
+    QCommandLineOption noImagesOption("no-images", "Don't download images after NewImageReady.");
+    QCommandLineOption initOption("initialize", "Fake-initialize the mount first so GotoRaDec succeeds.");
+    QCommandLineOption liveStreamOption("live-stream", "Request binary live-view push at this frame rate.", "fps", "0");
+    QCommandLineOption imageDirOption("image-dir", "The simulator's --image-dir, to count its downloads as captures.",
+                                      "dir", "/tmp");
+    parser.addOption(hostOption);
+    parser.addOption(portOption);
+    parser.addOption(sessionsOption);
+    parser.addOption(durationOption);
+    parser.addOption(rateOption);
+    parser.addOption(rampOption);
+    parser.addOption(mixOption);
+    parser.addOption(noImagesOption);
+    parser.addOption(initOption);
+    parser.addOption(liveStreamOption);
+    parser.addOption(imageDirOption);
+    parser.process(app);
+
+    LoadOptions options;
+    options.host = parser.value(hostOption);
+    options.port = parser.value(portOption).toUShort();
+    options.sessions = qMax(1, parser.value(sessionsOption).toInt());
+    options.durationSec = qMax(1, parser.value(durationOption).toInt());
+    options.rate = parser.value(rateOption).toDouble();
+    options.rampMs = qMax(0, parser.value(rampOption).toInt());
+    options.downloadImages = !parser.isSet(noImagesOption);
+    options.liveStreamFps = qMax(0, parser.value(liveStreamOption).toInt());
+    options.imageDir = parser.value(imageDirOption);
+    for (const QString &entry : parser.value(mixOption).split(',', Qt::SkipEmptyParts)) {
+        QStringList parts = entry.split('=');
+        int weight = parts.size() > 1 ? parts[1].toInt() : 1;
+        if (weight > 0) {
+            options.mix.append({parts[0].trimmed(), weight});
+            options.totalWeight += weight;
+        }
+    }
+    if (options.mix.isEmpty()) {
+        qCritical() << "Empty command mix";
+        return 2;
+    }
+
+    LoadStats stats;
+    QElapsedTimer clock;
+    clock.start();
+
+    // Sends a fake RunInitialize before the sessions start, then waits for its response
+    std::unique_ptr<WebSocketClient> initializer;
+    std::vector<std::unique_ptr<LoadSession>> sessions;
+
+    auto startSessions = [&]() {
+        for (int i = 0; i < options.sessions; ++i) {
+            sessions.push_back(std::make_unique<LoadSession>(i, options, stats, clock));
+            LoadSession *session = sessions.back().get();
+            QTimer::singleShot(options.rampMs * i / options.sessions, &app, [session]() { session->start(); });
+        }
+
+        QTimer::singleShot(options.durationSec * 1000, &app, [&]() {
+            double seconds = clock.nsecsElapsed() / 1e9;
+            for (auto &session : sessions) session->stop();
+            printReport(stats, seconds);
+            QTimer::singleShot(200, &app, &QCoreApplication::quit);
+        });
+    };
+
+    bool initialized = false;
+    if (parser.isSet(initOption)) {
+        initializer = std::make_unique<WebSocketClient>();
+        initializer->onConnected = [&]() {
+            QJsonObject obj;
+            obj["Command"] = "RunInitialize";
+            obj["Destination"] = "TaskController";
+            obj["FakeInitialize"] = true;
+            obj["SequenceID"] = 1;
+            obj["Source"] = "LoadGen";
+            obj["Type"] = "Command";
+            initializer->sendTextMessage(QJsonDocument(obj).toJson(QJsonDocument::Compact));
+        };
+        initializer->onTextMessage = [&](const QByteArray &message) {
+            QJsonObject obj = QJsonDocument::fromJson(message).object();
+            if (!initialized && obj["Command"].toString() == "RunInitialize" && obj["Type"].toString() == "Response") {
+                initialized = true;
+                initializer->close();
+                clock.restart();
+                startSessions();
+            }
+        };
+        initializer->onError = [&](const QString &error) {
+            if (initialized) return;
+            qCritical() << "Cannot initialize simulator:" << error;
+            app.exit(2);
+        };
+        initializer->connectToHost(options.host, options.port);
+    } else {
+        startSessions();
+    }
+
+    return app.exec();
+}
@@ -0,0 +1,418 @@
+// OriginReplay - pushes a recorded session log back at a running simulator and
+// diffs every command response against what was recorded.
+//
+//   ./OriginSimulator --clock stepped --seed 1 --record session.oslg   (record)
+//   ./OriginReplay session.oslg --port 80                              (full speed)
+//   ./OriginReplay session.oslg --speed 10                             (10x recorded pace)
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSet>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QDebug>
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "SessionLog.h"
+#include "WebSocketClient.h"
+
+struct ReplayOptions {
+    QString host = "127.0.0.1";
+    quint16 port = 80;
+    double speed = 0.0;               // 0 = as fast as the window allows
+    int window = 64;                  // Outstanding commands per connection at full speed
+    int idleTimeoutMs = 5000;
+    int reportLimit = 20;
+    QSet<QString> ignoredFields;
+};
+
+struct ReplayStats {
+    qint64 sent = 0;
+    qint64 received = 0;
+    qint64 matched = 0;
+    qint64 mismatched = 0;
+    qint64 unexpected = 0;
+    qint64 httpSent = 0;
+    qint64 httpMismatched = 0;
+    std::vector<qint64> latenciesUs;
+    int reported = 0;
+};
+
+struct OutgoingMessage {
+    qint64 timestampUs;
+    QByteArray payload;
+    QString responseKey;              // Empty when the recording has no matching response
+};
+
+// Responses are matched on who asked, what, and the sequence number they used
+static QString responseKey(const QJsonObject &obj, bool fromRequest) {
+    QString peer = fromRequest ? obj["Source"].toString() : obj["Destination"].toString();
+    QString device = fromRequest ? obj["Destination"].toString() : obj["Source"].toString();
+    return QString("%1|%2|%3|%4").arg(peer, device, obj["Command"].toString())
+                                 .arg(obj["SequenceID"].toInteger());
+}
+
+static QJsonValue stripIgnored(const QJsonValue &value, const QSet<QString> &ignored) {
+    if (value.isObject()) {
+        QJsonObject result;
+        const QJsonObject obj = value.toObject();
+        for (auto it = obj.begin(); it != obj.end(); ++it) {
+            if (!ignored.contains(it.key())) result[it.key()] = stripIgnored(it.value(), ignored);
+        }
+        return result;
+    }
+    if (value.isArray()) {
+        QJsonArray result;
+        for (const QJsonValue &element : value.toArray()) result.append(stripIgnored(element, ignored));
+        return result;
+    }
+    return value;
+}
+
+class ReplayConnection {
+public:
+    ReplayConnection(quint32 id, const ReplayOptions &options, ReplayStats &stats)
+        : m_id(id), m_options(options), m_stats(stats) {}
+
+    quint32 id() const { return m_id; }
+    std::deque<OutgoingMessage> &outgoing() { return m_outgoing; }
+    QHash<QString, std::deque<QJsonObject>> &expected() { return m_expected; }
+
+    bool finished() const { return m_outgoing.empty() && m_inFlight.isEmpty(); }
+    qint64 missing() const {
+        qint64 count = 0;
+        for (auto it = m_inFlight.begin(); it != m_inFlight.end(); ++it) count += qint64(it.value().size());
+        return count;
+    }
+
+    void start(const QElapsedTimer *replayClock, std::function<void()> onProgress) {
+        m_replayClock = replayClock;
+        m_onProgress = std::move(onProgress);
+
+        m_client = std::make_unique<WebSocketClient>();
+        m_client->onConnected = [this]() { pump(); };
+        m_client->onTextMessage = [this](const QByteArray &message) { handleMessage(message); };
+        m_client->onError = [this](const QString &error) {
+            qWarning() << "Connection" << m_id << ":" << error;
+        };
+        m_client->connectToHost(m_options.host, m_options.port);
+
+        if (m_options.speed > 0.0) {
+            m_paceTimer = std::make_unique<QTimer>();
+            m_paceTimer->setSingleShot(true);
+            QObject::connect(m_paceTimer.get(), &QTimer::timeout, [this]() { pump(); });
+        }
+    }
+
+    // Send whatever is due: everything up to the window at full speed, or by timestamp when paced
+    void pump() {
+        if (!m_client || !m_client->isOpen()) return;
+
+        while (!m_outgoing.empty()) {
+            OutgoingMessage &next = m_outgoing.front();
+
+            if (m_options.speed > 0.0) {
+                qint64 dueUs = qint64((next.timestampUs - m_firstTimestampUs) / m_options.speed);
+                qint64 nowUs = m_replayClock->nsecsElapsed() / 1000;
+                if (dueUs > nowUs) {
+                    m_paceTimer->start(int(qMax<qint64>(1, (dueUs - nowUs) / 1000)));
+                    return;
+                }
+            } else if (m_inFlightCount >= m_options.window) {
+                return;
+            }
+
+            if (!next.responseKey.isEmpty()) {
+                m_inFlight[next.responseKey].push_back(m_replayClock->nsecsElapsed() / 1000);
+                ++m_inFlightCount;
+            }
+            m_client->sendTextMessage(next.payload);
+            ++m_stats.sent;
+            m_outgoing.pop_front();
+            m_onProgress();
+        }
+        m_onProgress();
+    }
+
+    void setFirstTimestamp(qint64 us) { m_firstTimestampUs = us; }
+
+private:
+    void handleMessage(const QByteArray &message) {
+        ++m_stats.received;
+
+        QJsonObject actual = QJsonDocument::fromJson(message).object();
+        if (actual["Type"].toString() != "Response") return; // Notifications are timing dependent
+
+        QString key = responseKey(actual, false);
+        auto flight = m_inFlight.find(key);
+        auto expected = m_expected.find(key);
+        if (flight == m_inFlight.end() || flight.value().empty()
+            || expected == m_expected.end() || expected.value().empty()) {
+            ++m_stats.unexpected;
+            return;
+        }
+
+        m_stats.latenciesUs.push_back(m_replayClock->nsecsElapsed() / 1000 - flight.value().front());
+        flight.value().pop_front();
+        if (flight.value().empty()) m_inFlight.erase(flight);
+        --m_inFlightCount;
+
+        QJsonObject recorded = expected.value().front();
+        expected.value().pop_front();
+
+        if (stripIgnored(recorded, m_options.ignoredFields) == stripIgnored(actual, m_options.ignoredFields)) {
+            ++m_stats.matched;
+        } else {
+            ++m_stats.mismatched;
+            if (m_stats.reported++ < m_options.reportLimit) {
+                qWarning().noquote() << "MISMATCH on connection" << m_id << key
+                                     << "\n  recorded:" << QJsonDocument(recorded).toJson(QJsonDocument::Compact)
+                                     << "\n  replayed:" << QJsonDocument(actual).toJson(QJsonDocument::Compact);
+            }
+        }
+
+        // A paced or window-limited pump may send nothing, but this response still counts
+        m_onProgress();
+        pump();
+    }
+
+    quint32 m_id;
+    const ReplayOptions &m_options;
+    ReplayStats &m_stats;
+    std::unique_ptr<WebSocketClient> m_client;
+    std::unique_ptr<QTimer> m_paceTimer;
+    const QElapsedTimer *m_replayClock = nullptr;
+    std::function<void()> m_onProgress;
+    std::deque<OutgoingMessage> m_outgoing;
+    QHash<QString, std::deque<QJsonObject>> m_expected;
+    QHash<QString, std::deque<qint64>> m_inFlight;   // Send times by response key
+    int m_inFlightCount = 0;
+    qint64 m_firstTimestampUs = 0;
+};
+
+// Plain HTTP requests are replayed one after another and compared on the status line
+class HttpReplay {
+public:
+    HttpReplay(const ReplayOptions &options, ReplayStats &stats) : m_options(options), m_stats(stats) {}
+
+    void add(const QByteArray &requestHead, const QByteArray &expectedStatus) {
+        m_requests.push_back({requestHead, expectedStatus});
+    }
+    bool finished() const { return m_requests.empty() && !m_socket; }
+
+    void start(std::function<void()> onProgress) {
+        m_onProgress = std::move(onProgress);
+        next();
+    }
+
+private:
+    void next() {
+        m_onProgress();
+        if (m_requests.empty()) return;
+
+        m_socket = std::make_unique<QTcpSocket>();
+        m_response.clear();
+        QObject::connect(m_socket.get(), &QTcpSocket::connected, [this]() {
+            m_socket->write(m_requests.front().first);
+            ++m_stats.httpSent;
+        });
+        QObject::connect(m_socket.get(), &QTcpSocket::readyRead, [this]() {
+            m_response.append(m_socket->readAll());
+        });
+        QObject::connect(m_socket.get(), &QTcpSocket::disconnected, [this]() {
+            QByteArray status = m_response.left(m_response.indexOf("\r\n"));
+            if (status != m_requests.front().second) {
+                ++m_stats.httpMismatched;
+                if (m_stats.reported++ < m_options.reportLimit) {
+                    qWarning().noquote() << "HTTP MISMATCH"
+                                         << m_requests.front().first.left(m_requests.front().first.indexOf("\r\n"))
+                                         << "\n  recorded:" << m_requests.front().second
+                                         << "\n  replayed:" << status;
+                }
+            }
+            m_requests.pop_front();
+            m_socket.release()->deleteLater();
+            next();
+        });
+        m_socket->connectToHost(m_options.host, m_options.port);
+    }
+
+    const ReplayOptions &m_options;
+    ReplayStats &m_stats;
+    std::deque<std::pair<QByteArray, QByteArray>> m_requests;
+    std::unique_ptr<QTcpSocket> m_socket;
+    QByteArray m_response;
+    std::function<void()> m_onProgress;
+};
+
+static qint64 percentile(std::vector<qint64> &values, double p) {
+    if (values.empty()) return 0;
+    size_t index = std::min(values.size() - 1, size_t(p * values.size()));
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Replay a recorded Origin session against the simulator");
+    parser.addHelpOption();
+    parser.addPositionalArgument("log", "Session log written by OriginSimulator --record");
+    QCommandLineOption hostOption("host", "Simulator host.", "host", "127.0.0.1");
+    QCommandLineOption portOption("port", "Simulator port.", "port", "80");
+    QCommandLineOption speedOption("speed", "Replay at N times the recorded pace (0 = full speed).", "factor", "0");
+    QCommandLineOption windowOption("window", "Outstanding commands per connection at full speed.", "count", "64");
+    QCommandLineOption ignoreOption("ignore", "Comma-separated JSON fields excluded from the diff.", "fields",
+                                    "ExpiredAt,Date,Time,Ra,Dec,Alt,Azm,FreeBytes,Temperature,Humidity,DewPoint");
+    QCommandLineOption timeoutOption("timeout", "Give up after this many ms without progress.", "ms", "5000");
+    QCommandLineOption limitOption("report-limit", "Print at most this many mismatches.", "count", "20");
+    parser.addOption(hostOption);
+    parser.addOption(portOption);
+    parser.addOption(speedOption);
+    parser.addOption(windowOption);
+    parser.addOption(ignoreOption);
+    parser.addOption(timeoutOption);
+    parser.addOption(limitOption);
+    parser.process(app);
+
+    if (parser.positionalArguments().size() != 1) {
+        parser.showHelp(1);
+    }
+
+    ReplayOptions options;
+    options.host = parser.value(hostOption);
+    options.port = parser.value(portOption).toUShort();
+    options.speed = parser.value(speedOption).toDouble();
+    options.window = qMax(1, parser.value(windowOption).toInt());
+    options.idleTimeoutMs = parser.value(timeoutOption).toInt();
+    options.reportLimit = parser.value(limitOption).toInt();
+    for (const QString &field : parser.value(ignoreOption).split(',', Qt::SkipEmptyParts)) {
+        options.ignoredFields.insert(field.trimmed());
+    }
+
+    QList<SessionRecord> records;
+    QString error;
+    if (!SessionLogReader::read(parser.positionalArguments().first(), records, nullptr, &error)) {
+        qCritical() << "Cannot read session log:" << error;
+        return 2;
+    }
+
+    // Split the log into per-connection scripts
+    ReplayStats stats;
+    std::vector<std::unique_ptr<ReplayConnection>> connections;
+    QHash<quint32, ReplayConnection*> byId;
+    QHash<quint32, QByteArray> pendingHttp;
+    HttpReplay http(options, stats);
+    qint64 firstTimestampUs = -1;
+
+    for (const SessionRecord &record : records) {
+        switch (record.kind) {
+            case SessionRecordKind::WebSocketInbound: {
+                ReplayConnection *&connection = byId[record.connectionId];
+                if (!connection) {
+                    connections.push_back(std::make_unique<ReplayConnection>(record.connectionId, options, stats));
+                    connection = connections.back().get();
+                }
+                QJsonObject request = QJsonDocument::fromJson(record.payload).object();
+                connection->outgoing().push_back({record.timestampUs, record.payload, responseKey(request, true)});
+                if (firstTimestampUs < 0) firstTimestampUs = record.timestampUs;
+                break;
+            }
+            case SessionRecordKind::WebSocketOutbound: {
+                QJsonObject response = QJsonDocument::fromJson(record.payload).object();
+                ReplayConnection *connection = byId.value(record.connectionId);
+                if (connection && response["Type"].toString() == "Response") {
+                    connection->expected()[responseKey(response, false)].push_back(response);
+                }
+                break;
+            }
+            case SessionRecordKind::HttpRequest:
+                if (!record.payload.toLower().contains("upgrade: websocket")) {
+                    pendingHttp[record.connectionId] = record.payload;
+                }
+                break;
+            case SessionRecordKind::HttpResponse:
+                if (pendingHttp.contains(record.connectionId)) {
+                    http.add(pendingHttp.take(record.connectionId),
+                             record.payload.left(record.payload.indexOf("\r\n")));
+                }
+                break;
+            default:
+                break;
+        }
+    }
+
+    // Requests whose response never made it into the log can't be diffed
+    for (auto &connection : connections) {
+        for (OutgoingMessage &message : connection->outgoing()) {
+            if (!connection->expected().contains(message.responseKey)) message.responseKey.clear();
+        }
+        connection->setFirstTimestamp(firstTimestampUs);
+    }
+
+    qInfo() << "Replaying" << records.size() << "records over" << connections.size()
+            << "WebSocket connections to" << options.host << options.port
+            << (options.speed > 0.0 ? QString("at %1x").arg(options.speed) : QString("at full speed"));
+
+    QElapsedTimer replayClock;
+    QTimer idleTimer;
+    idleTimer.setSingleShot(true);
+    idleTimer.setInterval(options.idleTimeoutMs);
+
+    bool reported = false;
+    auto report = [&]() {
+        if (reported) return;
+        reported = true;
+        
+        double seconds = replayClock.nsecsElapsed() / 1e9;
+        qint64 missing = 0;
+        for (auto &connection : connections) missing += connection->missing();
+
+        qInfo().noquote() << QString("Sent %1 messages and %2 HTTP requests in %3 s (%4 msg/s)")
+                                 .arg(stats.sent).arg(stats.httpSent).arg(seconds, 0, 'f', 3)
+                                 .arg(seconds > 0 ? stats.sent / seconds : 0.0, 0, 'f', 0);
+        qInfo().noquote() << QString("Responses: %1 matched, %2 mismatched, %3 missing, %4 unexpected; "
+                                     "%5 HTTP mismatched")
+                                 .arg(stats.matched).arg(stats.mismatched).arg(missing)
+                                 .arg(stats.unexpected).arg(stats.httpMismatched);
+        qInfo().noquote() << QString("Latency us: p50 %1  p99 %2  max %3")
+                                 .arg(percentile(stats.latenciesUs, 0.50))
+                                 .arg(percentile(stats.latenciesUs, 0.99))
+                                 .arg(percentile(stats.latenciesUs, 1.0));
+
+        app.exit(stats.mismatched || missing || stats.httpMismatched ? 1 : 0);
+    };
+
+    auto onProgress = [&]() {
+        bool done = http.finished();
+        for (auto &connection : connections) done = done && connection->finished();
+        if (done) {
+            QTimer::singleShot(0, &app, report);
+        } else {
+            idleTimer.start();
+        }
+    };
+
+    QObject::connect(&idleTimer, &QTimer::timeout, &app, [&]() {
+        qWarning() << "No progress for" << options.idleTimeoutMs << "ms, stopping";
+        report();
+    });
+
+    QTimer::singleShot(0, &app, [&]() {
+        replayClock.start();
+        idleTimer.start();
+        for (auto &connection : connections) connection->start(&replayClock, onProgress);
+        http.start(onProgress);
+    });
+
+    return app.exec();
+}
@@ -42,6 +42,9 @@ template <> constexpr inline auto WebSocketConnection::qt_create_metaobjectdata<
         "textMessageReceived",
         "",
         "message",
+        "binaryDataReceived",
+        "data",
+        "messageComplete",
         "pingReceived",
         "payload",
         "pongReceived",
@@ -57,24 +60,28 @@ template <> constexpr inline auto WebSocketConnection::qt_create_metaobjectdata<
         QtMocHelpers::SignalData<void(const QString &)>(1, 2, QMC::AccessPublic, QMetaType::Void, {{
             { QMetaType::QString, 3 },
         }}),
+        // Signal 'binaryDataReceived'
+        QtMocHelpers::SignalData<void(const QByteArray &, bool)>(4, 2, QMC::AccessPublic, QMetaType::Void, {{
+            { QMetaType::QByteArray, 5 }, { QMetaType::Bool, 6 },
+        }}),
         // Signal 'pingReceived'
-        QtMocHelpers::SignalData<void(const QByteArray &)>(4, 2, QMC::AccessPublic, QMetaType::Void, {{
-            { QMetaType::QByteArray, 5 },
+        QtMocHelpers::SignalData<void(const QByteArray &)>(7, 2, QMC::AccessPublic, QMetaType::Void, {{
+            { QMetaType::QByteArray, 8 },
         }}),
         // Signal 'pongReceived'
-        QtMocHelpers::SignalData<void(const QByteArray &)>(6, 2, QMC::AccessPublic, QMetaType::Void, {{
-            { QMetaType::QByteArray, 5 },
+        QtMocHelpers::SignalData<void(const QByteArray &)>(9, 2, QMC::AccessPublic, QMetaType::Void, {{
+            { QMetaType::QByteArray, 8 },
         }}),
         // Signal 'disconnected'
-        QtMocHelpers::SignalData<void()>(7, 2, QMC::AccessPublic, QMetaType::Void),
+        QtMocHelpers::SignalData<void()>(10, 2, QMC::AccessPublic, QMetaType::Void),
         // Signal 'pingTimeout'
-        QtMocHelpers::SignalData<void()>(8, 2, QMC::AccessPublic, QMetaType::Void),
+        QtMocHelpers::SignalData<void()>(11, 2, QMC::AccessPublic, QMetaType::Void),
         // Slot 'handleData'
-        QtMocHelpers::SlotData<void()>(9, 2, QMC::AccessPrivate, QMetaType::Void),
+        QtMocHelpers::SlotData<void()>(12, 2, QMC::AccessPrivate, QMetaType::Void),
         // Slot 'onPingTimeout'
-        QtMocHelpers::SlotData<void()>(10, 2, QMC::AccessPrivate, QMetaType::Void),
+        QtMocHelpers::SlotData<void()>(13, 2, QMC::AccessPrivate, QMetaType::Void),
         // Slot 'sendAutomaticPing'
-        QtMocHelpers::SlotData<void()>(11, 2, QMC::AccessPrivate, QMetaType::Void),
+        QtMocHelpers::SlotData<void()>(14, 2, QMC::AccessPrivate, QMetaType::Void),
     };
     QtMocHelpers::UintData qt_properties {
     };
@@ -99,26 +106,29 @@ void WebSocketConnection::qt_static_metacall(QObject *_o, QMetaObject::Call _c,
     if (_c == QMetaObject::InvokeMetaMethod) {
         switch (_id) {
         case 0: _t->textMessageReceived((*reinterpret_cast< std::add_pointer_t<QString>>(_a[1]))); break;
-        case 1: _t->pingReceived((*reinterpret_cast< std::add_pointer_t<QByteArray>>(_a[1]))); break;
-        case 2: _t->pongReceived((*reinterpret_cast< std::add_pointer_t<QByteArray>>(_a[1]))); break;
-        case 3: _t->disconnected(); break;
-        case 4: _t->pingTimeout(); break;
-        case 5: _t->handleData(); break;
-        case 6: _t->onPingTimeout(); break;
-        case 7: _t->sendAutomaticPing(); break;
+        case 1: _t->binaryDataReceived((*reinterpret_cast< std::add_pointer_t<QByteArray>>(_a[1])),(*reinterpret_cast< std::add_pointer_t<bool>>(_a[2]))); break;
+        case 2: _t->pingReceived((*reinterpret_cast< std::add_pointer_t<QByteArray>>(_a[1]))); break;
+        case 3: _t->pongReceived((*reinterpret_cast< std::add_pointer_t<QByteArray>>(_a[1]))); break;
+        case 4: _t->disconnected(); break;
+        case 5: _t->pingTimeout(); break;
+        case 6: _t->handleData(); break;
+        case 7: _t->onPingTimeout(); break;
+        case 8: _t->sendAutomaticPing(); break;
         default: ;
         }
     }
     if (_c == QMetaObject::IndexOfMethod) {
         if (QtMocHelpers::indexOfMethod<void (WebSocketConnection::*)(const QString & )>(_a, &WebSocketConnection::textMessageReceived, 0))
             return;
-        if (QtMocHelpers::indexOfMethod<void (WebSocketConnection::*)(const QByteArray & )>(_a, &WebSocketConnection::pingReceived, 1))
+        if (QtMocHelpers::indexOfMethod<void (WebSocketConnection::*)(const QByteArray & , bool )>(_a, &WebSocketConnection::binaryDataReceived, 1))
+            return;
+        if (QtMocHelpers::indexOfMethod<void (WebSocketConnection::*)(const QByteArray & )>(_a, &WebSocketConnection::pingReceived, 2))
             return;
-        if (QtMocHelpers::indexOfMethod<void (WebSocketConnection::*)(const QByteArray & )>(_a, &WebSocketConnection::pongReceived, 2))
+        if (QtMocHelpers::indexOfMethod<void (WebSocketConnection::*)(const QByteArray & )>(_a, &WebSocketConnection::pongReceived, 3))
             return;
-        if (QtMocHelpers::indexOfMethod<void (WebSocketConnection::*)()>(_a, &WebSocketConnection::disconnected, 3))
+        if (QtMocHelpers::indexOfMethod<void (WebSocketConnection::*)()>(_a, &WebSocketConnection::disconnected, 4))
             return;
-        if (QtMocHelpers::indexOfMethod<void (WebSocketConnection::*)()>(_a, &WebSocketConnection::pingTimeout, 4))
+        if (QtMocHelpers::indexOfMethod<void (WebSocketConnection::*)()>(_a, &WebSocketConnection::pingTimeout, 5))
             return;
     }
 }
@@ -142,14 +152,14 @@ int WebSocketConnection::qt_metacall(QMetaObject::Call _c, int _id, void **_a)
     if (_id < 0)
         return _id;
     if (_c == QMetaObject::InvokeMetaMethod) {
-        if (_id < 8)
+        if (_id < 9)
             qt_static_metacall(this, _c, _id, _a);
-        _id -= 8;
+        _id -= 9;
     }
     if (_c == QMetaObject::RegisterMethodArgumentMetaType) {
-        if (_id < 8)
+        if (_id < 9)
             *reinterpret_cast<QMetaType *>(_a[0]) = QMetaType();
-        _id -= 8;
+        _id -= 9;
     }
     return _id;
 }
@@ -161,26 +171,32 @@ void WebSocketConnection::textMessageReceived(const QString & _t1)
 }
 
 // SIGNAL 1
-void WebSocketConnection::pingReceived(const QByteArray & _t1)
+void WebSocketConnection::binaryDataReceived(const QByteArray & _t1, bool _t2)
 {
-    QMetaObject::activate<void>(this, &staticMetaObject, 1, nullptr, _t1);
+    QMetaObject::activate<void>(this, &staticMetaObject, 1, nullptr, _t1, _t2);
 }
 
 // SIGNAL 2
-void WebSocketConnection::pongReceived(const QByteArray & _t1)
+void WebSocketConnection::pingReceived(const QByteArray & _t1)
 {
     QMetaObject::activate<void>(this, &staticMetaObject, 2, nullptr, _t1);
 }
 
 // SIGNAL 3
-void WebSocketConnection::disconnected()
+void WebSocketConnection::pongReceived(const QByteArray & _t1)
 {
-    QMetaObject::activate(this, &staticMetaObject, 3, nullptr);
+    QMetaObject::activate<void>(this, &staticMetaObject, 3, nullptr, _t1);
 }
 
 // SIGNAL 4
-void WebSocketConnection::pingTimeout()
+void WebSocketConnection::disconnected()
 {
     QMetaObject::activate(this, &staticMetaObject, 4, nullptr);
 }
+
+// SIGNAL 5
+void WebSocketConnection::pingTimeout()
+{
+    QMetaObject::activate(this, &staticMetaObject, 5, nullptr);
+}
 QT_WARNING_POP